@@ -0,0 +1,120 @@
+/**
+ * @file Aligned_allocator.hpp
+ *
+ * @brief Allocator returning cache line aligned storage, from the heap or
+ *        from an Arena.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_ALIGNED_ALLOCATOR_HPP_
+#define _BACKPROPAGATION_ALIGNED_ALLOCATOR_HPP_
+
+#include <stdlib.h>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "Arena.hpp"
+
+namespace BackPropagation
+{
+    /** Alignment used for all the parameter and activation buffers. */
+    constexpr size_t ALIGNMENT = 64;
+
+    /**
+     * Class Aligned_allocator
+     *
+     * Takes the storage from the heap, or from an arena when given one. The
+     * storage taken from an arena is only released with the arena, which must
+     * outlive the containers using it.
+     */
+    template <typename T>
+    struct Aligned_allocator
+    {
+            typedef T value_type;
+            typedef std::true_type propagate_on_container_move_assignment;
+            typedef std::true_type propagate_on_container_swap;
+            typedef std::false_type is_always_equal;
+
+            Arena *arena;   ///< Source of the storage, nullptr for the heap
+
+            // Construction
+        public:
+            Aligned_allocator() noexcept :
+                arena(nullptr)
+            {
+            }
+
+            explicit Aligned_allocator(Arena *source) noexcept :
+                arena(source)
+            {
+            }
+
+            template <typename U>
+            Aligned_allocator(const Aligned_allocator<U> &other) noexcept :
+                arena(other.arena)
+            {
+            }
+
+            // Methods
+        public:
+            /**
+             * Copies of a container are allocated on the heap, the arena being
+             * planned for the original only.
+             */
+            Aligned_allocator select_on_container_copy_construction() const
+            {
+                return Aligned_allocator();
+            }
+
+            T* allocate(size_t count)
+            {
+                if (arena)
+                {
+                    return static_cast<T*>(arena->allocate(count * sizeof(T)));
+                }
+
+                // aligned_alloc requires the size to be a multiple of the alignment
+                size_t bytes = (count * sizeof(T) + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+                void *data = aligned_alloc(ALIGNMENT, bytes ? bytes : ALIGNMENT);
+
+                if (data == nullptr)
+                {
+                    throw std::bad_alloc();
+                }
+
+                return static_cast<T*>(data);
+            }
+
+            void deallocate(T *data, size_t)
+            {
+                if (arena == nullptr)
+                {
+                    free(data);
+                }
+            }
+
+            template <typename U>
+            bool operator==(const Aligned_allocator<U> &other) const noexcept
+            {
+                return arena == other.arena;
+            }
+
+            template <typename U>
+            bool operator!=(const Aligned_allocator<U> &other) const noexcept
+            {
+                return arena != other.arena;
+            }
+    };
+
+    /** Vector whose storage starts on a cache line boundary */
+    template <typename T>
+    using Aligned_vector = std::vector<T, Aligned_allocator<T>>;
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_ALIGNED_ALLOCATOR_HPP_ */
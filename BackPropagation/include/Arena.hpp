@@ -0,0 +1,93 @@
+/**
+ * @file Arena.hpp
+ *
+ * @brief Block of memory planned up front and handed out piece by piece.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_ARENA_HPP_
+#define _BACKPROPAGATION_ARENA_HPP_
+
+#include <stddef.h>
+
+#include <vector>
+
+namespace BackPropagation
+{
+    /**
+     * Class Arena
+     *
+     * One aligned block holding all the buffers of a workspace, so that they
+     * are allocated at once and lie next to each other. The pieces are never
+     * freed one by one: all of them are released with the arena. When the
+     * plan was too small, additional blocks are allocated as needed.
+     */
+    class Arena
+    {
+        private:
+            /** Class Block: memory owned by the arena */
+            struct Block
+            {
+                    char *data;         ///< Start of the block
+                    size_t size;        ///< Size of the block
+                    bool mapped;        ///< Mapped with mmap(), allocated on the heap otherwise
+            };
+
+            std::vector<Block> m_blocks;    ///< The planned block, followed by the overflow ones
+            size_t m_used;                  ///< Bytes handed out from the last block
+            size_t m_overflow;              ///< Bytes allocated beyond the planned block
+            bool m_huge_pages;              ///< Back the planned block with transparent huge pages
+
+            /** Allocate a block of at least the given size */
+            void add_block(size_t bytes, bool hugePages);
+
+            // Construction
+        public:
+            /**
+             * @param[in] bytes     planned size, see round().
+             * @param[in] hugePages back the block with transparent huge pages,
+             *                      where the system supports them.
+             */
+            explicit Arena(size_t bytes, bool hugePages = false);
+            ~Arena();
+
+            Arena(const Arena&) = delete;
+            Arena& operator=(const Arena&) = delete;
+
+            // Methods
+        public:
+            /**
+             * @param[in] bytes size of a piece.
+             *
+             * @return the space the piece takes in an arena, for planning its size.
+             */
+            static size_t round(size_t bytes);
+
+            /**
+             * @param[in] bytes size of the piece.
+             *
+             * @return a piece of memory aligned on ALIGNMENT, valid as long as the arena.
+             */
+            void* allocate(size_t bytes);
+
+            /**
+             * @return the planned size.
+             */
+            size_t capacity() const;
+
+            /**
+             * @return bytes allocated beyond the planned size, 0 if the plan was right.
+             */
+            size_t overflow() const;
+
+            /**
+             * @return true if the planned block is backed by huge pages.
+             */
+            bool huge_pages() const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_ARENA_HPP_ */
@@ -0,0 +1,60 @@
+/**
+ * @file Code_generator.hpp
+ *
+ * @brief Ahead-of-time compilation of trained networks into C++ headers
+ *        with no dependency on the library.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_CODE_GENERATOR_HPP_
+#define _BACKPROPAGATION_CODE_GENERATOR_HPP_
+
+#include <iostream>
+#include <string>
+
+#include "Model_file.hpp"
+#include "Network.hpp"
+
+namespace BackPropagation
+{
+    /**
+     * Write a C++17 header computing the outputs of a network, which only
+     * includes standard headers. In namespace name, it declares:
+     *  - Scalar, the scalar type of the network,
+     *  - INPUTS, OUTPUTS, LAYERS and SIZES, the topology,
+     *  - void test(const Scalar *inputs, Scalar *outputs), thread safe.
+     *
+     * The weights are inline constexpr arrays aligned to 64 bytes, and test()
+     * calls each layer in turn with its sizes as template arguments, so the
+     * compiler sees loops of constant trip counts over constant data. The
+     * weights are stored transposed (one row per input), so that the
+     * products of an input with all the neurons of the layer are vectorized
+     * without reordering the sums. Unlike the library, which picks its
+     * kernels at run time, the generated code only uses the instruction set
+     * it is compiled for (e.g. -O3 -march=...).
+     *
+     * The fast activation functions keep their approximations of
+     * functions::fast, written in scalar form for the compiler to vectorize.
+     *
+     * @param[in]  network to compile.
+     * @param[out] output  stream the header is written to.
+     * @param[in]  name    C++ identifier of the namespace of the generated code,
+     *                     also used in its include guard.
+     *
+     * Throws std::invalid_argument if name is not an identifier or if an
+     * activation function is not one of those shipped with the library.
+     */
+    template <typename T>
+    void generate_code(const Network<T> &network, std::ostream &output, const std::string &name = "network");
+
+    /**
+     * generate_code() for a mapped model file.
+     */
+    template <typename T>
+    void generate_code(const Mapped_network<T> &network, std::ostream &output, const std::string &name = "network");
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_CODE_GENERATOR_HPP_ */
@@ -0,0 +1,170 @@
+/**
+ * @file Dataset_file.hpp
+ *
+ * @brief Binary dataset format, written sample by sample and read through
+ *        a memory mapping, for data sets which do not fit in memory.
+ *
+ * Layout (native byte order, every offset relative to the start of the file):
+ *  - dataset::Header
+ *  - the samples, from the offset given by the header, each one being its
+ *    inputs followed by its expected outputs
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_DATASET_FILE_HPP_
+#define _BACKPROPAGATION_DATASET_FILE_HPP_
+
+#include <stdint.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "Samples.hpp"
+#include "Training_data.hpp"
+
+namespace BackPropagation
+{
+    namespace dataset
+    {
+        constexpr char MAGIC[8] = { 'B', 'P', 'D', 'A', 'T', 'A', 0, 0 };
+        constexpr uint32_t VERSION = 1;
+        constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;  ///< Written natively, to detect foreign files
+
+        /** Class Header: start of a dataset file */
+        struct Header
+        {
+                char magic[8];          ///< MAGIC
+                uint32_t version;       ///< VERSION
+                uint32_t byte_order;    ///< BYTE_ORDER_MARK
+                uint32_t scalar_size;   ///< Size of the scalar type of the values, in bytes
+                uint32_t inputs;        ///< Number of inputs of each sample
+                uint32_t outputs;       ///< Number of expected outputs of each sample
+                uint32_t reserved;      ///< 0
+                uint64_t samples;       ///< Number of samples
+                uint64_t data;          ///< Offset of the first sample
+        };
+
+    } /* namespace dataset */
+
+    /**
+     * Class Dataset_writer
+     *
+     * Creates a dataset file one sample at a time, so that data sets larger
+     * than the memory can be converted.
+     */
+    template <typename T = double>
+    class Dataset_writer
+    {
+        private:
+            std::ofstream m_file;       ///< File being written
+            std::string m_path;         ///< Path of the file, for the error messages
+            dataset::Header m_header;   ///< Header, completed by close()
+
+            // Construction
+        public:
+            /**
+             * @param[in] path    of the file to create.
+             * @param[in] inputs  number of inputs of each sample.
+             * @param[in] outputs number of expected outputs of each sample.
+             *
+             * Throws std::runtime_error if the file can not be created.
+             */
+            Dataset_writer(const std::string &path, size_t inputs, size_t outputs);
+
+            /** Closes the file, if close() was not called */
+            ~Dataset_writer();
+
+            // Methods
+        public:
+            /**
+             * Append a sample.
+             *
+             * @param[in] inputs  of the sample.
+             * @param[in] outputs expected for the sample.
+             */
+            void add(const T *inputs, const T *outputs);
+
+            /**
+             * Append a sample.
+             *
+             * @param[in] sample to append.
+             */
+            void add(const Training_data<T> &sample);
+
+            /**
+             * Write the number of samples in the header and close the file.
+             *
+             * Throws std::runtime_error if the file could not be written.
+             */
+            void close();
+    };
+
+    /**
+     * Write a whole data set to a dataset file.
+     *
+     * @param[in] data to write, all the samples having the same sizes.
+     * @param[in] path of the file to create.
+     */
+    template <typename T>
+    void save_dataset(const std::vector<Training_data<T>> &data, const std::string &path);
+
+    /**
+     * Class Mapped_dataset
+     *
+     * Dataset file mapped in memory. The samples are read from the file when
+     * accessed, and can be dropped from memory again (see Samples::release()),
+     * so the data set does not have to fit in memory.
+     */
+    template <typename T = double>
+    class Mapped_dataset
+    {
+        private:
+            void *m_address;        ///< Start of the mapping
+            size_t m_length;        ///< Size of the mapping
+            Samples<T> m_samples;   ///< View of the mapped samples
+
+            // Construction
+        public:
+            /**
+             * Map a dataset file written for the same scalar type.
+             *
+             * @param[in] path of the dataset file.
+             *
+             * Throws std::runtime_error if the file can not be mapped or is
+             * not a valid dataset.
+             */
+            explicit Mapped_dataset(const std::string &path);
+            ~Mapped_dataset();
+
+            Mapped_dataset(const Mapped_dataset&) = delete;
+            Mapped_dataset& operator=(const Mapped_dataset&) = delete;
+
+            // Methods
+        public:
+            /**
+             * @return the samples, to be passed to Network::train().
+             */
+            const Samples<T>& samples() const;
+
+            /**
+             * @return number of samples.
+             */
+            size_t size() const;
+
+            /**
+             * @return number of inputs of each sample.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of expected outputs of each sample.
+             */
+            size_t outputs() const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_DATASET_FILE_HPP_ */
@@ -0,0 +1,244 @@
+/**
+ * @file Inference_server.hpp
+ *
+ * @brief Local inference server batching concurrent requests, and its client.
+ *
+ * Protocol (native byte order, over a Unix domain socket or TCP on localhost):
+ *  - on connection the server sends a serving::Hello,
+ *  - a request is a uint32_t sample count n followed by n * inputs scalars,
+ *    answered by n * outputs scalars. Requests of a connection are answered
+ *    in order, one at a time,
+ *  - a request of STATS_REQUEST samples is answered by a serving::Stats.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_INFERENCE_SERVER_HPP_
+#define _BACKPROPAGATION_INFERENCE_SERVER_HPP_
+
+#include <stdint.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Model_file.hpp"
+#include "Thread_pool.hpp"
+
+namespace BackPropagation
+{
+    namespace serving
+    {
+        constexpr uint32_t STATS_REQUEST = 0;           ///< Sample count of a statistics request
+        constexpr uint32_t MAX_REQUEST = 65536;         ///< Largest number of samples of a request
+        constexpr uint16_t DEFAULT_PORT = 8765;         ///< TCP port used without a socket path
+        constexpr size_t LATENCY_WINDOW = 65536;        ///< Number of latest requests the percentiles are computed on
+
+        /** Class Hello: sent by the server to every new connection */
+        struct Hello
+        {
+                uint32_t inputs;        ///< Number of inputs of the network
+                uint32_t outputs;       ///< Number of outputs of the network
+                uint32_t scalar_size;   ///< Size of the scalar type of the inputs and outputs, in bytes
+        };
+
+        /** Class Stats: counters of a server since it started */
+        struct Stats
+        {
+                uint64_t requests;      ///< Requests answered
+                uint64_t samples;       ///< Samples answered
+                uint64_t batches;       ///< Batches run
+                double seconds;         ///< Time since the server started
+                double p50;             ///< Median latency of the latest requests, in microseconds
+                double p99;             ///< 99th percentile of the latency of the latest requests, in microseconds
+        };
+
+    } /* namespace serving */
+
+    /** Class Server_settings */
+    struct Server_settings
+    {
+            std::string socket_path;    ///< Unix domain socket to listen on, TCP on localhost if empty
+            uint16_t port;              ///< TCP port, serving::DEFAULT_PORT by default
+            size_t max_batch;           ///< Largest number of samples run as one batch, 32 by default
+            /**
+             * Longest time a request waits for others to batch with, in
+             * microseconds, 1000 by default. A batch starts as soon as it is
+             * full or its first request waited that long.
+             */
+            uint32_t max_delay;
+            size_t workers;             ///< Threads running the batches, one per core by default
+
+            // Construction
+        public:
+            Server_settings();
+    };
+
+    /**
+     * Class Inference_server
+     *
+     * Serves Mapped_network::test() to local clients. Each connection has a
+     * thread reading its requests into a shared queue. The workers take
+     * turns forming micro-batches from the queue: the samples of the
+     * requests waiting, up to max_batch, or less once the first one waited
+     * max_delay. While a worker waits for a batch to fill, the others run
+     * theirs, so that a bounded delay buys the throughput of the batched
+     * matrix products.
+     */
+    template <typename T = double>
+    class Inference_server
+    {
+        private:
+            typedef std::chrono::steady_clock Clock;
+
+            /** Class Request: samples of one request, owned by its connection thread */
+            struct Request
+            {
+                    const T *inputs;                        ///< count * inputs values
+                    T *outputs;                             ///< count * outputs values, written by a worker
+                    uint32_t count;                         ///< Number of samples
+                    Clock::time_point arrival;              ///< Time the request was read
+                    bool done;                              ///< Outputs are written
+                    std::condition_variable completed;      ///< Signaled once done
+            };
+
+            /** Class Connection */
+            struct Connection
+            {
+                    int fd;                                 ///< Socket of the client
+                    std::thread thread;                     ///< Reading the requests and writing the answers
+                    bool finished;                          ///< The thread is about to end
+            };
+
+            const Mapped_network<T> &m_network;             ///< Network being served
+            Server_settings m_settings;                     ///< Server configuration
+            int m_listener;                                 ///< Listening socket
+            Thread_pool m_pool;                             ///< Workers running the batches
+            Clock::time_point m_start;                      ///< Time the server was created
+            std::mutex m_mutex;                             ///< Protects the members below
+            std::condition_variable m_queued;               ///< Signaled when the queue changes or the server stops
+            std::deque<Request*> m_queue;                   ///< Requests waiting for a batch
+            size_t m_queued_samples;                        ///< Number of samples of the requests waiting
+            bool m_forming;                                 ///< A worker is forming a batch
+            bool m_stop;                                    ///< Set by stop()
+            std::list<Connection> m_connections;            ///< Open connections
+            std::vector<float> m_latencies;                 ///< Latencies of the latest requests, in microseconds
+            serving::Stats m_stats;                         ///< Counters, without the latencies
+
+            void accept_connections();
+            void serve_connection(Connection &connection);
+            void run_batches();
+
+            // Construction
+        public:
+            /**
+             * Start listening, the requests being served by run().
+             *
+             * @param[in] network  to serve, which must outlive the server.
+             * @param[in] settings Server configuration.
+             *
+             * Throws std::runtime_error if the socket can not be listened on.
+             */
+            Inference_server(const Mapped_network<T> &network, const Server_settings &settings);
+            ~Inference_server();
+
+            Inference_server(const Inference_server&) = delete;
+            Inference_server& operator=(const Inference_server&) = delete;
+
+            // Methods
+        public:
+            /**
+             * Serve the requests until stop() is called. The calling thread is
+             * one of the workers.
+             */
+            void run();
+
+            /**
+             * Thread safe, make run() return once the requests already read
+             * are answered. Connections are closed.
+             */
+            void stop();
+
+            /**
+             * Thread safe.
+             *
+             * @return the counters of the server.
+             */
+            serving::Stats stats();
+    };
+
+    /**
+     * Class Inference_client
+     *
+     * Connection to an Inference_server, for one thread.
+     */
+    template <typename T = double>
+    class Inference_client
+    {
+        private:
+            int m_fd;                   ///< Socket connected to the server
+            serving::Hello m_hello;     ///< Sent by the server
+
+            void handshake();
+
+            // Construction
+        public:
+            /**
+             * Connect to a server listening on a Unix domain socket.
+             *
+             * @param[in] socketPath of the server.
+             *
+             * Throws std::runtime_error if the server can not be reached, and
+             * std::invalid_argument if it serves another scalar type.
+             */
+            explicit Inference_client(const std::string &socketPath);
+
+            /**
+             * Connect to a server listening on a TCP port of localhost, see above.
+             *
+             * @param[in] port of the server.
+             */
+            explicit Inference_client(uint16_t port);
+            ~Inference_client();
+
+            Inference_client(const Inference_client&) = delete;
+            Inference_client& operator=(const Inference_client&) = delete;
+
+            // Methods
+        public:
+            /**
+             * Run samples through the served network.
+             *
+             * @param[in]  inputs  of the samples, inputs() consecutive values per sample.
+             * @param[in]  count   number of samples, at most serving::MAX_REQUEST.
+             * @param[out] outputs of the network, outputs() consecutive values per sample.
+             *
+             * Throws std::runtime_error if the connection is lost.
+             */
+            void test(const T *inputs, size_t count, T *outputs);
+
+            /**
+             * @return the counters of the server.
+             */
+            serving::Stats stats();
+
+            /**
+             * @return number of inputs of the network.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of outputs of the network.
+             */
+            size_t outputs() const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_INFERENCE_SERVER_HPP_ */
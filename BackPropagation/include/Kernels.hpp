@@ -0,0 +1,257 @@
+/**
+ * @file Kernels.hpp
+ *
+ * @brief Vectorized kernels used by the layers, selected at runtime
+ *        according to the instruction sets supported by the CPU.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_KERNELS_HPP_
+#define _BACKPROPAGATION_KERNELS_HPP_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace BackPropagation
+{
+    namespace kernels
+    {
+        /** Instruction sets for which kernels are available */
+        enum class Isa
+        {
+            SCALAR,
+            SSE2,
+            AVX2,
+            AVX512
+        };
+
+        /** Class Step: hyper-parameters of one optimizer update */
+        template <typename T>
+        struct Step
+        {
+                T rate;     ///< Learning rate, including Adam's bias corrections
+                T beta1;    ///< Momentum, or decay of Adam's first moment
+                T beta2;    ///< Decay of the mean squares of RMSProp and Adam
+                T epsilon;  ///< Added to the root mean squares, against divisions by zero
+        };
+
+        /** Class Table: one implementation of every kernel, for a scalar type T */
+        template <typename T>
+        struct Table
+        {
+                Isa isa;          ///< Instruction set used by the implementations
+                const char *name; ///< Human readable name of the instruction set
+
+                /** @return sum(x[i] * y[i]) */
+                T (*dot)(const T *x, const T *y, size_t count);
+
+                /** sums[j] = sum(x[j][i] * y[i]) for the four rows x0..x3 */
+                void (*dot4)(
+                    const T *x0,
+                    const T *x1,
+                    const T *x2,
+                    const T *x3,
+                    const T *y,
+                    size_t count,
+                    T *sums);
+
+                /** y[i] += alpha * x[i] */
+                void (*axpy)(T alpha, const T *x, T *y, size_t count);
+
+                /** @return sum(values[i] * x[columns[i]]), a row of a sparse matrix times x */
+                T (*sparse_dot)(const T *values, const uint32_t *columns, const T *x, size_t count);
+
+                /**
+                 * Per-sample update of the weights of a neuron:
+                 *  momentum = inputs[i] * delta
+                 *  weights[i] += momentum + previous momentum
+                 *  errors[i] += weights[i] * delta
+                 */
+                void (*adjust)(
+                    T delta,
+                    const T *inputs,
+                    T *weights,
+                    T *momentums,
+                    T *errors,
+                    size_t count);
+
+                /**
+                 * Update of the weights from accumulated gradients:
+                 *  momentum = gradients[i] * scale
+                 *  weights[i] += momentum + previous momentum
+                 */
+                void (*apply)(
+                    T scale,
+                    const T *gradients,
+                    T *weights,
+                    T *momentums,
+                    size_t count);
+
+                /**
+                 * Optimizer update, in a single pass over the weights and their
+                 * state (first and second), for g = gradients[i] * scale.
+                 * When errors is not nullptr (per-sample training, the gradients
+                 * being the inputs and scale the delta of the neuron), it also
+                 * does errors[i] += weights[i] * scale, with the adjusted weights.
+                 */
+                typedef void (*Optimizer_kernel)(
+                    const Step<T> &step,
+                    T scale,
+                    const T *gradients,
+                    T *weights,
+                    T *first,
+                    T *second,
+                    T *errors,
+                    size_t count);
+
+                /**
+                 *  first = beta1 * first + rate * g
+                 *  weights[i] += first
+                 */
+                Optimizer_kernel sgd;
+
+                /**
+                 *  first = beta1 * first + rate * g
+                 *  weights[i] += beta1 * first + rate * g
+                 */
+                Optimizer_kernel nesterov;
+
+                /**
+                 *  second = beta2 * second + (1 - beta2) * g * g
+                 *  weights[i] += rate * g / (sqrt(second) + epsilon)
+                 */
+                Optimizer_kernel rmsprop;
+
+                /**
+                 *  first = beta1 * first + (1 - beta1) * g
+                 *  second = beta2 * second + (1 - beta2) * g * g
+                 *  weights[i] += rate * first / (sqrt(second) + epsilon)
+                 */
+                Optimizer_kernel adam;
+
+                /**
+                 * Update of the weights of a layer of which some are pruned, the
+                 * same as an optimizer kernel (adjust and apply for the classic
+                 * rule, first being the momentums), but the weights and the state
+                 * where mask[i] is 0 are set back to 0, and do not add to the errors.
+                 */
+                typedef void (*Masked_kernel)(
+                    const Step<T> &step,
+                    T scale,
+                    const T *gradients,
+                    const uint8_t *mask,
+                    T *weights,
+                    T *first,
+                    T *second,
+                    T *errors,
+                    size_t count);
+
+                /** Class Masked: the masked kernel of each rule */
+                struct Masked
+                {
+                        Masked_kernel classic;
+                        Masked_kernel sgd;
+                        Masked_kernel nesterov;
+                        Masked_kernel rmsprop;
+                        Masked_kernel adam;
+                } masked;
+
+                // Fast activation functions, applied in place. They are the vectorized
+                // versions of functions::fast, with the same error bounds.
+
+                /** values[i] = 1 / (1 + e^-values[i]) */
+                void (*fast_sigmoid)(T *values, size_t count);
+
+                /** values[i] = tanh(values[i]) */
+                void (*fast_tanh)(T *values, size_t count);
+
+                /** values[i] = log(1 + e^values[i]) */
+                void (*fast_softplus)(T *values, size_t count);
+
+                /**
+                 * values[i] = e^(values[i] - shift)
+                 *
+                 * @return the sum of the new values.
+                 */
+                T (*fast_exp_sum)(T *values, T shift, size_t count);
+        };
+
+        /** Class Int8_table: kernels of the quantized inference */
+        struct Int8_table
+        {
+                Isa isa;          ///< Instruction set used by the implementations
+                const char *name; ///< Human readable name of the instruction set
+
+                /**
+                 * @return sum(x[i] * w[i]), for x[i] in [0, 127], so that pairs of
+                 * products never saturate 16 bits.
+                 */
+                int32_t (*dot)(const uint8_t *x, const int8_t *w, size_t count);
+        };
+
+        /**
+         * @return true if the CPU (and OS) support the given instruction set.
+         */
+        bool supported(Isa isa);
+
+        /**
+         * @return the kernels for the given instruction set, regardless of
+         * whether it is supported or not by the current CPU.
+         */
+        template <typename T>
+        const Table<T>& get(Isa isa);
+
+        /**
+         * @return the kernels used by the layers. Defaults to the widest
+         * instruction set supported by the current CPU.
+         */
+        template <typename T>
+        const Table<T>& active();
+
+        /**
+         * @return the quantized inference kernels for the given instruction set,
+         * using VNNI for AVX512 when available.
+         */
+        const Int8_table& get_int8(Isa isa);
+
+        /**
+         * @return the quantized inference kernels, for the instruction set of active().
+         */
+        const Int8_table& active_int8();
+
+        /**
+         * Override the kernels used by the layers.
+         *
+         * @param[in] isa Instruction set to use.
+         *
+         * @return false if the instruction set is not supported by the CPU.
+         */
+        bool select(Isa isa);
+
+        // Implementations for each instruction set
+        template <typename T> const Table<T>& scalar_table();
+        template <typename T> const Table<T>& sse2_table();
+        template <typename T> const Table<T>& avx2_table();
+        template <typename T> const Table<T>& avx512_table();
+
+        template <> const Table<double>& scalar_table<double>();
+        template <> const Table<float>& scalar_table<float>();
+        template <> const Table<double>& sse2_table<double>();
+        template <> const Table<float>& sse2_table<float>();
+        template <> const Table<double>& avx2_table<double>();
+        template <> const Table<float>& avx2_table<float>();
+        template <> const Table<double>& avx512_table<double>();
+        template <> const Table<float>& avx512_table<float>();
+
+        const Int8_table& scalar_int8_table();
+        const Int8_table& avx2_int8_table();
+        const Int8_table& avx512_int8_table();
+        const Int8_table& vnni_int8_table();
+
+    } /* namespace kernels */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_KERNELS_HPP_ */
@@ -1,105 +1,275 @@
-/**
- * @file Layer.hpp
- *
- * @brief Basic layer used for backpropagation.
- *
- * @author Nicolae Natea
- * Contact: nicu@natea.ro
- */
-
-#ifndef _BACKPROPAGATION_LAYER_HPP_
-#define _BACKPROPAGATION_LAYER_HPP_
-
-#include <stdint.h>
-
-#include <iostream>
-#include <vector>
-
-#include "functions/Activation_function.hpp"
-#include "Neuron.hpp"
-
-namespace BackPropagation
-{
-    /** Class layer */
-    class Layer
-    {
-        private:
-            std::vector<double> m_output;  ///< Result of the last propagation request
-            std::vector<double> m_errors;  ///< Errors to be backpropagated to the input layer
-            std::vector<Neuron> m_neurons; ///< Neurons in the current layer
-
-            // Construction
-        public:
-            /**
-             * @param[in] nbrOfNeurons Number of neurons in the current layer.
-             * @param[in] nbrOfInputs  Number of incoming connections for the current layer.
-             * @param[in] func         Structure containing the activation function and its derivative
-             */
-            Layer(
-                size_t nbrOfNeurons,
-                size_t nbrOfInputs,
-                functions::Activation_function_cPtr &func);
-
-            // Methods
-        public:
-            void save();
-            void restore();
-
-            /**
-             * @return number of neurons in the current layer.
-             */
-            size_t size() const;
-
-            /**
-             * @return the result of the last propagation request.
-             */
-            const std::vector<double>& output() const;
-
-            /**
-             * Set the outputs of the current layer.
-             * The intention of the method is to be used for the input layer,
-             * for which the neurons shall not perform any computation.
-             *
-             * @param[in] outputs to be set
-             */
-            void set_output(const std::vector<double> &outputs);
-
-            /**
-             * Propagate the received inputs through the current layer and
-             * update the current outputs.
-             *
-             * @param[in] inputs to propagate
-             */
-            void propagate(const std::vector<double> &inputs);
-
-            /**
-             * Adjust the managed neurons based on the detected error for
-             * a given input.
-             *
-             * @param[in] inputs      used for propapgation
-             * @param[in] ouputErrors errors detected for the given inputs
-             */
-            const std::vector<double>& back_propagate(
-                const std::vector<double> &inputs,
-                const std::vector<double> &ouputErrors);
-
-            /**
-             * Compute the difference between the current output and a given target.
-             *
-             * @param[in] target to compare the current output against.
-             */
-            const std::vector<double> compute_errors(const std::vector<double> &target);
-
-            /**
-             * Compute the mean error for the whole layer
-             *
-             * @param[in] expected target output.
-             */
-            double get_mean_error(const std::vector<double> &expected);
-
-            friend std::ostream& operator<<(std::ostream &output, const Layer &layer);
-    };
-
-} /* namespace BackPropagation */
-
-#endif /* _BACKPROPAGATION_LAYER_HPP_ */
+/**
+ * @file Layer.hpp
+ *
+ * @brief Basic layer used for backpropagation.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_LAYER_HPP_
+#define _BACKPROPAGATION_LAYER_HPP_
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include "functions/Activation_function.hpp"
+#include "Matrix.hpp"
+#include "Optimizer.hpp"
+#include "Training_data.hpp"
+
+namespace BackPropagation
+{
+    /** Class layer, for a scalar type T */
+    template <typename T = double>
+    class Layer
+    {
+        private:
+            Matrix<T> m_weights;                           ///< Input weights, one row per neuron
+            Matrix<T> m_momentums;                         ///< Momentum used for adjusting weights
+            Matrix<T> m_squares;                           ///< Mean squares of the gradients, for RMSProp and Adam
+            std::vector<uint8_t> m_mask;                   ///< 1 for the weights kept, 0 for the pruned ones, empty if not pruned
+            Optimizer m_optimizer;                         ///< Optimizer the state is kept for
+            functions::Activation_function_cPtr<T> m_func; ///< Layer activation function
+
+            /**
+             * Set the pruned weights, and their optimizer state, to 0. The updates
+             * keep them at 0 afterwards, with the masked kernels.
+             */
+            void apply_mask();
+
+            template <typename U>
+            friend class Layer;
+
+            // Construction
+        public:
+            /**
+             * @param[in] nbrOfNeurons Number of neurons in the current layer.
+             * @param[in] nbrOfInputs  Number of incoming connections for the current layer.
+             * @param[in] func         Structure containing the activation function and its derivative
+             * @param[in] rng          Generator used for the initial weights
+             */
+            Layer(
+                size_t nbrOfNeurons,
+                size_t nbrOfInputs,
+                functions::Activation_function_cPtr<T> &func,
+                std::mt19937 &rng);
+
+            /**
+             * Convert the parameters of a layer using another scalar type.
+             *
+             * @param[in] other layer to convert.
+             * @param[in] func  activation function to use for the current scalar type.
+             */
+            template <typename U>
+            Layer(const Layer<U> &other, const functions::Activation_function_cPtr<T> &func) :
+                m_weights(other.weights().rows(), other.weights().cols()),
+                m_momentums(other.weights().rows(), other.weights().cols()),
+                m_mask(other.m_mask),
+                m_optimizer(Optimizer::CLASSIC),
+                m_func(func)
+            {
+                std::copy(other.weights().data(), other.weights().data() + other.weights().size(), m_weights.data());
+            }
+
+            // Methods
+        public:
+            /**
+             * @return number of neurons in the current layer.
+             */
+            size_t size() const;
+
+            /**
+             * @return number of incoming connections for the current layer.
+             */
+            size_t inputs() const;
+
+            /**
+             * Propagate the received inputs through the current layer.
+             *
+             * @param[in]  inputs  to propagate, inputs() values
+             * @param[out] outputs of the layer, size() values
+             */
+            void propagate(const T *inputs, T *outputs) const;
+
+            /**
+             * Adjust the weights of the layer based on the detected error for
+             * a given input and compute the error for the previous layer.
+             *
+             * @param[in]  inputs      used for propagation
+             * @param[in]  outputs     obtained for the given inputs
+             * @param[in]  ouputErrors errors detected for the given inputs
+             * @param[out] deltas      local gradient of each neuron
+             * @param[out] inputErrors errors to be backpropagated to the input layer
+             * @param[in]  update      optimizer step, for the optimizer given to set_optimizer()
+             */
+            void back_propagate(
+                const T *inputs,
+                const T *outputs,
+                const T *ouputErrors,
+                T *deltas,
+                T *inputErrors,
+                const Update<T> &update = Update<T>());
+
+            /**
+             * Propagate sparse inputs through the current layer, reading only
+             * the weights of the non-zero inputs.
+             *
+             * @param[in]  inputs  to propagate, all below inputs()
+             * @param[out] outputs of the layer, size() values
+             */
+            void propagate(const Sparse_inputs<T> &inputs, T *outputs) const;
+
+            /**
+             * Adjust the weights of the layer for sparse inputs, touching only
+             * the weights of the non-zero inputs. No errors are computed for
+             * the inputs, this is meant for the first layer.
+             *
+             * With Optimizer::CLASSIC the momentums left by the previous sample,
+             * which the dense update adds to the weights of the inputs which are
+             * now zero, are applied too, so the result is the one of the dense
+             * update. The other optimizers update lazily: the state of the
+             * weights of zero inputs is left as is.
+             *
+             * @param[in]     inputs       used for propagation
+             * @param[in]     pending      inputs whose momentums may not be zero, those
+             *                             of the previous sample, nullptr for all the inputs
+             * @param[in]     pendingCount number of pending inputs
+             * @param[in]     outputs      obtained for the given inputs
+             * @param[in]     ouputErrors  errors detected for the given inputs
+             * @param[out]    deltas       local gradient of each neuron
+             * @param[in,out] scratch      buffer of the optimizers other than Optimizer::CLASSIC
+             * @param[in]     update       optimizer step, for the optimizer given to set_optimizer()
+             */
+            void back_propagate(
+                const Sparse_inputs<T> &inputs,
+                const uint32_t *pending,
+                size_t pendingCount,
+                const T *outputs,
+                const T *ouputErrors,
+                T *deltas,
+                std::vector<T> &scratch,
+                const Update<T> &update = Update<T>());
+
+            /**
+             * Propagate a batch of inputs through the current layer.
+             *
+             * @param[in]  inputs  to propagate, one row per sample
+             * @param[out] outputs of the layer, one row per sample
+             */
+            void propagate(const Matrix<T> &inputs, Matrix<T> &outputs) const;
+
+            /**
+             * Compute the weight gradients summed over a batch, and the errors
+             * for the previous layer, without adjusting the weights.
+             *
+             * @param[in]  inputs      used for propagation, one row per sample
+             * @param[in]  outputs     obtained for the given inputs
+             * @param[in]  ouputErrors errors detected for the given inputs
+             * @param[out] deltas      local gradients of each neuron, for each sample
+             * @param[out] inputErrors errors to be backpropagated to the input layer
+             * @param[out] gradients   weight gradients, same shape as the weights
+             */
+            void compute_gradients(
+                const Matrix<T> &inputs,
+                const Matrix<T> &outputs,
+                const Matrix<T> &ouputErrors,
+                Matrix<T> &deltas,
+                Matrix<T> &inputErrors,
+                Matrix<T> &gradients) const;
+
+            /**
+             * Adjust a range of the weights of the layer from accumulated gradients.
+             *
+             * @param[in] gradients weight gradients, same shape as the weights
+             * @param[in] scale     applied to the gradients (e.g. 1 / batch size)
+             * @param[in] first     index of the first weight to adjust
+             * @param[in] last      index past the last weight to adjust
+             * @param[in] update    optimizer step, for the optimizer given to set_optimizer()
+             */
+            void apply_gradients(
+                const Matrix<T> &gradients,
+                T scale,
+                size_t first,
+                size_t last,
+                const Update<T> &update = Update<T>());
+
+            /**
+             * Select the optimizer of the following updates. Its state is reset
+             * when it changes.
+             *
+             * @param[in] optimizer to use.
+             */
+            void set_optimizer(Optimizer optimizer);
+
+            /**
+             * Prune the weights whose magnitude is below a threshold: they are
+             * set to 0 and stay 0 through the following updates.
+             *
+             * @param[in] threshold magnitude below which the weights are pruned.
+             *
+             * @return number of weights pruned, including those pruned before.
+             */
+            size_t prune(T threshold);
+
+            /**
+             * @return number of pruned weights.
+             */
+            size_t pruned() const;
+
+            /**
+             * @return number of weights of the layer.
+             */
+            size_t parameters() const;
+
+            /**
+             * @return number of values written by save().
+             */
+            size_t snapshot_size() const;
+
+            /**
+             * Copy the weights and the optimizer state of the layer into a buffer.
+             *
+             * @param[out] buffer of at least snapshot_size() values.
+             *
+             * @return the position in the buffer after the layer's values.
+             */
+            T* save(T *buffer) const;
+
+            /**
+             * Load the weights and the optimizer state of the layer written by save().
+             *
+             * @param[in] buffer holding the values.
+             *
+             * @return the position in the buffer after the layer's values.
+             */
+            const T* restore(const T *buffer);
+
+            /**
+             * Copy the weights and the optimizer state of a layer of the same shape.
+             *
+             * @param[in] other layer to copy the parameters from.
+             */
+            void copy_parameters(const Layer &other);
+
+            /**
+             * @return the weights of the layer, one row per neuron.
+             */
+            const Matrix<T>& weights() const;
+
+            /**
+             * @return the activation function of the layer.
+             */
+            const functions::Activation_function_cPtr<T>& function() const;
+
+            template <typename U>
+            friend std::ostream& operator<<(std::ostream &output, const Layer<U> &layer);
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_LAYER_HPP_ */
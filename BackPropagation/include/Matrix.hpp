@@ -0,0 +1,171 @@
+/**
+ * @file Matrix.hpp
+ *
+ * @brief Dense, row-major matrix stored in a single aligned buffer.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_MATRIX_HPP_
+#define _BACKPROPAGATION_MATRIX_HPP_
+
+#include <stdint.h>
+
+#include "Aligned_allocator.hpp"
+
+namespace BackPropagation
+{
+    /** Class Matrix */
+    template <typename T = double>
+    class Matrix
+    {
+        private:
+            size_t m_rows;                 ///< Number of rows
+            size_t m_cols;                 ///< Number of columns
+            Aligned_vector<T> m_data;      ///< Row-major storage
+
+            // Construction
+        public:
+            /**
+             * @param[in] rows  Number of rows.
+             * @param[in] cols  Number of columns.
+             * @param[in] value Initial value of all the elements.
+             */
+            Matrix(size_t rows = 0, size_t cols = 0, T value = T()) :
+                m_rows(rows), m_cols(cols), m_data(rows * cols, value)
+            {
+            }
+
+            /**
+             * Empty matrix, whose storage comes from the given allocator.
+             *
+             * @param[in] allocator e.g. on a Workspace arena.
+             */
+            explicit Matrix(const Aligned_allocator<T> &allocator) :
+                m_rows(0), m_cols(0), m_data(allocator)
+            {
+            }
+
+            // Methods
+        public:
+            /**
+             * Change the shape of the matrix. The storage is reused when
+             * the new shape does not exceed the current capacity.
+             *
+             * @param[in] rows Number of rows.
+             * @param[in] cols Number of columns.
+             */
+            void resize(size_t rows, size_t cols)
+            {
+                m_rows = rows;
+                m_cols = cols;
+                m_data.resize(rows * cols);
+            }
+
+            /**
+             * Allocate the storage for up to count elements, so that resizing
+             * within that limit does not allocate.
+             *
+             * @param[in] count Number of elements.
+             */
+            void reserve(size_t count)
+            {
+                m_data.reserve(count);
+            }
+
+            size_t rows() const
+            {
+                return m_rows;
+            }
+
+            size_t cols() const
+            {
+                return m_cols;
+            }
+
+            /**
+             * @return number of elements of the matrix.
+             */
+            size_t size() const
+            {
+                return m_data.size();
+            }
+
+            T* data()
+            {
+                return m_data.data();
+            }
+
+            const T* data() const
+            {
+                return m_data.data();
+            }
+
+            T* row(size_t index)
+            {
+                return m_data.data() + index * m_cols;
+            }
+
+            const T* row(size_t index) const
+            {
+                return m_data.data() + index * m_cols;
+            }
+
+            T& operator()(size_t row, size_t col)
+            {
+                return m_data[row * m_cols + col];
+            }
+
+            T operator()(size_t row, size_t col) const
+            {
+                return m_data[row * m_cols + col];
+            }
+    };
+
+    /**
+     * C = A * transpose(B)
+     *
+     * @param[in]  a Matrix of size (m x k).
+     * @param[in]  b Matrix of size (n x k).
+     * @param[out] c Matrix of size (m x n).
+     */
+    template <typename T>
+    void multiply_abt(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c);
+
+    /**
+     * C = A * transpose(B), on row-major buffers not owned by a Matrix.
+     *
+     * @param[in]  a Buffer of size (m x k).
+     * @param[in]  m Number of rows of A.
+     * @param[in]  k Number of columns of A and B.
+     * @param[in]  b Buffer of size (n x k).
+     * @param[in]  n Number of rows of B.
+     * @param[out] c Buffer of size (m x n).
+     */
+    template <typename T>
+    void multiply_abt(const T *a, size_t m, size_t k, const T *b, size_t n, T *c);
+
+    /**
+     * C = A * B
+     *
+     * @param[in]  a Matrix of size (m x k).
+     * @param[in]  b Matrix of size (k x n).
+     * @param[out] c Matrix of size (m x n).
+     */
+    template <typename T>
+    void multiply_ab(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c);
+
+    /**
+     * C = transpose(A) * B
+     *
+     * @param[in]  a Matrix of size (k x m).
+     * @param[in]  b Matrix of size (k x n).
+     * @param[out] c Matrix of size (m x n).
+     */
+    template <typename T>
+    void multiply_atb(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c);
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_MATRIX_HPP_ */
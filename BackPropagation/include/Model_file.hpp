@@ -0,0 +1,209 @@
+/**
+ * @file Model_file.hpp
+ *
+ * @brief Binary model format, and networks running directly on the
+ *        weights of a memory mapped model file.
+ *
+ * Layout (native byte order, every offset relative to the start of the file):
+ *  - model::Header
+ *  - one model::Layer_record per layer, the first one being the input layer
+ *  - the weights of each layer, row-major, each matrix aligned to ALIGNMENT.
+ *    The layers with enough zero weights (pruned, see Network::prune()) are
+ *    stored as compressed sparse rows instead: the non-zero weights row by
+ *    row, the first weight of each row, and the input index of each weight,
+ *    each array aligned to ALIGNMENT.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_MODEL_FILE_HPP_
+#define _BACKPROPAGATION_MODEL_FILE_HPP_
+
+#include <stdint.h>
+
+#include <string>
+#include <vector>
+
+#include "functions/Activation_function.hpp"
+#include "Network.hpp"
+#include "Workspace.hpp"
+
+namespace BackPropagation
+{
+    namespace model
+    {
+        constexpr char MAGIC[8] = { 'B', 'P', 'M', 'O', 'D', 'E', 'L', 0 };
+        constexpr uint32_t VERSION = 2;
+        constexpr uint32_t BYTE_ORDER_MARK = 0x01020304;  ///< Written natively, to detect foreign files
+        constexpr size_t NAME_LENGTH = 32;
+
+        /** Class Header: start of a model file */
+        struct Header
+        {
+                char magic[8];          ///< MAGIC
+                uint32_t version;       ///< VERSION
+                uint32_t byte_order;    ///< BYTE_ORDER_MARK
+                uint32_t scalar_size;   ///< Size of the scalar type of the weights, in bytes
+                uint32_t layers;        ///< Number of layers, including the input layer
+                uint64_t file_size;     ///< Size of the whole file, in bytes
+        };
+
+        /** Class Layer_record: description of one layer */
+        struct Layer_record
+        {
+                uint32_t neurons;               ///< Number of neurons
+                uint32_t inputs;                ///< Number of incoming connections
+                char activation[NAME_LENGTH];   ///< Activation_function::name(), zero terminated
+                uint64_t weights;               ///< Offset of the weights (neurons x inputs), or of the non-zero ones
+                uint64_t nonzeros;              ///< Number of non-zero weights of a sparse layer
+                uint64_t row_starts;            ///< Offset of the first weight of each row and the end, 0 for a dense layer
+                uint64_t columns;               ///< Offset of the input index of each non-zero weight
+        };
+
+    } /* namespace model */
+
+    /**
+     * Write the topology, the activation functions and the weights of a
+     * network in the binary model format.
+     *
+     * @param[in] network     to write.
+     * @param[in] path        of the file to create.
+     * @param[in] minSparsity fraction of zero weights from which a layer is written
+     *                        as compressed sparse rows, as in Sparse_network.
+     *
+     * Throws std::runtime_error if the file can not be written, and
+     * std::invalid_argument if an activation function has no name.
+     */
+    template <typename T>
+    void save_model(const Network<T> &network, const std::string &path, double minSparsity = 0.5);
+
+    /**
+     * Class Mapped_network
+     *
+     * Read-only network whose weights stay in a memory mapped model file:
+     * loading costs no copy, and the processes mapping the same file share
+     * a single copy of the weights in the page cache. The sparse layers
+     * only read and multiply their non-zero weights, see Sparse_network.
+     */
+    template <typename T = double>
+    class Mapped_network
+    {
+        private:
+            /** Class Mapped_layer */
+            struct Mapped_layer
+            {
+                    size_t neurons;                                 ///< Number of neurons
+                    size_t inputs;                                  ///< Number of incoming connections
+                    const T *weights;                               ///< Weights inside the mapping, one row per neuron, or the non-zero ones
+                    const uint32_t *row_starts;                     ///< First weight of each row and the end, nullptr for a dense layer
+                    const uint32_t *columns;                        ///< Input index of each weight of a sparse layer
+                    functions::Activation_function_cPtr<T> func;    ///< Layer activation function
+            };
+
+            void *m_address;                       ///< Start of the mapping
+            size_t m_length;                       ///< Size of the mapping
+            std::vector<Mapped_layer> m_layers;    ///< Layers, the first one being the input layer
+
+            /**
+             * Weighted sums of the neurons of a layer, for one sample.
+             *
+             * @param[in]  layer  to propagate through.
+             * @param[in]  inputs of the layer.
+             * @param[out] sums   of each neuron, before the activation function.
+             */
+            static void propagate(const Mapped_layer &layer, const T *inputs, T *sums);
+
+            // Construction
+        public:
+            /**
+             * Map a model file written by save_model() for the same scalar type.
+             *
+             * @param[in] path of the model file.
+             *
+             * Throws std::runtime_error if the file can not be mapped or is
+             * not a valid model, and std::invalid_argument if an activation
+             * function is unknown.
+             */
+            explicit Mapped_network(const std::string &path);
+            ~Mapped_network();
+
+            Mapped_network(const Mapped_network&) = delete;
+            Mapped_network& operator=(const Mapped_network&) = delete;
+
+            // Methods
+        public:
+            /**
+             * Thread safe inference on a batch of samples, see Network::test().
+             *
+             * @param[in]  workspace for the calling thread, see create_workspace().
+             * @param[in]  inputs    of the samples, inputs() consecutive values per sample.
+             * @param[in]  count     number of samples.
+             * @param[out] outputs   of the network, outputs() consecutive values per sample.
+             */
+            void test(Workspace<T> &workspace, const T *inputs, size_t count, T *outputs) const;
+
+            /**
+             * @param[in] batchSize largest number of samples passed at once to test().
+             *
+             * @return a workspace for calling test() from one thread.
+             */
+            Workspace<T> create_workspace(size_t batchSize = 1) const;
+
+            /**
+             * @return number of inputs of the network.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of outputs of the network.
+             */
+            size_t outputs() const;
+
+            /**
+             * @return number of layers, including the input layer.
+             */
+            size_t layers() const;
+
+            /**
+             * @param[in] layer index, 0 being the input layer.
+             *
+             * @return number of neurons of the layer.
+             */
+            size_t size(size_t layer) const;
+
+            /**
+             * @param[in] layer index, from 1.
+             *
+             * @return true if the layer is stored as compressed sparse rows.
+             */
+            bool sparse(size_t layer) const;
+
+            /**
+             * @param[in] layer index, from 1.
+             *
+             * @return weights of the layer inside the mapping, one row of
+             *         size(layer - 1) values per neuron, or the non-zero ones
+             *         row by row for a sparse layer.
+             */
+            const T* weights(size_t layer) const;
+
+            /**
+             * Copy the weights of a layer, dense or sparse, as dense rows.
+             *
+             * @param[in]  layer   index, from 1.
+             * @param[out] weights size(layer) rows of size(layer - 1) values.
+             */
+            void copy_weights(size_t layer, T *weights) const;
+
+            /**
+             * @param[in] layer index, from 1.
+             *
+             * @return activation function of the layer.
+             */
+            functions::Activation_function_cPtr<T> function(size_t layer) const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_MODEL_FILE_HPP_ */
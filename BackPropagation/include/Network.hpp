@@ -1,115 +1,599 @@
-/**
- * @file Network.hpp
- *
- * @brief Backpropagation neural network.
- *
- * @author Nicolae Natea
- * Contact: nicu@natea.ro
- */
-
-#ifndef _BACKPROPAGATION_NETWORK_HPP_
-#define _BACKPROPAGATION_NETWORK_HPP_
-
-#include <vector>
-#include <iostream>
-
-#include "functions/Activation_function.hpp"
-#include "Layer.hpp"
-#include "Training_data.hpp"
-
-namespace BackPropagation
-{
-    /** Class Network */
-    class Network
-    {
-        public:
-            /** Class Settings */
-            struct Settings
-            {
-                    uint32_t max_iterations; ///< The maximum number of iterations used to train the network
-                    double target_error;     ///< The error at which the network is considered as trained
-                    /**
-                     * Value between 0 and 1, to trigger a store of the current state
-                     * of the network if the error decreases below
-                     * (prev_error * store_threshold)
-                     */
-                    double store_threshold;
-                    /** Value equal or greater than 1, to trigger a restore to a
-                     * previous state of the network if the error increases beyond
-                     * (prev_error * restore_threshold)
-                     */
-                    double restore_threshold;
-
-                    // Construction
-                public:
-                    Settings(
-                        uint32_t maxIterations,
-                        double targetError,
-                        double storeThreshold,
-                        double restoreThreshold);
-            };
-        private:
-            std::vector<Layer> m_layers;               ///< Network layers
-            std::vector<Layer> m_layers_restore_point; ///< Network layers backup
-
-            /**
-             * Run a training session on the passed data.
-             *
-             * @param[in] trainingData Data set to be used in the training process.
-             * @param[in] order in which to process the training data.
-             * @param[in] settings Network related configuration.
-             */
-            double iterate(
-                const std::vector<Training_data> &trainingData,
-                const std::vector<uint32_t> &order,
-                const Settings &settings);
-
-            /**
-             * Propagate the given inputs through the network.
-             *
-             * @param[in] inputs to propagate through the network.
-             */
-            void propagate(const std::vector<double> &inputs);
-
-            /** Store the current network state */
-            void save();
-
-            /** Restore a previous network state */
-            void restore();
-
-            // Construction
-        public:
-            /**
-             * @param[in] layersInfo Collection containg information about each layer of the network.
-             */
-            Network(
-                std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr>> layersInfo);
-            Network(std::vector<std::uint32_t> layers, functions::Activation_function_cPtr func);
-            ~Network();
-
-            // Methods
-        public:
-            /**
-             * Method for triggering a training session.
-             *
-             * @param[in] trainingData Data set to be used in the training process.
-             * @param[in] settings Network related configuration.
-             *
-             * @return global network error at the end of training.
-             */
-            double train(const std::vector<Training_data> &trainingData, const Settings &settings);
-
-            /**
-             * Method for testing output of the network for a given input.
-             *
-             * @param[in] input Data set fed to the network.
-             *
-             * @return output of the network for the given input.
-             */
-            std::vector<double> test(const std::vector<double> &input);
-
-            friend std::ostream& operator<<(std::ostream &output, const Network &net);
-    };
-} /* namespace BackPropagation */
-
-#endif /* _BACKPROPAGATION_NETWORK_HPP_ */
+/**
+ * @file Network.hpp
+ *
+ * @brief Backpropagation neural network.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_NETWORK_HPP_
+#define _BACKPROPAGATION_NETWORK_HPP_
+
+#include <functional>
+#include <vector>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+#include "functions/Activation_function.hpp"
+#include "Layer.hpp"
+#include "Optimizer.hpp"
+#include "Samples.hpp"
+#include "Training_data.hpp"
+#include "Workspace.hpp"
+
+namespace BackPropagation
+{
+    class Thread_pool;
+
+    /** Class Network, for a scalar type T */
+    template <typename T = double>
+    class Network
+    {
+        public:
+            /** Strategies for training on multiple threads */
+            enum class Parallel_mode
+            {
+                /**
+                 * Each batch is split between the threads, the gradients are
+                 * summed and the weights are updated once per batch.
+                 * Reproducible for a given seed and number of threads.
+                 */
+                SYNCHRONOUS,
+                /**
+                 * Each thread trains on its share of the epoch and updates the
+                 * shared weights without any locking (Hogwild).
+                 */
+                HOGWILD
+            };
+
+            /** Strategies for computing the error at the end of each epoch */
+            enum class Evaluation
+            {
+                /** Forward pass over the whole data set, after the epoch */
+                FULL,
+                /**
+                 * Accumulate the errors of the forward passes done for training.
+                 * No additional cost, but each error is measured before the update
+                 * made for its sample.
+                 */
+                TRAINING,
+                /** Forward pass over a random subset of evaluation_samples samples, fixed per session */
+                SUBSAMPLE,
+                /** Full evaluation every evaluation_period epochs, no store/restore in between */
+                PERIODIC,
+                /**
+                 * Full evaluation of a copy of the weights on a background thread,
+                 * while the next epoch is trained. The store/restore decisions are
+                 * taken one epoch late, on the evaluated copy.
+                 */
+                PARALLEL
+            };
+
+            /** Class Epoch_report: what happened during one training epoch */
+            struct Epoch_report
+            {
+                    uint32_t epoch;            ///< Number of epochs trained so far, starting at 1
+                    /**
+                     * Latest error computed according to Settings::evaluation. It
+                     * may be the error of an earlier epoch with Evaluation::PERIODIC
+                     * and Evaluation::PARALLEL.
+                     */
+                    double error;
+                    double training_error;     ///< Average error measured while training the epoch
+                    /**
+                     * Seconds spent propagating forward while training, per thread
+                     * (the sum over all threads divided by their number)
+                     */
+                    double forward_time;
+                    /** Seconds spent back-propagating and updating the weights, per thread */
+                    double backward_time;
+                    double training_time;      ///< Wall time of the training pass, including the synchronization
+                    /**
+                     * Wall time spent computing the error. With Evaluation::PARALLEL
+                     * only the time the training waited for the evaluation thread.
+                     */
+                    double evaluation_time;
+                    double snapshot_time;      ///< Wall time spent storing and restoring the network state
+                    double samples_per_second; ///< Samples trained per second of the whole epoch
+                    /**
+                     * Latest validation error, of the parameters of an earlier
+                     * epoch as the validation runs along the training. 0 without
+                     * validation data or before the first validation.
+                     */
+                    double validation_error;
+                    uint32_t stores;           ///< Number of stores of the network state since the start of train()
+                    uint32_t restores;         ///< Number of restores since the start of train()
+            };
+
+            /**
+             * Called by train() at the end of each epoch. Returning true stops
+             * the training, which then ends as if max_iterations were reached.
+             */
+            typedef std::function<bool(const Epoch_report &report)> Observer;
+
+            /** Class Settings */
+            struct Settings
+            {
+                    uint32_t max_iterations; ///< The maximum number of iterations used to train the network
+                    double target_error;     ///< The error at which the network is considered as trained
+                    /**
+                     * Value between 0 and 1, to trigger a store of the current state
+                     * of the network if the error decreases below
+                     * (prev_error * store_threshold)
+                     */
+                    double store_threshold;
+                    /** Value equal or greater than 1, to trigger a restore to a
+                     * previous state of the network if the error increases beyond
+                     * (prev_error * restore_threshold)
+                     */
+                    double restore_threshold;
+                    /**
+                     * Number of samples propagated together, with a single weight
+                     * update per batch. A value of 1 selects per-sample training.
+                     */
+                    uint32_t batch_size;
+                    /**
+                     * Number of threads used for training, 1 by default.
+                     * In SYNCHRONOUS mode batches smaller than the number of threads
+                     * are extended to one sample per thread.
+                     */
+                    uint32_t threads;
+                    Parallel_mode parallel_mode; ///< Strategy used when training on multiple threads
+                    Evaluation evaluation;       ///< Strategy for computing the error of each epoch, FULL by default
+                    uint32_t evaluation_samples; ///< Number of samples evaluated by Evaluation::SUBSAMPLE
+                    uint32_t evaluation_period;  ///< Number of epochs between evaluations for Evaluation::PERIODIC
+                    /**
+                     * Number of consecutive samples trained on before moving to
+                     * the next chunk, 0 (default) for the whole data set. The
+                     * chunks are visited in random order, their samples shuffled,
+                     * and their boundaries move at every epoch. Mapped samples of
+                     * a chunk are released once it is done, which bounds the memory
+                     * used by data sets larger than the RAM.
+                     */
+                    uint32_t chunk_size;
+                    /**
+                     * Called at the end of each epoch, none by default. Without an
+                     * observer nothing is timed.
+                     */
+                    Observer observer;
+                    /**
+                     * Measure the durations reported to the observer, true by
+                     * default. Timing every sample slows down the training of
+                     * small networks, observers only looking at the errors can
+                     * turn it off.
+                     */
+                    bool timing;
+                    /**
+                     * With validation data, number of epochs in a row without a
+                     * lower validation error after which the training stops, 10
+                     * by default.
+                     */
+                    uint32_t patience;
+                    /**
+                     * Back the training workspaces with transparent huge pages,
+                     * false by default. Only worth it for large layers or batches.
+                     */
+                    bool huge_pages;
+                    Optimizer optimizer;         ///< Rule for adjusting the weights, Optimizer::CLASSIC by default
+                    /**
+                     * Scale of the updates, 0.01 by default. Not used by
+                     * Optimizer::CLASSIC. SGD usually needs a larger one.
+                     */
+                    double learning_rate;
+                    double learning_rate_decay;  ///< Factor applied to the learning rate after each epoch, 1 by default
+                    double momentum;             ///< Momentum of SGD and NESTEROV, decay of Adam's mean gradient (0.9)
+                    double squares_decay;        ///< Decay of the mean squares of RMSPROP and ADAM (0.999)
+                    double epsilon;              ///< Added to the root mean squares of RMSPROP and ADAM (1e-8)
+
+                    // Construction
+                public:
+                    Settings(
+                        uint32_t maxIterations,
+                        double targetError,
+                        double storeThreshold,
+                        double restoreThreshold,
+                        uint32_t batchSize = 1);
+            };
+        private:
+            std::vector<Layer<T>> m_layers;            ///< Network layers
+            Aligned_vector<T> m_restore_point;         ///< Parameters of all the layers, as of the last save()
+            std::vector<Workspace<T>> m_workspaces;   ///< One per training thread, the first one is used otherwise
+            std::vector<size_t> m_chunk_starts;       ///< First sample of each chunk of the current epoch
+            Update<T> m_update;                        ///< Optimizer step of the current epoch
+            std::mt19937 m_rng;                        ///< Generator for the initial weights and the training order
+
+            /**
+             * Run a training session on the passed data.
+             * The error accumulated while training is returned, the error of the
+             * resulting network is computed according to the Settings::evaluation.
+             *
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in] order in which to process the training data.
+             * @param[in] settings Network related configuration.
+             * @param[in] pool Threads to train on, nullptr for single threaded training.
+             */
+            double iterate(
+                const Samples<T> &trainingData,
+                const std::vector<uint32_t> &order,
+                const Settings &settings,
+                Thread_pool *pool);
+
+            /**
+             * Training session, see train(). Without validation data (nullptr)
+             * only the training error is used.
+             */
+            double train_session(const Samples<T> &trainingData, const Samples<T> *validationData, const Settings &settings);
+
+            /**
+             * Train for one epoch, over the whole data set or chunk by chunk.
+             *
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in,out] order Buffer for the training order.
+             * @param[in] settings Network related configuration.
+             * @param[in] pool Threads to train on, nullptr for single threaded training.
+             *
+             * @return the average error measured during training.
+             */
+            double train_epoch(
+                const Samples<T> &trainingData,
+                std::vector<uint32_t> &order,
+                const Settings &settings,
+                Thread_pool *pool);
+
+            /**
+             * Compute the average error over a selection of the data set.
+             *
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in] samples indices of the samples to evaluate, nullptr for the whole data set.
+             * @param[in] count number of samples to evaluate.
+             * @param[in] settings Network related configuration (batch and chunk sizes).
+             * @param[in] pool Threads to evaluate on, nullptr to evaluate on the calling thread.
+             */
+            double evaluate(
+                const Samples<T> &trainingData,
+                const uint32_t *samples,
+                size_t count,
+                const Settings &settings,
+                Thread_pool *pool);
+
+            /**
+             * Train sample by sample on the samples [first, last) of the given order.
+             *
+             * @return the sum of the mean errors measured during training.
+             */
+            double train_samples(
+                Workspace<T> &workspace,
+                const Samples<T> &trainingData,
+                const std::vector<uint32_t> &order,
+                size_t first,
+                size_t last);
+
+            /**
+             * Train in batches of batchSize samples on the samples [first, last) of the given order.
+             *
+             * @return the sum of the mean errors measured during training.
+             */
+            double train_batches(
+                Workspace<T> &workspace,
+                const Samples<T> &trainingData,
+                const std::vector<uint32_t> &order,
+                size_t first,
+                size_t last,
+                size_t batchSize);
+
+            /**
+             * Train on all the threads of the pool, splitting each batch between them.
+             */
+            void train_synchronous(
+                const Samples<T> &trainingData,
+                const std::vector<uint32_t> &order,
+                const Settings &settings,
+                Thread_pool &pool);
+
+            /**
+             * Compute the gradients of all the layers for the samples [first, last)
+             * of the given order, without adjusting the weights.
+             *
+             * @return the sum of the mean errors of the samples.
+             */
+            double compute_gradients(
+                Workspace<T> &workspace,
+                const Samples<T> &trainingData,
+                const std::vector<uint32_t> &order,
+                size_t first,
+                size_t last) const;
+
+            /**
+             * @return the sum of the mean errors of the samples [first, last) of the selection.
+             */
+            double evaluate(
+                Workspace<T> &workspace,
+                const Samples<T> &trainingData,
+                const uint32_t *samples,
+                size_t first,
+                size_t last,
+                size_t batchSize) const;
+
+            /**
+             * Copy the samples [first, last) in the batch buffers of a workspace.
+             *
+             * @param[in] workspace to fill.
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in] order in which to process the training data, nullptr to take the samples in sequence.
+             * @param[in] first index of the first sample in the batch.
+             * @param[in] last index past the last sample in the batch.
+             */
+            void load_batch(
+                Workspace<T> &workspace,
+                const Samples<T> &trainingData,
+                const uint32_t *order,
+                size_t first,
+                size_t last) const;
+
+            /**
+             * @return the optimizer step for the next update made with the
+             * workspace, with Adam's bias corrections for its number of steps.
+             */
+            Update<T> next_update(Workspace<T> &workspace) const;
+
+            /**
+             * Propagate the given inputs through the network.
+             *
+             * @param[in] workspace holding the outputs of each layer.
+             * @param[in] inputs to propagate through the network, one value per input neuron.
+             */
+            void propagate(Workspace<T> &workspace, const T *inputs) const;
+
+            /**
+             * Propagate sparse inputs through the network.
+             *
+             * @param[in] workspace holding the outputs of each layer, but the input layer.
+             * @param[in] inputs to propagate through the network.
+             */
+            void propagate(Workspace<T> &workspace, const Sparse_inputs<T> &inputs) const;
+
+            /**
+             * Propagate a sample, whose inputs are dense or sparse, through the network.
+             *
+             * @param[in] workspace holding the outputs of each layer.
+             * @param[in] trainingData Data set holding the sample.
+             * @param[in] sample index of the sample.
+             */
+            void propagate(Workspace<T> &workspace, const Samples<T> &trainingData, size_t sample) const;
+
+            /**
+             * Propagate the batch loaded in the workspace through the network.
+             *
+             * @param[in] workspace holding the inputs and the outputs of each layer.
+             */
+            void propagate(Workspace<T> &workspace) const;
+
+            /**
+             * Store the current network state. Only the parameters are copied,
+             * into a buffer allocated by the first call.
+             */
+            void save();
+
+            /**
+             * Store the parameters of another network with the same topology
+             * as the current network state.
+             */
+            void save(const Network &source);
+
+            /** Restore a previous network state */
+            void restore();
+
+            /**
+             * Copy the parameters of another network with the same topology.
+             */
+            void copy_parameters(const Network &other);
+
+            // Construction
+        public:
+            /**
+             * @param[in] layersInfo Collection containg information about each layer of the network.
+             * @param[in] seed       Seed for the initial weights and the training order.
+             */
+            Network(
+                std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<T>>> layersInfo,
+                std::mt19937::result_type seed = std::random_device{}());
+            Network(
+                std::vector<std::uint32_t> layers,
+                functions::Activation_function_cPtr<T> func,
+                std::mt19937::result_type seed = std::random_device{}());
+
+            /**
+             * Convert a network to another scalar type, e.g. a trained double
+             * network to float for inference. The activation functions are
+             * recreated through functions::create().
+             *
+             * @param[in] other network to convert.
+             */
+            template <typename U>
+            explicit Network(const Network<U> &other) :
+                m_rng(std::random_device{}())
+            {
+                for (const auto &layer : other.layers())
+                {
+                    auto func = functions::create<T>(layer.function()->name());
+
+                    if (!func)
+                    {
+                        throw std::invalid_argument("Activation function can not be converted");
+                    }
+
+                    m_layers.push_back(Layer<T>(layer, func));
+                }
+
+                m_workspaces.emplace_back(m_layers);
+
+                // Save the current network state.
+                save();
+            }
+
+            ~Network();
+
+            // Methods
+        public:
+            /**
+             * Method for triggering a training session.
+             *
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in] settings Network related configuration.
+             *
+             * @return global network error at the end of training.
+             */
+            double train(const std::vector<Training_data<T>> &trainingData, const Settings &settings);
+
+            /**
+             * Method for triggering a training session on samples from any storage,
+             * e.g. Mapped_dataset::samples().
+             *
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in] settings Network related configuration.
+             *
+             * @return global network error at the end of training.
+             *
+             * Throws std::invalid_argument if the samples do not have the
+             * inputs and outputs of the network.
+             */
+            double train(const Samples<T> &trainingData, const Settings &settings);
+
+            /**
+             * Training session with early stopping on held-out validation data.
+             * The validation error of each epoch is computed on a copy of the
+             * parameters, on a background thread while the next epoch is trained.
+             * The training stops after Settings::patience epochs without a lower
+             * validation error, and the parameters with the lowest validation
+             * error are kept.
+             *
+             * @param[in] trainingData Data set to be used in the training process.
+             * @param[in] validationData Data set the validation error is computed on.
+             * @param[in] settings Network related configuration.
+             *
+             * @return global network error of the parameters kept, on the training data.
+             */
+            double train(
+                const std::vector<Training_data<T>> &trainingData,
+                const std::vector<Training_data<T>> &validationData,
+                const Settings &settings);
+
+            /**
+             * Training session with early stopping on validation data from any
+             * storage, see above. Throws std::invalid_argument if the samples do
+             * not have the inputs and outputs of the network.
+             */
+            double train(const Samples<T> &trainingData, const Samples<T> &validationData, const Settings &settings);
+
+            /**
+             * Compute the error of the network on a data set, as train() does
+             * with Evaluation::FULL.
+             *
+             * @param[in] data Data set to evaluate.
+             *
+             * @return the average of the mean absolute errors of the samples.
+             */
+            double evaluate(const std::vector<Training_data<T>> &data) const;
+
+            /**
+             * Compute the error of the network on samples from any storage, see
+             * above. Throws std::invalid_argument if the samples do not have the
+             * inputs and outputs of the network.
+             */
+            double evaluate(const Samples<T> &data) const;
+
+            /**
+             * Magnitude pruning: the weights with the smallest magnitudes over
+             * the whole network are set to 0. They stay 0 when the network is
+             * trained again, so that train() fine-tunes the remaining weights.
+             * See Sparse_network for running the pruned network.
+             *
+             * @param[in] sparsity fraction of the weights of the network to prune, in [0, 1].
+             */
+            void prune(double sparsity);
+
+            /**
+             * Magnitude pruning with a target per layer, see above.
+             *
+             * @param[in] sparsities fraction of the weights to prune in each
+             *                       layer, but the input layer.
+             */
+            void prune(const std::vector<double> &sparsities);
+
+            /**
+             * @return fraction of the weights of the network which are pruned.
+             */
+            double sparsity() const;
+
+            /**
+             * Method for testing output of the network for a given input.
+             *
+             * @param[in] input Data set fed to the network.
+             *
+             * @return output of the network for the given input.
+             */
+            std::vector<T> test(const std::vector<T> &input);
+
+            /**
+             * Thread safe inference on a batch of samples, without any memory
+             * allocation once the workspace is large enough for the batch.
+             * Concurrent calls must use different workspaces.
+             *
+             * @param[in]  workspace for the calling thread, see create_workspace().
+             * @param[in]  inputs    of the samples, inputs() consecutive values per sample.
+             * @param[in]  count     number of samples.
+             * @param[out] outputs   of the network, outputs() consecutive values per sample.
+             */
+            void test(Workspace<T> &workspace, const T *inputs, size_t count, T *outputs) const;
+
+            /**
+             * Method for testing output of the network for sparse inputs. Only
+             * the weights of the non-zero inputs are read by the first layer.
+             *
+             * @param[in] input Non-zero inputs fed to the network.
+             *
+             * @return output of the network for the given input.
+             */
+            std::vector<T> test(const Sparse_inputs<T> &input);
+
+            /**
+             * Thread safe inference on sparse samples, see above.
+             *
+             * @param[in]  workspace for the calling thread, see create_workspace().
+             * @param[in]  inputs    of the samples.
+             * @param[in]  count     number of samples.
+             * @param[out] outputs   of the network, outputs() consecutive values per sample.
+             */
+            void test(Workspace<T> &workspace, const Sparse_inputs<T> *inputs, size_t count, T *outputs) const;
+
+            /**
+             * @param[in] batchSize largest number of samples passed at once to test().
+             * @param[in] hugePages back the workspace with transparent huge pages.
+             *
+             * @return a workspace for calling test() from one thread.
+             */
+            Workspace<T> create_workspace(size_t batchSize = 1, bool hugePages = false) const;
+
+            /**
+             * @return number of inputs of the network.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of outputs of the network.
+             */
+            size_t outputs() const;
+
+            /**
+             * @return the layers of the network, the first one being the input layer.
+             */
+            const std::vector<Layer<T>>& layers() const;
+
+            template <typename U>
+            friend std::ostream& operator<<(std::ostream &output, const Network<U> &net);
+    };
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_NETWORK_HPP_ */
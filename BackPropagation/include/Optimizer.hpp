@@ -0,0 +1,67 @@
+/**
+ * @file Optimizer.hpp
+ *
+ * @brief Rules for adjusting the weights from their gradients.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_OPTIMIZER_HPP_
+#define _BACKPROPAGATION_OPTIMIZER_HPP_
+
+#include "Kernels.hpp"
+
+namespace BackPropagation
+{
+    /** Rules for adjusting the weights from their gradients */
+    enum class Optimizer
+    {
+        /**
+         * Original rule, without learning rate: each weight moves by its
+         * gradient plus its previous gradient.
+         */
+        CLASSIC,
+        /** Stochastic gradient descent, with learning rate and momentum */
+        SGD,
+        /** Stochastic gradient descent with Nesterov momentum */
+        NESTEROV,
+        /** Learning rate divided by the root mean square of the recent gradients */
+        RMSPROP,
+        /** Adaptive moment estimation */
+        ADAM
+    };
+
+    /** Class Update: how the layers adjust their weights for one training step */
+    template <typename T = double>
+    struct Update
+    {
+            Optimizer optimizer;    ///< Rule applied
+            kernels::Step<T> step;  ///< Hyper-parameters of the current step, unused by CLASSIC
+
+            // Construction
+        public:
+            Update() :
+                optimizer(Optimizer::CLASSIC), step()
+            {
+            }
+
+            Update(Optimizer rule, const kernels::Step<T> &parameters) :
+                optimizer(rule), step(parameters)
+            {
+            }
+
+            // Methods
+        public:
+            /**
+             * @return true if the optimizer keeps a mean square of the gradients of each weight.
+             */
+            static bool uses_squares(Optimizer rule)
+            {
+                return rule == Optimizer::RMSPROP || rule == Optimizer::ADAM;
+            }
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_OPTIMIZER_HPP_ */
@@ -0,0 +1,197 @@
+/**
+ * @file Pipelined_network.hpp
+ *
+ * @brief Streaming inference with the layers of a network split into
+ *        stages, each running on its own thread.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_PIPELINED_NETWORK_HPP_
+#define _BACKPROPAGATION_PIPELINED_NETWORK_HPP_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "Aligned_allocator.hpp"
+#include "Network.hpp"
+#include "Spsc_ring.hpp"
+
+namespace BackPropagation
+{
+    /** Class Pipeline_settings */
+    struct Pipeline_settings
+    {
+            size_t stages;                      ///< Number of stages, each one a thread
+            /**
+             * Number of layers of each stage, the input layer excluded, empty
+             * by default: the layers are then split so that each stage holds
+             * about the same number of weights.
+             */
+            std::vector<size_t> stage_layers;
+            size_t batch_size;                  ///< Largest number of samples passed between stages at once, 16 by default
+            size_t ring_capacity;               ///< Number of batches between two stages, 4 by default
+            bool pin_threads;                   ///< Pin stage i to core i modulo the number of cores, false by default
+
+            // Construction
+        public:
+            /**
+             * @param[in] stages Number of stages, each one a thread.
+             */
+            explicit Pipeline_settings(size_t stages);
+    };
+
+    /** Class Stage_stats: counters of one stage since the pipeline started */
+    struct Stage_stats
+    {
+            size_t first_layer;     ///< First layer of the stage
+            size_t last_layer;      ///< Last layer of the stage
+            uint64_t batches;       ///< Batches propagated
+            uint64_t samples;       ///< Samples propagated
+            double busy;            ///< Seconds spent propagating
+            double starved;         ///< Seconds spent waiting for a batch from the previous stage
+            double blocked;         ///< Seconds spent waiting for room in the next stage
+            /**
+             * Fraction of the time spent propagating. In a balanced pipeline
+             * every stage is close to 1 under load, a stage well below the
+             * others is waiting for a slower one: move layers to it.
+             */
+            double occupancy;
+    };
+
+    /**
+     * Class Pipelined_network
+     *
+     * Streaming inference for deep networks: consecutive layers are grouped
+     * in stages, each one run by its own thread, the stages being connected
+     * by Spsc_ring buffers of activation batches. Samples at different
+     * layers are propagated at the same time, so that the throughput grows
+     * with the number of stages, as long as they have a core each.
+     *
+     * Samples are fed by push() from one thread and their outputs read in
+     * the same order by pop() from one thread, possibly the same. The
+     * network is read by the stages and must not change while the pipeline
+     * exists.
+     */
+    template <typename T = double>
+    class Pipelined_network
+    {
+        private:
+            /** Class Batch: activations of consecutive samples, one row per sample */
+            struct Batch
+            {
+                    Aligned_vector<T> values;   ///< batch_size rows
+                    size_t count;               ///< Number of samples
+            };
+
+            typedef Spsc_ring<Batch> Ring;
+
+            /** Class Stage */
+            struct Stage
+            {
+                    size_t first;                           ///< First layer
+                    size_t last;                            ///< Layer after the last one
+                    std::vector<Aligned_vector<T>> scratch; ///< Outputs of the layers but the last, batch_size rows each
+                    std::atomic<uint64_t> batches;          ///< Batches propagated
+                    std::atomic<uint64_t> samples;          ///< Samples propagated
+                    std::atomic<uint64_t> busy;             ///< Nanoseconds spent propagating
+                    std::atomic<uint64_t> starved;          ///< Nanoseconds spent waiting for the input ring
+                    std::atomic<uint64_t> blocked;          ///< Nanoseconds spent waiting for the output ring
+                    std::thread thread;                     ///< Running run_stage()
+            };
+
+            const Network<T> &m_network;                    ///< Network being run
+            Pipeline_settings m_settings;                   ///< Pipeline configuration
+            std::vector<std::unique_ptr<Ring>> m_rings;     ///< Ring i feeds stage i, the last one holds the outputs
+            std::vector<std::unique_ptr<Stage>> m_stages;   ///< Stages, in layer order
+            size_t m_popped;                                ///< Samples already read from the oldest output batch
+            std::atomic<bool> m_stop;                       ///< Set when the pipeline is destroyed
+
+            void run_stage(size_t index);
+
+            // Construction
+        public:
+            /**
+             * Start the stage threads.
+             *
+             * @param[in] network  to run, which must outlive the pipeline.
+             * @param[in] settings Pipeline configuration.
+             *
+             * Throws std::invalid_argument if the stage layers do not add up to
+             * the layers of the network.
+             */
+            Pipelined_network(const Network<T> &network, const Pipeline_settings &settings);
+
+            /** Stops the stage threads, the samples in flight are dropped */
+            ~Pipelined_network();
+
+            Pipelined_network(const Pipelined_network&) = delete;
+            Pipelined_network& operator=(const Pipelined_network&) = delete;
+
+            // Methods
+        public:
+            /**
+             * Feed samples to the pipeline without waiting, in batches of at
+             * most batch_size samples. Single producer.
+             *
+             * @param[in] inputs of the samples, inputs() consecutive values per sample.
+             * @param[in] count  number of samples.
+             *
+             * @return number of samples taken, less than count when the first
+             *         ring is full.
+             */
+            size_t push(const T *inputs, size_t count);
+
+            /**
+             * Read the outputs of the samples propagated so far, in the order
+             * they were pushed, without waiting. Single consumer.
+             *
+             * @param[out] outputs of the samples, outputs() consecutive values per sample.
+             * @param[in]  count   largest number of samples to read.
+             *
+             * @return number of samples read.
+             */
+            size_t pop(T *outputs, size_t count);
+
+            /**
+             * Stream a batch of samples through the pipeline, pushing and
+             * popping from the calling thread, see Network::test(). No sample
+             * may be in flight.
+             *
+             * @param[in]  inputs  of the samples, inputs() consecutive values per sample.
+             * @param[in]  count   number of samples.
+             * @param[out] outputs of the network, outputs() consecutive values per sample.
+             */
+            void test(const T *inputs, size_t count, T *outputs);
+
+            /**
+             * Thread safe.
+             *
+             * @return the counters of each stage.
+             */
+            std::vector<Stage_stats> stage_stats() const;
+
+            /**
+             * @return number of stages.
+             */
+            size_t stages() const;
+
+            /**
+             * @return number of inputs of the network.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of outputs of the network.
+             */
+            size_t outputs() const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_PIPELINED_NETWORK_HPP_ */
@@ -0,0 +1,125 @@
+/**
+ * @file Quantized_network.hpp
+ *
+ * @brief Int8 inference engine built from a trained network (post-training quantization).
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_QUANTIZED_NETWORK_HPP_
+#define _BACKPROPAGATION_QUANTIZED_NETWORK_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Aligned_allocator.hpp"
+#include "Network.hpp"
+#include "Training_data.hpp"
+
+namespace BackPropagation
+{
+    /** Class Quantized_workspace: buffers of one thread running a Quantized_network */
+    struct Quantized_workspace
+    {
+            Aligned_vector<uint8_t> inputs;     ///< Quantized inputs of the current layer
+            Aligned_vector<uint8_t> outputs;    ///< Quantized outputs of the current layer
+    };
+
+    /**
+     * Class Quantized_network
+     *
+     * Read-only copy of a network with int8 weights, for fast approximate inference:
+     *  - the weights of each neuron are scaled to [-127, 127] (one scale per row),
+     *  - the values passed between layers are scaled to [0, 127] (one scale and
+     *    zero point per layer, from the ranges seen on calibration samples),
+     *    so the dot products run on u8 x s8 multiply-adds (VNNI, AVX2 maddubs),
+     *  - the activation functions are replaced by lookup tables covering the
+     *    range of sums seen on the calibration samples.
+     */
+    template <typename T = double>
+    class Quantized_network
+    {
+        private:
+            /** Class Quantization: real value = scale * (quantized value - zero) */
+            struct Quantization
+            {
+                    float scale;    ///< Size of a quantization step
+                    int32_t zero;   ///< Quantized value of 0
+            };
+
+            /** Class Quantized_layer */
+            struct Quantized_layer
+            {
+                    size_t neurons;                 ///< Number of neurons
+                    size_t inputs;                  ///< Number of incoming connections
+                    Aligned_vector<int8_t> weights; ///< Quantized weights, one row per neuron, rows not padded
+                    std::vector<float> scales;      ///< Per row: input scale * weight scale
+                    std::vector<int32_t> offsets;   ///< Per row: input zero point * sum of the quantized weights
+                    float table_start;              ///< Sum corresponding to the first table entry
+                    float table_step;               ///< Inverse of the sum difference between entries
+                    std::vector<uint8_t> table;     ///< Quantized activation of each sum, hidden layers
+                    std::vector<T> output_table;    ///< Activation of each sum, output layer
+            };
+
+            size_t m_inputs;                        ///< Number of inputs of the network
+            size_t m_width;                         ///< Largest layer size, that of the workspace buffers
+            Quantization m_input;                   ///< Quantization of the network inputs
+            std::vector<Quantized_layer> m_layers;  ///< Layers, without the input layer
+
+            // Construction
+        public:
+            /**
+             * @param[in] network     trained network to quantize.
+             * @param[in] calibration samples representative of the inputs, used
+             *                        to choose the scales of the values between layers.
+             *
+             * Throws std::invalid_argument without calibration samples, or if an
+             * activation function is not applied value by value (softmax).
+             */
+            Quantized_network(const Network<T> &network, const std::vector<Training_data<T>> &calibration);
+
+            // Methods
+        public:
+            /**
+             * Thread safe inference on a batch of samples. Concurrent calls must
+             * use different workspaces.
+             *
+             * @param[in]  workspace for the calling thread, see create_workspace().
+             * @param[in]  inputs    of the samples, inputs() consecutive values per sample.
+             * @param[in]  count     number of samples.
+             * @param[out] outputs   of the network, outputs() consecutive values per sample.
+             */
+            void test(Quantized_workspace &workspace, const T *inputs, size_t count, T *outputs) const;
+
+            /**
+             * @return a workspace for calling test() from one thread.
+             */
+            Quantized_workspace create_workspace() const;
+
+            /**
+             * @return number of inputs of the network.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of outputs of the network.
+             */
+            size_t outputs() const;
+
+            /**
+             * @return memory used by the quantized weights, in bytes.
+             */
+            size_t weight_bytes() const;
+
+            /**
+             * @return memory used by the quantized network, in bytes: weights,
+             *         per-row scales and offsets, and activation tables.
+             */
+            size_t bytes() const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_QUANTIZED_NETWORK_HPP_ */
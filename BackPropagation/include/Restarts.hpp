@@ -0,0 +1,109 @@
+/**
+ * @file Restarts.hpp
+ *
+ * @brief Training of several independently seeded copies of a network in
+ *        parallel, keeping the best one.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_RESTARTS_HPP_
+#define _BACKPROPAGATION_RESTARTS_HPP_
+
+#include <stdint.h>
+
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "functions/Activation_function.hpp"
+#include "Network.hpp"
+#include "Samples.hpp"
+#include "Training_data.hpp"
+
+namespace BackPropagation
+{
+    /** Class Restart_settings */
+    struct Restart_settings
+    {
+            uint32_t runs;                  ///< Number of networks trained
+            uint32_t threads;               ///< Number of threads the runs are spread over, one per core by default
+            /**
+             * Seed the seed of each run is derived from. The seed of a run
+             * only depends on this seed and on the index of the run.
+             */
+            std::mt19937::result_type seed;
+            /**
+             * Number of epochs between the comparisons of the runs, 100 by
+             * default, 0 to train every run until the end.
+             */
+            uint32_t check_period;
+            /**
+             * A run is abandoned when its error after a multiple of check_period
+             * epochs is above the best error of the runs of lower index at the
+             * same epoch times this ratio, 2 by default.
+             */
+            double abandon_ratio;
+
+            // Construction
+        public:
+            /**
+             * @param[in] runs Number of networks trained.
+             * @param[in] seed Seed the seeds of the runs are derived from.
+             */
+            Restart_settings(uint32_t runs, std::mt19937::result_type seed = std::random_device{}());
+    };
+
+    /** Class Restart_run: outcome of one run */
+    struct Restart_run
+    {
+            std::mt19937::result_type seed; ///< Seed of the network, which reproduces the run
+            double error;                   ///< Error at the end of the training
+            uint32_t epochs;                ///< Number of epochs trained
+            bool abandoned;                 ///< The run was stopped for being behind the others
+    };
+
+    /**
+     * Train restarts.runs networks of the same topology, each one with its own
+     * seed for the initial weights and the training order, on a pool of
+     * restarts.threads threads. Each run trains on a single thread, with a
+     * copy of the settings (threads and observer are not used), and runs which
+     * are clearly behind the others are abandoned.
+     *
+     * The outcome only depends on the seed, whatever the number of threads:
+     * at each checkpoint a run waits for the runs of lower index to reach it
+     * (or to end) and is only compared with them.
+     *
+     * @param[in]  layers       Topology of the networks, as for the Network constructor.
+     * @param[in]  trainingData Data set to be used in the training process.
+     * @param[in]  settings     Training configuration of every run.
+     * @param[in]  restarts     Number of runs, threads and abandon criteria.
+     * @param[out] runs         Outcome of every run, in the order of the runs, if not nullptr.
+     *
+     * @return the network of the run with the lowest error, the first one on ties.
+     *
+     * Throws std::invalid_argument if restarts.runs is 0.
+     */
+    template <typename T>
+    Network<T> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<T>>> &layers,
+        const Samples<T> &trainingData,
+        const typename Network<T>::Settings &settings,
+        const Restart_settings &restarts,
+        std::vector<Restart_run> *runs = nullptr);
+
+    /**
+     * train_restarts() on training data held in memory.
+     */
+    template <typename T>
+    Network<T> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<T>>> &layers,
+        const std::vector<Training_data<T>> &trainingData,
+        const typename Network<T>::Settings &settings,
+        const Restart_settings &restarts,
+        std::vector<Restart_run> *runs = nullptr);
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_RESTARTS_HPP_ */
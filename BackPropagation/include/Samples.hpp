@@ -0,0 +1,149 @@
+/**
+ * @file Samples.hpp
+ *
+ * @brief Read-only view of a training data set, whatever its storage.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_SAMPLES_HPP_
+#define _BACKPROPAGATION_SAMPLES_HPP_
+
+#include <stddef.h>
+
+#include <vector>
+
+#include "Training_data.hpp"
+
+namespace BackPropagation
+{
+    /**
+     * Class Samples
+     *
+     * Gives access to the inputs and expected outputs of each sample, either
+     * from Training_data entries or from contiguous records (the inputs of a
+     * sample followed by its outputs), as stored in a dataset file.
+     */
+    template <typename T = double>
+    class Samples
+    {
+        private:
+            const Training_data<T> *m_entries; ///< Separate entries, nullptr for contiguous records
+            const T *m_records;                ///< Contiguous records
+            size_t m_count;                    ///< Number of samples
+            size_t m_inputs;                   ///< Number of inputs of each sample
+            size_t m_outputs;                  ///< Number of outputs of each sample
+            size_t m_stride;                   ///< Number of values of each record
+            bool m_mapped;                     ///< The records are memory mapped from a file
+
+            // Construction
+        public:
+            /**
+             * @param[in] entries samples, which must outlive the view.
+             */
+            Samples(const std::vector<Training_data<T>> &entries) :
+                m_entries(entries.data()),
+                m_records(nullptr),
+                m_count(entries.size()),
+                m_inputs(entries.empty() ? 0 : entries[0].inputs.size()),
+                m_outputs(entries.empty() ? 0 : entries[0].outputs.size()),
+                m_stride(0),
+                m_mapped(false)
+            {
+            }
+
+            /**
+             * @param[in] records contiguous records, inputs followed by outputs.
+             * @param[in] count   number of records.
+             * @param[in] inputs  number of inputs of each record.
+             * @param[in] outputs number of outputs of each record.
+             * @param[in] mapped  the records are memory mapped from a file, and
+             *                    release() may drop them from memory.
+             */
+            Samples(const T *records, size_t count, size_t inputs, size_t outputs, bool mapped = false) :
+                m_entries(nullptr),
+                m_records(records),
+                m_count(count),
+                m_inputs(inputs),
+                m_outputs(outputs),
+                m_stride(inputs + outputs),
+                m_mapped(mapped)
+            {
+            }
+
+            // Methods
+        public:
+            /**
+             * @return number of samples.
+             */
+            size_t size() const
+            {
+                return m_count;
+            }
+
+            /**
+             * @return number of inputs of each sample, as given by the first
+             *         one, 0 if its inputs are sparse.
+             */
+            size_t inputs() const
+            {
+                return m_inputs;
+            }
+
+            /**
+             * @return number of expected outputs of each sample, as given by
+             *         the first one.
+             */
+            size_t outputs() const
+            {
+                return m_outputs;
+            }
+
+            /**
+             * @return the inputs of a sample, see sparse_inputs() for sparse ones.
+             */
+            const T* inputs(size_t index) const
+            {
+                return m_entries ? m_entries[index].inputs.data() : m_records + index * m_stride;
+            }
+
+            /**
+             * @return the sparse inputs of a sample, nullptr if its inputs are dense.
+             */
+            const Sparse_inputs<T>* sparse_inputs(size_t index) const
+            {
+                return m_entries && m_entries[index].inputs.empty() ? &m_entries[index].sparse_inputs : nullptr;
+            }
+
+            /**
+             * @return the expected outputs of a sample.
+             */
+            const T* outputs(size_t index) const
+            {
+                return m_entries ? m_entries[index].outputs.data() : m_records + index * m_stride + m_inputs;
+            }
+
+            /**
+             * @return the largest number of non-zero inputs of the samples with
+             *         sparse inputs, 0 if there are none.
+             */
+            size_t max_nonzeros() const;
+
+            /**
+             * Hint that the samples [first, last) are about to be used, so that
+             * mapped records are read ahead.
+             */
+            void prefetch(size_t first, size_t last) const;
+
+            /**
+             * Hint that the samples [first, last) are not needed for a while, so
+             * that the memory of mapped records can be reclaimed. They are read
+             * again from the file when needed.
+             */
+            void release(size_t first, size_t last) const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_SAMPLES_HPP_ */
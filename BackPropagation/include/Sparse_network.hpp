@@ -0,0 +1,157 @@
+/**
+ * @file Sparse_network.hpp
+ *
+ * @brief Magnitude pruning of trained networks, and inference engine
+ *        storing the pruned layers as sparse matrices.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_SPARSE_NETWORK_HPP_
+#define _BACKPROPAGATION_SPARSE_NETWORK_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "Aligned_allocator.hpp"
+#include "functions/Activation_function.hpp"
+#include "Network.hpp"
+#include "Samples.hpp"
+#include "Training_data.hpp"
+#include "Workspace.hpp"
+
+namespace BackPropagation
+{
+    /** Class Pruning_settings */
+    struct Pruning_settings
+    {
+            double sparsity;                      ///< Fraction of the weights of the network to prune
+            /**
+             * Fraction of the weights to prune in each layer but the input
+             * layer, used instead of sparsity when not empty.
+             */
+            std::vector<double> layer_sparsities;
+
+            // Construction
+        public:
+            /**
+             * @param[in] sparsity Fraction of the weights of the network to prune.
+             */
+            explicit Pruning_settings(double sparsity);
+    };
+
+    /** Class Pruning_report: outcome of prune() */
+    struct Pruning_report
+    {
+            double sparsity;                      ///< Fraction of the weights of the network pruned
+            std::vector<double> layer_sparsities; ///< Fraction of the weights pruned in each layer but the input layer
+            size_t dense_bytes;                   ///< Memory used by the weights of the network
+            size_t sparse_bytes;                  ///< Memory used by the weights of the Sparse_network, as written by save_model()
+            double error_before;                  ///< Error on the data before pruning
+            double error_pruned;                  ///< Error right after pruning
+            double error_after;                   ///< Error after the fine-tuning, error_pruned without
+    };
+
+    /**
+     * Prune a trained network (see Network::prune()) and fine-tune the
+     * remaining weights with Network::train().
+     *
+     * @param[in,out] network    to prune.
+     * @param[in]     data       Data set the errors are measured on, and trained on by the fine-tuning.
+     * @param[in]     pruning    Sparsity targets.
+     * @param[in]     fineTuning Training configuration of the fine-tuning, which runs for at
+     *                           most fineTuning->max_iterations epochs, nullptr for none.
+     *
+     * @return the sparsity, memory and errors of the network.
+     */
+    template <typename T>
+    Pruning_report prune(
+        Network<T> &network,
+        const Samples<T> &data,
+        const Pruning_settings &pruning,
+        const typename Network<T>::Settings *fineTuning = nullptr);
+
+    /**
+     * prune() on data held in memory.
+     */
+    template <typename T>
+    Pruning_report prune(
+        Network<T> &network,
+        const std::vector<Training_data<T>> &data,
+        const Pruning_settings &pruning,
+        const typename Network<T>::Settings *fineTuning = nullptr);
+
+    /**
+     * Class Sparse_network
+     *
+     * Read-only copy of a pruned network for inference. The layers with
+     * enough zero weights are stored in compressed sparse row format (the
+     * non-zero weights of each neuron with their input index), so that
+     * inference only reads and multiplies the non-zero weights. The other
+     * layers keep their dense rows.
+     */
+    template <typename T = double>
+    class Sparse_network
+    {
+        private:
+            /** Class Sparse_layer */
+            struct Sparse_layer
+            {
+                    size_t neurons;                                 ///< Number of neurons
+                    size_t inputs;                                  ///< Number of incoming connections
+                    std::vector<uint32_t> row_starts;               ///< First weight of each row, and the end, empty for a dense layer
+                    std::vector<uint32_t> columns;                  ///< Input index of each weight
+                    Aligned_vector<T> weights;                      ///< Non-zero weights row by row, or all of them for a dense layer
+                    functions::Activation_function_cPtr<T> func;    ///< Layer activation function
+            };
+
+            std::vector<Sparse_layer> m_layers;    ///< Layers, the first one being the input layer
+
+            // Construction
+        public:
+            /**
+             * @param[in] network     pruned network, see Network::prune().
+             * @param[in] minSparsity fraction of zero weights from which a layer is stored
+             *                        sparse, below it the gathers cost more than they save.
+             */
+            explicit Sparse_network(const Network<T> &network, double minSparsity = 0.5);
+
+            // Methods
+        public:
+            /**
+             * Thread safe inference on a batch of samples, see Network::test().
+             * The samples are propagated one by one.
+             *
+             * @param[in]  workspace for the calling thread, see create_workspace().
+             * @param[in]  inputs    of the samples, inputs() consecutive values per sample.
+             * @param[in]  count     number of samples.
+             * @param[out] outputs   of the network, outputs() consecutive values per sample.
+             */
+            void test(Workspace<T> &workspace, const T *inputs, size_t count, T *outputs) const;
+
+            /**
+             * @return a workspace for calling test() from one thread.
+             */
+            Workspace<T> create_workspace() const;
+
+            /**
+             * @return number of inputs of the network.
+             */
+            size_t inputs() const;
+
+            /**
+             * @return number of outputs of the network.
+             */
+            size_t outputs() const;
+
+            /**
+             * @return memory used by the weights and their indices, in bytes.
+             */
+            size_t weight_bytes() const;
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_SPARSE_NETWORK_HPP_ */
@@ -0,0 +1,127 @@
+/**
+ * @file Spsc_ring.hpp
+ *
+ * @brief Lock-free ring buffer between one producer and one consumer thread.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_SPSC_RING_HPP_
+#define _BACKPROPAGATION_SPSC_RING_HPP_
+
+#include <atomic>
+#include <vector>
+
+#include "Aligned_allocator.hpp"
+
+namespace BackPropagation
+{
+    /**
+     * Class Spsc_ring
+     *
+     * Fixed set of slots, filled in place by the producer and read in place
+     * by the consumer, so that passing a slot copies nothing. Each side only
+     * writes its own index, on its own cache line, and reads the other one:
+     * an acquire load and a release store per slot, no lock.
+     */
+    template <typename S>
+    class Spsc_ring
+    {
+        private:
+            std::vector<S> m_slots;                         ///< Storage, reused in turn
+            alignas(ALIGNMENT) std::atomic<size_t> m_head;  ///< Slots read so far, written by the consumer
+            alignas(ALIGNMENT) std::atomic<size_t> m_tail;  ///< Slots published so far, written by the producer
+
+            // Construction
+        public:
+            /**
+             * @param[in] capacity  number of slots.
+             * @param[in] prototype copied into every slot, e.g. to size its buffers.
+             */
+            Spsc_ring(size_t capacity, const S &prototype) :
+                m_slots(capacity, prototype),
+                m_head(0),
+                m_tail(0)
+            {
+            }
+
+            Spsc_ring(const Spsc_ring&) = delete;
+            Spsc_ring& operator=(const Spsc_ring&) = delete;
+
+            // Methods
+        public:
+            /**
+             * Producer only.
+             *
+             * @return the next slot to fill, nullptr while the ring is full.
+             */
+            S* producer_slot()
+            {
+                const size_t tail = m_tail.load(std::memory_order_relaxed);
+
+                if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+                {
+                    return nullptr;
+                }
+
+                return &m_slots[tail % m_slots.size()];
+            }
+
+            /**
+             * Producer only, hand the slot returned by producer_slot() to the consumer.
+             */
+            void publish()
+            {
+                m_tail.store(m_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /**
+             * Consumer only.
+             *
+             * @return the oldest slot published, nullptr while the ring is empty.
+             */
+            S* consumer_slot()
+            {
+                const size_t head = m_head.load(std::memory_order_relaxed);
+
+                if (head == m_tail.load(std::memory_order_acquire))
+                {
+                    return nullptr;
+                }
+
+                return &m_slots[head % m_slots.size()];
+            }
+
+            /**
+             * Consumer only, give the slot returned by consumer_slot() back to the producer.
+             */
+            void release()
+            {
+                m_head.store(m_head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            }
+
+            /**
+             * @return number of slots published and not released yet, a
+             *         snapshot when called by another thread.
+             */
+            size_t size() const
+            {
+                // Head first, the tail read after it can only be further
+                const size_t head = m_head.load(std::memory_order_acquire);
+
+                return m_tail.load(std::memory_order_acquire) - head;
+            }
+
+            /**
+             * @return number of slots.
+             */
+            size_t capacity() const
+            {
+                return m_slots.size();
+            }
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_SPSC_RING_HPP_ */
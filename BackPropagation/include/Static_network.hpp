@@ -0,0 +1,490 @@
+/**
+ * @file Static_network.hpp
+ *
+ * @brief Backpropagation network whose topology is fixed at compile time,
+ *        for tiny models where the overhead of Network costs more than the math.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_STATIC_NETWORK_HPP_
+#define _BACKPROPAGATION_STATIC_NETWORK_HPP_
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <array>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include "Network.hpp"
+#include "Samples.hpp"
+
+namespace BackPropagation
+{
+    /**
+     * Class Static_network
+     *
+     * Same network, training rule and error as Network (per-sample training
+     * with Optimizer::CLASSIC), with the layer sizes as template parameters,
+     * e.g. Static_network<double, functions::Sigmoid<>, 4, 8, 4>:
+     *  - the weights are held in std::array, the object never allocates,
+     *  - every loop has a compile-time trip count and is unrolled, and the
+     *    activation is called through the static F::function(), so the whole
+     *    propagation is inlined straight-line code (only reasonable for small
+     *    layers),
+     *  - the intermediate values live on the stack, test() is thread safe.
+     *
+     * F is an activation with static function(), function_derivative() and
+     * NAME, as the ones built on functions::Activation (all but Softmax). The
+     * fast activations keep their scalar approximation, e.g. Sigmoid<T,
+     * functions::Precision::FAST>.
+     */
+    template <typename T, typename F, size_t... Sizes>
+    class Static_network
+    {
+            static_assert(sizeof...(Sizes) >= 2, "A network has at least an input and an output layer");
+
+        public:
+            static constexpr size_t LAYERS = sizeof...(Sizes);                 ///< Number of layers, with the input layer
+            static constexpr std::array<size_t, LAYERS> SIZES = { Sizes... }; ///< Number of neurons of each layer
+            static constexpr size_t INPUTS = SIZES[0];                         ///< Number of inputs
+            static constexpr size_t OUTPUTS = SIZES[LAYERS - 1];               ///< Number of outputs
+            static constexpr size_t NEURONS = (Sizes + ...);                   ///< Number of neurons, with the inputs
+
+        private:
+            /** @return index of the first weight of a layer, the input layer having none */
+            static constexpr size_t weight_offset(size_t layer)
+            {
+                size_t offset = 0;
+
+                for (size_t index = 1; index < layer; ++index)
+                {
+                    offset += SIZES[index] * SIZES[index - 1];
+                }
+
+                return offset;
+            }
+
+            /** @return index of the first value of a layer, in the values of all the neurons */
+            static constexpr size_t neuron_offset(size_t layer)
+            {
+                size_t offset = 0;
+
+                for (size_t index = 0; index < layer; ++index)
+                {
+                    offset += SIZES[index];
+                }
+
+                return offset;
+            }
+
+        public:
+            static constexpr size_t WEIGHTS = weight_offset(LAYERS);           ///< Number of weights
+
+        private:
+            typedef std::array<T, NEURONS> Values;               ///< Outputs or errors of all the layers
+            typedef std::make_index_sequence<LAYERS - 1> Layers; ///< One index per layer after the input layer
+
+            std::array<T, WEIGHTS> m_weights;           ///< Weights of each layer in turn, one row per neuron
+            std::array<T, WEIGHTS> m_momentums;         ///< Momentum used for adjusting weights
+            std::array<T, WEIGHTS> m_restore_point;     ///< Weights as of the last save()
+            std::array<T, WEIGHTS> m_restore_momentums; ///< Momentums as of the last save()
+            std::mt19937 m_rng;                         ///< Generator for the initial weights and the training order
+
+            /**
+             * Throws std::invalid_argument if the samples do not have INPUTS
+             * inputs and OUTPUTS outputs, or if some of them are sparse.
+             */
+            static void check_widths(const Samples<T> &data)
+            {
+                if (data.size() && (data.inputs() != INPUTS || data.outputs() != OUTPUTS))
+                {
+                    throw std::invalid_argument("Samples do not match the inputs and outputs of the network");
+                }
+
+                for (size_t sample = 0; sample < data.size(); ++sample)
+                {
+                    if (data.sparse_inputs(sample))
+                    {
+                        throw std::invalid_argument("Static_network does not support sparse inputs");
+                    }
+                }
+            }
+
+            /**
+             * output = f(W * inputs), for one layer.
+             *
+             * @param[in,out] values outputs of all the layers, those of the previous layer being set.
+             */
+            template <size_t L>
+            void propagate_layer(T *values) const
+            {
+                constexpr size_t neurons = SIZES[L];
+                constexpr size_t inputs = SIZES[L - 1];
+
+                const T *weights = m_weights.data() + weight_offset(L);
+                const T *in = values + neuron_offset(L - 1);
+                T *out = values + neuron_offset(L);
+
+#pragma GCC unroll 64
+                for (size_t row = 0; row < neurons; ++row)
+                {
+                    T sum = T();
+
+#pragma GCC unroll 64
+                    for (size_t col = 0; col < inputs; ++col)
+                    {
+                        sum += weights[row * inputs + col] * in[col];
+                    }
+
+                    out[row] = F::function(sum);
+                }
+            }
+
+            /**
+             * Adjust the weights of one layer and compute the errors of the
+             * previous one, as Layer::back_propagate() with Optimizer::CLASSIC.
+             *
+             * @param[in]     values outputs of all the layers.
+             * @param[in,out] errors errors of all the layers, those of the current layer being set.
+             */
+            template <size_t L>
+            void back_propagate_layer(const T *values, T *errors)
+            {
+                constexpr size_t neurons = SIZES[L];
+                constexpr size_t inputs = SIZES[L - 1];
+
+                T *weights = m_weights.data() + weight_offset(L);
+                T *momentums = m_momentums.data() + weight_offset(L);
+                const T *in = values + neuron_offset(L - 1);
+                const T *out = values + neuron_offset(L);
+                const T *outputErrors = errors + neuron_offset(L);
+                T *inputErrors = errors + neuron_offset(L - 1);
+
+                // The errors of the inputs are of no use.
+                if constexpr (L > 1)
+                {
+                    std::fill(inputErrors, inputErrors + inputs, T());
+                }
+
+#pragma GCC unroll 64
+                for (size_t row = 0; row < neurons; ++row)
+                {
+                    const T delta = F::function_derivative(out[row]) * outputErrors[row];
+
+#pragma GCC unroll 64
+                    for (size_t col = 0; col < inputs; ++col)
+                    {
+                        const size_t i = row * inputs + col;
+                        const T momentum = momentums[i];
+
+                        momentums[i] = in[col] * delta;
+                        weights[i] += momentums[i] + momentum;
+
+                        if constexpr (L > 1)
+                        {
+                            inputErrors[col] += weights[i] * delta;
+                        }
+                    }
+                }
+            }
+
+            template <size_t... L>
+            void propagate(T *values, std::index_sequence<L...>) const
+            {
+                (propagate_layer<L + 1>(values), ...);
+            }
+
+            template <size_t... L>
+            void back_propagate(const T *values, T *errors, std::index_sequence<L...>)
+            {
+                // From the output layer down to the first hidden layer
+                (back_propagate_layer<LAYERS - 1 - L>(values, errors), ...);
+            }
+
+            /**
+             * Propagate the given inputs through the network.
+             *
+             * @param[in]  inputs INPUTS values.
+             * @param[out] values outputs of all the layers.
+             */
+            void propagate(const T *inputs, Values &values) const
+            {
+                std::copy(inputs, inputs + INPUTS, values.begin());
+                propagate(values.data(), Layers());
+            }
+
+            /** Store the current network state */
+            void save()
+            {
+                m_restore_point = m_weights;
+                m_restore_momentums = m_momentums;
+            }
+
+            /** Restore a previous network state */
+            void restore()
+            {
+                m_weights = m_restore_point;
+                m_momentums = m_restore_momentums;
+            }
+
+            // Construction
+        public:
+            /**
+             * @param[in] seed Seed for the initial weights and the training order.
+             *                 The initial weights are those of a Network of the same
+             *                 topology and seed.
+             */
+            explicit Static_network(std::mt19937::result_type seed = std::random_device{}()) :
+                m_momentums(),
+                m_rng(seed)
+            {
+                // Same sequence as Layer, for all the scalar types
+                std::uniform_real_distribution<double> distrib(-0.5, 0.5);
+
+                for (auto &weight : m_weights)
+                {
+                    weight = (T) distrib(m_rng);
+                }
+
+                save();
+            }
+
+            /**
+             * Import the weights of a trained network of the same topology and
+             * activation function, possibly of another scalar type.
+             *
+             * @param[in] network to import.
+             *
+             * Throws std::invalid_argument if the topology or the activation
+             * function differ.
+             */
+            template <typename U>
+            explicit Static_network(const Network<U> &network) :
+                m_momentums(),
+                m_rng(std::random_device{}())
+            {
+                const auto &layers = network.layers();
+
+                if (layers.size() != LAYERS)
+                {
+                    throw std::invalid_argument("Network has a different number of layers");
+                }
+
+                for (size_t layer = 0; layer < LAYERS; ++layer)
+                {
+                    const auto &weights = layers[layer].weights();
+
+                    if (weights.rows() != SIZES[layer] || weights.cols() != (layer ? SIZES[layer - 1] : 0))
+                    {
+                        throw std::invalid_argument("Network has a different topology");
+                    }
+
+                    if (layer && strcmp(layers[layer].function()->name(), F::NAME))
+                    {
+                        throw std::invalid_argument("Network has a different activation function");
+                    }
+
+                    std::copy(weights.data(), weights.data() + weights.size(), m_weights.begin() + weight_offset(layer));
+                }
+
+                save();
+            }
+
+            // Methods
+        public:
+            /**
+             * Inference on one sample, without any memory allocation.
+             *
+             * @param[in]  inputs  INPUTS values.
+             * @param[out] outputs OUTPUTS values.
+             */
+            void test(const T *inputs, T *outputs) const
+            {
+                Values values;
+
+                propagate(inputs, values);
+                std::copy(values.end() - OUTPUTS, values.end(), outputs);
+            }
+
+            /**
+             * @param[in] inputs of the sample.
+             *
+             * @return the outputs of the network.
+             */
+            std::array<T, OUTPUTS> test(const std::array<T, INPUTS> &inputs) const
+            {
+                std::array<T, OUTPUTS> outputs;
+
+                test(inputs.data(), outputs.data());
+                return outputs;
+            }
+
+            /**
+             * Train on one sample: propagate it and adjust the weights.
+             *
+             * @param[in] inputs  INPUTS values.
+             * @param[in] targets OUTPUTS expected values.
+             *
+             * @return the mean absolute error of the sample, before the update.
+             */
+            double train(const T *inputs, const T *targets)
+            {
+                Values values;
+                Values errors;
+                double error = 0.0;
+
+                propagate(inputs, values);
+
+                for (size_t i = 0; i < OUTPUTS; ++i)
+                {
+                    errors[NEURONS - OUTPUTS + i] = targets[i] - values[NEURONS - OUTPUTS + i];
+                    error += fabs(errors[NEURONS - OUTPUTS + i]);
+                }
+
+                back_propagate(values.data(), errors.data(), Layers());
+
+                return error / OUTPUTS;
+            }
+
+            /**
+             * Training session, as Network::train() with per-sample training,
+             * Optimizer::CLASSIC and Evaluation::FULL. Only max_iterations,
+             * target_error, store_threshold and restore_threshold are used from
+             * the settings. Nothing is allocated, the training order being kept
+             * in a buffer of the caller, e.g. a static array.
+             *
+             * @param[in]  trainingData Data set to be used in the training process.
+             * @param[in]  settings     Network related configuration.
+             * @param[out] order        Training order, at least as many entries as samples.
+             *
+             * @return global network error at the end of training.
+             *
+             * Throws std::invalid_argument if the samples do not have the
+             * inputs and outputs of the network, if some of them are sparse, or
+             * if there are more samples than SAMPLES.
+             */
+            template <size_t SAMPLES>
+            double train(
+                const Samples<T> &trainingData,
+                const typename Network<T>::Settings &settings,
+                std::array<uint32_t, SAMPLES> &order)
+            {
+                check_widths(trainingData);
+
+                if (trainingData.size() > SAMPLES)
+                {
+                    throw std::invalid_argument("Training order too small for the samples");
+                }
+
+                const auto last = std::begin(order) + trainingData.size();
+                std::iota(std::begin(order), last, 0);
+
+                auto train_once = [&] {
+                    std::shuffle(std::begin(order), last, m_rng);
+
+                    for (auto sample = std::begin(order); sample != last; ++sample)
+                    {
+                        train(trainingData.inputs(*sample), trainingData.outputs(*sample));
+                    }
+                };
+
+                // Perform an iteration to get a reference error.
+                train_once();
+
+                double error = evaluate(trainingData);
+
+                save();
+
+                double previousError = error;
+                double storeThreshold = error * settings.store_threshold;
+                double restoreThreshold = error * settings.restore_threshold;
+
+                for (uint32_t interation = 1; interation < settings.max_iterations; ++interation)
+                {
+                    train_once();
+                    error = evaluate(trainingData);
+
+                    if (error <= settings.target_error)
+                    {
+                        break;
+                    }
+                    else if (error < storeThreshold)
+                    {
+                        // Save the network only when the specified improvement is reached
+                        previousError = error;
+                        storeThreshold = error * settings.store_threshold;
+                        restoreThreshold = error * settings.restore_threshold;
+                        save();
+                    }
+                    else if (error > restoreThreshold)
+                    {
+                        restore();
+                    }
+                }
+
+                if (error < previousError)
+                {
+                    save();
+                }
+                else if (error > previousError)
+                {
+                    error = previousError;
+                    restore();
+                }
+
+                return error;
+            }
+
+            /**
+             * @param[in] trainingData Data set to evaluate.
+             *
+             * @return the average of the mean absolute errors of the samples.
+             *
+             * Throws std::invalid_argument if the samples do not have the
+             * inputs and outputs of the network.
+             */
+            double evaluate(const Samples<T> &trainingData) const
+            {
+                check_widths(trainingData);
+
+                double error = 0.0;
+
+                for (size_t sample = 0; sample < trainingData.size(); ++sample)
+                {
+                    std::array<T, OUTPUTS> outputs;
+                    const T *expected = trainingData.outputs(sample);
+                    double sampleError = 0.0;
+
+                    test(trainingData.inputs(sample), outputs.data());
+
+                    for (size_t i = 0; i < OUTPUTS; ++i)
+                    {
+                        sampleError += fabs(expected[i] - outputs[i]);
+                    }
+
+                    error += sampleError / OUTPUTS;
+                }
+
+                return trainingData.size() ? error / trainingData.size() : 0.0;
+            }
+
+            /**
+             * @return the weights of each layer after the input layer in turn,
+             * one row of SIZES[layer - 1] values per neuron.
+             */
+            const std::array<T, WEIGHTS>& weights() const
+            {
+                return m_weights;
+            }
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_STATIC_NETWORK_HPP_ */
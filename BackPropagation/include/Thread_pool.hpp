@@ -0,0 +1,144 @@
+/**
+ * @file Thread_pool.hpp
+ *
+ * @brief Fixed set of threads running the same task in parallel.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_THREAD_POOL_HPP_
+#define _BACKPROPAGATION_THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace BackPropagation
+{
+    /** Class Thread_pool */
+    class Thread_pool
+    {
+        private:
+            std::vector<std::thread> m_threads;         ///< Worker threads, the caller acts as the first one
+            std::mutex m_mutex;                         ///< Protects the members below
+            std::condition_variable m_start;            ///< Signaled when a new task is available
+            std::condition_variable m_done;             ///< Signaled when a worker finished the task
+            void (*m_invoke)(const void*, size_t);     ///< Runs the task being run, for a thread index
+            const void *m_task;                         ///< Task being run
+            size_t m_generation;                        ///< Incremented for every new task
+            size_t m_pending;                           ///< Workers still running the current task
+            bool m_stop;                                ///< Set when the pool is destroyed
+
+            void worker(size_t index);
+
+            /** Run (*task)(index) for a task of type Task */
+            template <typename Task>
+            static void invoke(const void *task, size_t index)
+            {
+                (*static_cast<const Task*>(task))(index);
+            }
+
+            /** Non template part of run() */
+            void run(void (*invoke)(const void*, size_t), const void *task);
+
+            // Construction
+        public:
+            /**
+             * @param[in] threads Number of threads running each task, including the caller.
+             */
+            Thread_pool(size_t threads);
+            ~Thread_pool();
+
+            Thread_pool(const Thread_pool&) = delete;
+            Thread_pool& operator=(const Thread_pool&) = delete;
+
+            // Methods
+        public:
+            /**
+             * @return number of threads running each task, including the caller.
+             */
+            size_t size() const;
+
+            /**
+             * Run task(index) on every thread, for index in [0, size()), and wait
+             * for all of them to finish. The calling thread runs index 0.
+             * The task is called in place, without being copied or allocating
+             * memory.
+             *
+             * @param[in] task to run, any callable taking a size_t.
+             */
+            template <typename Task>
+            void run(const Task &task)
+            {
+                run(&invoke<Task>, &task);
+            }
+    };
+
+    /**
+     * Class Background_thread
+     *
+     * Runs one task at a time on a thread started once, so that starting a
+     * task does not create a thread or allocate memory.
+     */
+    class Background_thread
+    {
+        private:
+            std::thread m_thread;                   ///< Started by the first task
+            std::mutex m_mutex;                     ///< Protects the members below
+            std::condition_variable m_changed;      ///< Signaled when a task starts or ends
+            void (*m_invoke)(const void*);          ///< Runs the current task
+            const void *m_task;                     ///< Current task, nullptr when idle
+            bool m_stop;                            ///< Set when the thread is destroyed
+
+            void worker();
+
+            /** Run (*task)() for a task of type Task */
+            template <typename Task>
+            static void invoke(const void *task)
+            {
+                (*static_cast<const Task*>(task))();
+            }
+
+            /** Non template part of start() */
+            void start(void (*invoke)(const void*), const void *task);
+
+            // Construction
+        public:
+            Background_thread();
+
+            /** Waits for the current task */
+            ~Background_thread();
+
+            Background_thread(const Background_thread&) = delete;
+            Background_thread& operator=(const Background_thread&) = delete;
+
+            // Methods
+        public:
+            /**
+             * Create the thread ahead of the first task, so that start() does
+             * not allocate. The first start() does it otherwise.
+             */
+            void launch();
+
+            /**
+             * Run task() on the background thread, which must be idle.
+             *
+             * @param[in] task to run, which must live until wait() returns.
+             */
+            template <typename Task>
+            void start(const Task &task)
+            {
+                start(&invoke<Task>, &task);
+            }
+
+            /**
+             * Wait for the current task to finish.
+             */
+            void wait();
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_THREAD_POOL_HPP_ */
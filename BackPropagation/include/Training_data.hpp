@@ -1,25 +1,93 @@
-/**
- * @file Training_data.hpp
- *
- * @brief Structure for defining an input entry for a training session.
- *
- * @author Nicolae Natea
- * Contact: nicu@natea.ro
- */
-
-#ifndef _BACKPROPAGATION_TRAINING_DATA_HPP_
-#define _BACKPROPAGATION_TRAINING_DATA_HPP_
-
-#include <vector>
-
-namespace BackPropagation
-{
-    /** Class Training_data */
-    struct Training_data
-    {
-            std::vector<double> inputs;  ///< Network input
-            std::vector<double> outputs; ///< Expected output
-    };
-} /* namespace BackPropagation */
-
-#endif /* _BACKPROPAGATION_TRAINING_DATA_HPP_ */
+/**
+ * @file Training_data.hpp
+ *
+ * @brief Structure for defining an input entry for a training session,
+ *        with dense or sparse inputs.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_TRAINING_DATA_HPP_
+#define _BACKPROPAGATION_TRAINING_DATA_HPP_
+
+#include <stdint.h>
+
+#include <vector>
+
+namespace BackPropagation
+{
+    /**
+     * Class Sparse_inputs
+     *
+     * Non-zero inputs of a sample, as index/value pairs, or as the set of the
+     * inputs which are 1 for binary inputs (bitsets, one-hot vectors).
+     */
+    template <typename T = double>
+    struct Sparse_inputs
+    {
+            std::vector<uint32_t> indices;  ///< Non-zero inputs, in increasing order
+            std::vector<T> values;          ///< Value of each of them, empty if they are all 1
+    };
+
+    /** Class Training_data */
+    template <typename T = double>
+    struct Training_data
+    {
+            std::vector<T> inputs;          ///< Network input, empty for sparse inputs
+            std::vector<T> outputs;         ///< Expected output
+            Sparse_inputs<T> sparse_inputs; ///< Network input, when inputs is empty
+    };
+
+    /**
+     * @param[in] inputs dense inputs.
+     *
+     * @return the non-zero inputs, without values if they are all 1.
+     */
+    template <typename T>
+    Sparse_inputs<T> make_sparse(const std::vector<T> &inputs)
+    {
+        Sparse_inputs<T> sparse;
+        bool binary = true;
+
+        for (size_t i = 0; i < inputs.size(); ++i)
+        {
+            if (inputs[i] != T())
+            {
+                sparse.indices.push_back(i);
+                sparse.values.push_back(inputs[i]);
+                binary = binary && inputs[i] == T(1);
+            }
+        }
+
+        if (binary)
+        {
+            sparse.values.clear();
+        }
+
+        return sparse;
+    }
+
+    /**
+     * @param[in] bits binary inputs.
+     *
+     * @return the inputs which are set.
+     */
+    template <typename T = double>
+    Sparse_inputs<T> make_sparse(const std::vector<bool> &bits)
+    {
+        Sparse_inputs<T> sparse;
+
+        for (size_t i = 0; i < bits.size(); ++i)
+        {
+            if (bits[i])
+            {
+                sparse.indices.push_back(i);
+            }
+        }
+
+        return sparse;
+    }
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_TRAINING_DATA_HPP_ */
@@ -0,0 +1,113 @@
+/**
+ * @file Workspace.hpp
+ *
+ * @brief Buffers used while propagating samples through a network.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_WORKSPACE_HPP_
+#define _BACKPROPAGATION_WORKSPACE_HPP_
+
+#include <stdint.h>
+
+#include <memory>
+#include <vector>
+
+#include "Arena.hpp"
+#include "Layer.hpp"
+#include "Matrix.hpp"
+
+namespace BackPropagation
+{
+    /**
+     * Class Workspace
+     *
+     * Holds everything which changes while a sample goes through the network,
+     * so that the layers only hold parameters. Each thread working on the
+     * same network uses its own workspace.
+     *
+     * All the buffers are planned in a single arena, for the batch size the
+     * workspace is reserved for, so that propagating and training do not
+     * allocate memory. Larger batches still work, taking additional memory
+     * the first time.
+     */
+    template <typename T = double>
+    struct Workspace
+    {
+            /** Class Buffers: intermediate results of one layer */
+            struct Buffers
+            {
+                    Aligned_vector<T> output;   ///< Result of the last propagation request
+                    Aligned_vector<T> deltas;   ///< Local gradient of each neuron
+                    Aligned_vector<T> errors;   ///< Errors to be backpropagated to the input layer
+
+                    Matrix<T> batch_output;     ///< Result of the last batch propagation, one row per sample
+                    Matrix<T> batch_deltas;     ///< Local gradients for the last batch
+                    Matrix<T> batch_errors;     ///< Errors to be backpropagated for the last batch
+                    Matrix<T> gradients;        ///< Weight gradients accumulated over the last batch
+            };
+
+            std::unique_ptr<Arena> arena;       ///< Storage of all the buffers below
+            std::vector<Buffers> layers;        ///< Buffers of each layer, the first one holds the inputs
+            Aligned_vector<T> output_errors;    ///< Errors detected on the output layer
+            Matrix<T> batch_targets;            ///< Expected outputs of the current batch
+            Matrix<T> batch_output_errors;      ///< Errors detected on the output layer for the current batch
+            double error;                       ///< Sum of the errors computed by the last task run on the workspace
+            bool timed;                         ///< Measure forward_time and backward_time while training
+            double forward_time;                ///< Seconds spent propagating forward while training
+            double backward_time;               ///< Seconds spent back-propagating and updating the weights
+            uint64_t steps;                     ///< Optimizer steps taken with the workspace, for Adam's bias corrections
+            std::vector<uint32_t> pending_inputs; ///< Inputs of the last sparse sample trained, whose momentums are pending
+            bool pending_known;                 ///< pending_inputs is up to date, otherwise any momentum may be pending
+            std::vector<T> sparse_scratch;      ///< Buffer of the sparse updates of the first layer, 4 values per non-zero input
+            size_t batch_size;                  ///< Number of samples the batch buffers are planned for
+            bool training;                      ///< The weight gradients are planned
+            bool huge_pages;                    ///< Back the arena with huge pages
+
+            // Construction
+        public:
+            /**
+             * @param[in] layers    of the network the workspace is used for.
+             * @param[in] batchSize number of samples to reserve the batch buffers for.
+             * @param[in] hugePages back the arena with transparent huge pages.
+             */
+            Workspace(const std::vector<Layer<T>> &layers, size_t batchSize = 0, bool hugePages = false);
+
+            /**
+             * @param[in] sizes     number of neurons of each layer, the first one being the input layer.
+             * @param[in] batchSize number of samples to reserve the batch buffers for.
+             * @param[in] hugePages back the arena with transparent huge pages.
+             */
+            Workspace(const std::vector<size_t> &sizes, size_t batchSize = 0, bool hugePages = false);
+
+            /** The copy gets its own arena, planned the same way. The buffers are not copied. */
+            Workspace(const Workspace &other);
+            Workspace(Workspace &&other) = default;
+
+            Workspace& operator=(const Workspace &other);
+            Workspace& operator=(Workspace &&other) = default;
+
+            // Methods
+        public:
+            /**
+             * Plan the arena for batches of up to batchSize samples, and for the
+             * weight gradients if training. Nothing happens if the current plan
+             * covers them, otherwise the buffers are allocated again and their
+             * contents are lost.
+             *
+             * The buffers of the sparse updates, pending_inputs and sparse_scratch,
+             * are reserved outside the arena for samples of up to nonzeros non-zero
+             * inputs, keeping their contents.
+             *
+             * @param[in] batchSize number of samples.
+             * @param[in] training  plan the gradients used by batch training.
+             * @param[in] nonzeros  largest number of non-zero inputs of the sparse samples.
+             */
+            void reserve(size_t batchSize, bool training = false, size_t nonzeros = 0);
+    };
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_WORKSPACE_HPP_ */
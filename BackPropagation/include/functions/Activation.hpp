@@ -0,0 +1,75 @@
+/**
+ * @file Activation.hpp
+ *
+ * @brief Helper for implementing activation functions which are resolved
+ *        at compile time inside the bulk methods.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_ACTIVATION_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_ACTIVATION_HPP_
+
+#include "functions/Activation_function.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Activation
+         *
+         * Implements the Activation_function interface on top of the static, inlinable
+         * F::function(x) and F::function_derivative(y), so that a layer pays a single
+         * virtual call for all its neurons. F::NAME identifies the function.
+         */
+        template <typename F, typename T>
+        class Activation : public Activation_function<T>
+        {
+            public:
+                virtual T compute(T x) const
+                {
+                    return F::function(x);
+                }
+
+                virtual T derivative(T y) const
+                {
+                    return F::function_derivative(y);
+                }
+
+                virtual void compute_all(T *values, size_t count) const
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        values[i] = F::function(values[i]);
+                    }
+                }
+
+                virtual void derivative_all(
+                    const T *outputs,
+                    const T *errors,
+                    T *deltas,
+                    size_t count) const
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        deltas[i] = F::function_derivative(outputs[i]) * errors[i];
+                    }
+                }
+
+                virtual const char* name() const
+                {
+                    return F::NAME;
+                }
+
+                virtual ~Activation()
+                {
+                }
+        };
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_ACTIVATION_HPP_ */
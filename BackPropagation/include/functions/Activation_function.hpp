@@ -1,49 +1,135 @@
-/**
- * @file Activation_function.hpp
- *
- * @brief Common interface for an activation function.
- *
- * @author Nicolae Natea
- * Contact: nicu@natea.ro
- */
-
-#ifndef _BACKPROPAGATION_FUNCTIONS_ACTIVATION_FUNCTION_HPP
-#define _BACKPROPAGATION_FUNCTIONS_ACTIVATION_FUNCTION_HPP
-
-#include <memory>
-
-namespace BackPropagation
-{
-    namespace functions
-    {
-        /** Activation_function interface */
-        class Activation_function
-        {
-            public:
-                /**
-                 * Activation function
-                 *
-                 * @param[in] x sum of all inputs adjusted
-                 *    according to the neuron's internal weights.
-                 */
-                virtual double compute(double x) const = 0;
-
-                /**
-                 * Activation function derivative
-                 *
-                 * @param[in] y result of the the activation function.
-                 */
-                virtual double derivative(double y) const = 0;
-
-                virtual ~Activation_function()
-                {
-                }
-        };
-
-        typedef std::shared_ptr<const Activation_function> Activation_function_cPtr;
-
-    } /* namespace functions */
-
-} /* namespace BackPropagation */
-
-#endif /* _BACKPROPAGATION_FUNCTIONS_ACTIVATION_FUNCTION_HPP */
+/**
+ * @file Activation_function.hpp
+ *
+ * @brief Common interface for an activation function.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_ACTIVATION_FUNCTION_HPP
+#define _BACKPROPAGATION_FUNCTIONS_ACTIVATION_FUNCTION_HPP
+
+#include <stddef.h>
+
+#include <memory>
+#include <string>
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /** Activation_function interface, for a scalar type T */
+        template <typename T = double>
+        class Activation_function
+        {
+            public:
+                /**
+                 * Activation function
+                 *
+                 * @param[in] x sum of all inputs adjusted
+                 *    according to the neuron's internal weights.
+                 */
+                virtual T compute(T x) const = 0;
+
+                /**
+                 * Activation function derivative
+                 *
+                 * @param[in] y result of the the activation function.
+                 */
+                virtual T derivative(T y) const = 0;
+
+                /**
+                 * Apply the activation function over a whole layer.
+                 * Implementations are expected to override it with an inlined loop,
+                 * the default one performs a virtual call for each value.
+                 *
+                 * @param[in,out] values sums of inputs, replaced with the activation results.
+                 * @param[in]     count  number of values.
+                 */
+                virtual void compute_all(T *values, size_t count) const
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        values[i] = compute(values[i]);
+                    }
+                }
+
+                /**
+                 * Apply the activation function over a batch, one row of
+                 * width values per sample. Only differs from compute_all()
+                 * for the functions which are not applied value by value.
+                 *
+                 * @param[in,out] values sums of inputs, replaced with the activation results.
+                 * @param[in]     rows   number of samples.
+                 * @param[in]     width  number of values per sample.
+                 */
+                virtual void compute_rows(T *values, size_t rows, size_t width) const
+                {
+                    compute_all(values, rows * width);
+                }
+
+                /**
+                 * @return false if the function is not applied value by value,
+                 * e.g. softmax, compute() being meaningless on its own.
+                 */
+                virtual bool elementwise() const
+                {
+                    return true;
+                }
+
+                /**
+                 * Compute the local gradients of a whole layer:
+                 *    deltas[i] = derivative(outputs[i]) * errors[i]
+                 *
+                 * @param[in]  outputs results of the activation function.
+                 * @param[in]  errors  errors detected for each output.
+                 * @param[out] deltas  local gradients.
+                 * @param[in]  count   number of values.
+                 */
+                virtual void derivative_all(
+                    const T *outputs,
+                    const T *errors,
+                    T *deltas,
+                    size_t count) const
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        deltas[i] = derivative(outputs[i]) * errors[i];
+                    }
+                }
+
+                /**
+                 * Identifier of the activation function, used to recreate it for
+                 * another scalar type or when loading a network.
+                 *
+                 * @return the name of the function, empty if it can not be recreated.
+                 */
+                virtual const char* name() const
+                {
+                    return "";
+                }
+
+                virtual ~Activation_function()
+                {
+                }
+        };
+
+        template <typename T = double>
+        using Activation_function_cPtr = std::shared_ptr<const Activation_function<T>>;
+
+        /**
+         * Create one of the activation functions shipped with the library.
+         *
+         * @param[in] name as returned by Activation_function::name().
+         *
+         * @return the function, nullptr if the name is unknown.
+         */
+        template <typename T = double>
+        Activation_function_cPtr<T> create(const std::string &name);
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_ACTIVATION_FUNCTION_HPP */
@@ -0,0 +1,161 @@
+/**
+ * @file Fast_math.hpp
+ *
+ * @brief Polynomial approximations of the transcendental functions used by
+ *        the activation functions in fast mode.
+ *
+ * The exponential is computed as 2^n * e^r, with n = round(x / ln 2) and
+ * |r| <= ln(2) / 2, e^r being a degree 7 polynomial: relative error below
+ * 1e-8 (plus the rounding of the scalar type). log(1 + u), for u in [0, 1],
+ * is a series in s = u / (2 + u) <= 1/3 truncated after s^13: absolute error
+ * below 1e-8. With float the rounding errors are larger, about 2e-7.
+ *
+ * These scalar versions are the reference of the vectorized kernels (see
+ * kernels::Table), which use the same coefficients.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_FAST_MATH_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_FAST_MATH_HPP_
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /** Accuracy of an activation function */
+        enum class Precision
+        {
+            EXACT,  ///< Computed with the standard library
+            FAST    ///< Polynomial approximations, see Fast_math.hpp
+        };
+
+        namespace fast
+        {
+            constexpr double LOG2E = 1.4426950408889634;        ///< 1 / ln(2)
+            constexpr double LN2_HIGH = 0.693359375;            ///< ln(2) with few bits, so that n * LN2_HIGH is exact
+            constexpr double LN2_LOW = -2.1219444005469057e-4;  ///< ln(2) - LN2_HIGH
+
+            /** Taylor coefficients of e^r, from r^0 to r^7 */
+            constexpr double EXP_COEFFICIENTS[] = {
+                1.0, 1.0, 1.0 / 2, 1.0 / 6, 1.0 / 24, 1.0 / 120, 1.0 / 720, 1.0 / 5040 };
+            constexpr size_t EXP_DEGREE = 7;
+
+            /** log(1 + u) = 2 * s * sum(LOG1P_COEFFICIENTS[k] * s^2k) */
+            constexpr double LOG1P_COEFFICIENTS[] = {
+                1.0, 1.0 / 3, 1.0 / 5, 1.0 / 7, 1.0 / 9, 1.0 / 11, 1.0 / 13 };
+            constexpr size_t LOG1P_DEGREE = 6;
+
+            /** Class Limits: range of the exponential, and rounding constant of a scalar type */
+            template <typename T>
+            struct Limits;
+
+            template <>
+            struct Limits<double>
+            {
+                    static constexpr double EXP_MIN = -708.0;           ///< Smaller arguments are clamped
+                    static constexpr double EXP_MAX = 708.0;            ///< Larger arguments are clamped
+                    static constexpr double ROUND = 6755399441055744.0; ///< 1.5 * 2^52: x + ROUND holds round(x) in its low bits
+            };
+
+            template <>
+            struct Limits<float>
+            {
+                    static constexpr float EXP_MIN = -87.0f;
+                    static constexpr float EXP_MAX = 88.0f;
+                    static constexpr float ROUND = 12582912.0f;         ///< 1.5 * 2^23
+            };
+
+            /** @return 2^n, for biased = n + Limits<double>::ROUND */
+            inline double pow2(double biased)
+            {
+                uint64_t bits;
+
+                memcpy(&bits, &biased, sizeof(bits));
+                bits = (bits << 52) + (UINT64_C(1023) << 52);
+                memcpy(&biased, &bits, sizeof(bits));
+
+                return biased;
+            }
+
+            /** @return 2^n, for biased = n + Limits<float>::ROUND */
+            inline float pow2(float biased)
+            {
+                uint32_t bits;
+
+                memcpy(&bits, &biased, sizeof(bits));
+                bits = (bits << 23) + (UINT32_C(127) << 23);
+                memcpy(&biased, &bits, sizeof(bits));
+
+                return biased;
+            }
+
+            /** @return e^x, relative error below 1e-8, arguments clamped to the Limits */
+            template <typename T>
+            inline T exp(T x)
+            {
+                x = std::min(std::max(x, Limits<T>::EXP_MIN), Limits<T>::EXP_MAX);
+
+                const T biased = x * (T) LOG2E + Limits<T>::ROUND;
+                const T n = biased - Limits<T>::ROUND;
+                const T r = (x - n * (T) LN2_HIGH) - n * (T) LN2_LOW;
+                T p = (T) EXP_COEFFICIENTS[EXP_DEGREE];
+
+                for (size_t k = EXP_DEGREE; k-- > 0;)
+                {
+                    p = p * r + (T) EXP_COEFFICIENTS[k];
+                }
+
+                return p * pow2(biased);
+            }
+
+            /** @return log(1 + u) for u in [0, 1], absolute error below 1e-8 */
+            template <typename T>
+            inline T log1p(T u)
+            {
+                const T s = u / (2 + u);
+                const T s2 = s * s;
+                T p = (T) LOG1P_COEFFICIENTS[LOG1P_DEGREE];
+
+                for (size_t k = LOG1P_DEGREE; k-- > 0;)
+                {
+                    p = p * s2 + (T) LOG1P_COEFFICIENTS[k];
+                }
+
+                return 2 * s * p;
+            }
+
+            /** @return 1 / (1 + e^-x) */
+            template <typename T>
+            inline T sigmoid(T x)
+            {
+                return 1 / (1 + exp(-x));
+            }
+
+            /** @return tanh(x) = 2 / (1 + e^-2x) - 1 */
+            template <typename T>
+            inline T tanh(T x)
+            {
+                return 2 / (1 + exp(-2 * x)) - 1;
+            }
+
+            /** @return log(1 + e^x) = max(x, 0) + log(1 + e^-|x|) */
+            template <typename T>
+            inline T softplus(T x)
+            {
+                return std::max(x, T()) + log1p(exp(std::min(x, -x)));
+            }
+
+        } /* namespace fast */
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_FAST_MATH_HPP_ */
@@ -0,0 +1,52 @@
+/**
+ * @file Leaky_relu.hpp
+ *
+ * @brief Leaky rectified linear activation function.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_LEAKY_RELU_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_LEAKY_RELU_HPP_
+
+#include "functions/Activation.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Leaky_relu: x for x > 0, SLOPE * x otherwise
+         *
+         * Unlike Relu the neurons with negative sums are still adjusted.
+         * Exact and cheap already, there is no fast mode.
+         */
+        template <typename T = double>
+        class Leaky_relu : public Activation<Leaky_relu<T>, T>
+        {
+            public:
+                static constexpr const char *NAME = "leaky_relu";
+                static constexpr T SLOPE = (T) 0.01;  ///< Slope for the negative sums
+
+                static T function(T x)
+                {
+                    return x > 0 ? x : SLOPE * x;
+                }
+
+                /** The output has the sign of the sum, which gives the slope */
+                static T function_derivative(T y)
+                {
+                    return y > 0 ? T(1) : SLOPE;
+                }
+
+                virtual ~Leaky_relu()
+                {
+                }
+        };
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_LEAKY_RELU_HPP_ */
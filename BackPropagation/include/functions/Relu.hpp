@@ -0,0 +1,50 @@
+/**
+ * @file Relu.hpp
+ *
+ * @brief Rectified linear activation function.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_RELU_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_RELU_HPP_
+
+#include "functions/Activation.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Relu: max(x, 0)
+         *
+         * Exact and cheap already, there is no fast mode. The derivative at 0
+         * is taken as 0, so that a neuron whose output is 0 is not adjusted.
+         */
+        template <typename T = double>
+        class Relu : public Activation<Relu<T>, T>
+        {
+            public:
+                static constexpr const char *NAME = "relu";
+
+                static T function(T x)
+                {
+                    return x > 0 ? x : T();
+                }
+
+                static T function_derivative(T y)
+                {
+                    return y > 0 ? T(1) : T();
+                }
+
+                virtual ~Relu()
+                {
+                }
+        };
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_RELU_HPP_ */
@@ -1,47 +1,76 @@
-/**
- * @file Sigmoid.hpp
- *
- * @brief Sigmoid activation function.
- *
- * @author Nicolae Natea
- * Contact: nicu@natea.ro
- */
-
-#ifndef _BACKPROPAGATION_FUNCTIONS_SIGMOID_HPP_
-#define _BACKPROPAGATION_FUNCTIONS_SIGMOID_HPP_
-#include <stdint.h>
-#include <math.h>
-#include <memory>
-
-#include "functions/Activation_function.hpp"
-
-namespace BackPropagation
-{
-    namespace functions
-    {
-        /** Class Sigmoid */
-        class Sigmoid : public Activation_function
-        {
-            public:
-                virtual double compute(double x) const
-                {
-                    return (double) (1.0 / (1.0 + exp(-x)));
-                }
-
-                virtual double derivative(double y) const
-                {
-                    return (double) (y * (1.0 - y));
-                }
-
-                virtual ~Sigmoid()
-                {
-                }
-        };
-
-        typedef const std::shared_ptr<const Sigmoid> CSigmoid_cPtr;
-
-    } /* namespace functions */
-
-} /* namespace BackPropagation */
-
-#endif /* _BACKPROPAGATION_FUNCTIONS_SIGMOID_HPP_ */
+/**
+ * @file Sigmoid.hpp
+ *
+ * @brief Sigmoid activation function.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_SIGMOID_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_SIGMOID_HPP_
+#include <stdint.h>
+#include <math.h>
+
+#include <cmath>
+#include <memory>
+
+#include "functions/Activation.hpp"
+#include "functions/Fast_math.hpp"
+#include "Kernels.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Sigmoid: 1 / (1 + e^-x)
+         *
+         * Fast mode: absolute error below 2e-9 with double, 2e-7 with float.
+         */
+        template <typename T = double, Precision P = Precision::EXACT>
+        class Sigmoid : public Activation<Sigmoid<T, P>, T>
+        {
+            public:
+                static constexpr const char *NAME = P == Precision::FAST ? "sigmoid_fast" : "sigmoid";
+
+                static T function(T x)
+                {
+                    if (P == Precision::FAST)
+                    {
+                        return fast::sigmoid(x);
+                    }
+
+                    return (T) (1 / (1 + std::exp(-x)));
+                }
+
+                static T function_derivative(T y)
+                {
+                    return (T) (y * (1 - y));
+                }
+
+                virtual void compute_all(T *values, size_t count) const
+                {
+                    if (P == Precision::FAST)
+                    {
+                        kernels::active<T>().fast_sigmoid(values, count);
+                    }
+                    else
+                    {
+                        Activation<Sigmoid, T>::compute_all(values, count);
+                    }
+                }
+
+                virtual ~Sigmoid()
+                {
+                }
+        };
+
+        template <typename T = double>
+        using CSigmoid_cPtr = const std::shared_ptr<const Sigmoid<T>>;
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_SIGMOID_HPP_ */
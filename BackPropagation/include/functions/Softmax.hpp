@@ -0,0 +1,124 @@
+/**
+ * @file Softmax.hpp
+ *
+ * @brief Softmax activation function, for output layers of classifiers.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_SOFTMAX_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_SOFTMAX_HPP_
+
+#include <algorithm>
+#include <cmath>
+
+#include "functions/Activation_function.hpp"
+#include "functions/Fast_math.hpp"
+#include "Kernels.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Softmax: e^x[i] / sum(e^x[j]) over the neurons of the layer
+         *
+         * The outputs are probabilities summing to 1, the targets are expected
+         * to be one-hot. Paired with the errors targets - outputs, the local
+         * gradient of the cross-entropy of a softmax layer is the error itself,
+         * which derivative_all() passes as is: the layer is trained on the
+         * cross-entropy.
+         *
+         * Not applied value by value, so it has no static function() and can
+         * not be used by Static_network or Quantized_network.
+         *
+         * Fast mode: relative error of the outputs below 2e-8 with double,
+         * 3e-7 with float.
+         */
+        template <typename T = double, Precision P = Precision::EXACT>
+        class Softmax : public Activation_function<T>
+        {
+            public:
+                static constexpr const char *NAME = P == Precision::FAST ? "softmax_fast" : "softmax";
+
+                /** Softmax of a layer holding a single neuron */
+                virtual T compute(T) const
+                {
+                    return T(1);
+                }
+
+                virtual T derivative(T) const
+                {
+                    return T(1);
+                }
+
+                virtual void compute_all(T *values, size_t count) const
+                {
+                    if (count == 0)
+                    {
+                        return;
+                    }
+
+                    // Shifted by the largest value, so that the exponentials do not overflow
+                    const T shift = *std::max_element(values, values + count);
+                    T sum = T();
+
+                    if (P == Precision::FAST)
+                    {
+                        sum = kernels::active<T>().fast_exp_sum(values, shift, count);
+                    }
+                    else
+                    {
+                        for (size_t i = 0; i < count; ++i)
+                        {
+                            values[i] = std::exp(values[i] - shift);
+                            sum += values[i];
+                        }
+                    }
+
+                    const T scale = 1 / sum;
+
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        values[i] *= scale;
+                    }
+                }
+
+                virtual void compute_rows(T *values, size_t rows, size_t width) const
+                {
+                    for (size_t row = 0; row < rows; ++row)
+                    {
+                        compute_all(values + row * width, width);
+                    }
+                }
+
+                virtual bool elementwise() const
+                {
+                    return false;
+                }
+
+                virtual void derivative_all(
+                    const T *,
+                    const T *errors,
+                    T *deltas,
+                    size_t count) const
+                {
+                    std::copy(errors, errors + count, deltas);
+                }
+
+                virtual const char* name() const
+                {
+                    return NAME;
+                }
+
+                virtual ~Softmax()
+                {
+                }
+        };
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_SOFTMAX_HPP_ */
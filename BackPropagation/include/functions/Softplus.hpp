@@ -0,0 +1,79 @@
+/**
+ * @file Softplus.hpp
+ *
+ * @brief Softplus activation function, a smooth ReLU.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_SOFTPLUS_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_SOFTPLUS_HPP_
+
+#include <algorithm>
+#include <cmath>
+
+#include "functions/Activation.hpp"
+#include "functions/Fast_math.hpp"
+#include "Kernels.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Softplus: log(1 + e^x), whose derivative is the sigmoid
+         *
+         * Fast mode: error below 2e-8 with double, 2e-7 with float (absolute
+         * up to 1, relative beyond).
+         */
+        template <typename T = double, Precision P = Precision::EXACT>
+        class Softplus : public Activation<Softplus<T, P>, T>
+        {
+            public:
+                static constexpr const char *NAME = P == Precision::FAST ? "softplus_fast" : "softplus";
+
+                static T function(T x)
+                {
+                    if (P == Precision::FAST)
+                    {
+                        return fast::softplus(x);
+                    }
+
+                    // Written so that e^x does not overflow
+                    return std::max(x, T()) + std::log1p(std::exp(-std::fabs(x)));
+                }
+
+                /** sigmoid(x) = 1 - e^-y */
+                static T function_derivative(T y)
+                {
+                    if (P == Precision::FAST)
+                    {
+                        return 1 - fast::exp(-y);
+                    }
+
+                    return 1 - std::exp(-y);
+                }
+
+                virtual void compute_all(T *values, size_t count) const
+                {
+                    if (P == Precision::FAST)
+                    {
+                        kernels::active<T>().fast_softplus(values, count);
+                    }
+                    else
+                    {
+                        Activation<Softplus, T>::compute_all(values, count);
+                    }
+                }
+
+                virtual ~Softplus()
+                {
+                }
+        };
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_SOFTPLUS_HPP_ */
@@ -0,0 +1,70 @@
+/**
+ * @file Tanh.hpp
+ *
+ * @brief Hyperbolic tangent activation function.
+ *
+ * @author Nicolae Natea
+ * Contact: nicu@natea.ro
+ */
+
+#ifndef _BACKPROPAGATION_FUNCTIONS_TANH_HPP_
+#define _BACKPROPAGATION_FUNCTIONS_TANH_HPP_
+
+#include <cmath>
+
+#include "functions/Activation.hpp"
+#include "functions/Fast_math.hpp"
+#include "Kernels.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        /**
+         * Class Tanh: (e^x - e^-x) / (e^x + e^-x), outputs in (-1, 1)
+         *
+         * Fast mode: absolute error below 4e-9 with double, 2e-7 with float.
+         */
+        template <typename T = double, Precision P = Precision::EXACT>
+        class Tanh : public Activation<Tanh<T, P>, T>
+        {
+            public:
+                static constexpr const char *NAME = P == Precision::FAST ? "tanh_fast" : "tanh";
+
+                static T function(T x)
+                {
+                    if (P == Precision::FAST)
+                    {
+                        return fast::tanh(x);
+                    }
+
+                    return std::tanh(x);
+                }
+
+                static T function_derivative(T y)
+                {
+                    return 1 - y * y;
+                }
+
+                virtual void compute_all(T *values, size_t count) const
+                {
+                    if (P == Precision::FAST)
+                    {
+                        kernels::active<T>().fast_tanh(values, count);
+                    }
+                    else
+                    {
+                        Activation<Tanh, T>::compute_all(values, count);
+                    }
+                }
+
+                virtual ~Tanh()
+                {
+                }
+        };
+
+    } /* namespace functions */
+
+} /* namespace BackPropagation */
+
+#endif /* _BACKPROPAGATION_FUNCTIONS_TANH_HPP_ */
@@ -0,0 +1,128 @@
+/*
+ * Arena.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include <algorithm>
+#include <new>
+
+#include "Aligned_allocator.hpp"
+#include "Arena.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        /** Size of a transparent huge page on x86-64 */
+        constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+    }
+
+    Arena::Arena(size_t bytes, bool hugePages) :
+        m_used(0), m_overflow(0), m_huge_pages(false)
+    {
+        add_block(std::max<size_t>(bytes, ALIGNMENT), hugePages);
+    }
+
+    Arena::~Arena()
+    {
+        for (const auto &block : m_blocks)
+        {
+            if (block.mapped)
+            {
+                munmap(block.data, block.size);
+            }
+            else
+            {
+                free(block.data);
+            }
+        }
+    }
+
+    size_t Arena::round(size_t bytes)
+    {
+        return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    void Arena::add_block(size_t bytes, bool hugePages)
+    {
+        Block block = { nullptr, round(bytes), false };
+
+#ifdef MADV_HUGEPAGE
+        // Only worth it from one huge page on, which is also the alignment the kernel needs.
+        if (hugePages && block.size >= HUGE_PAGE_SIZE)
+        {
+            size_t length = (block.size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+            void *address = mmap(nullptr, length + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+            if (address != MAP_FAILED)
+            {
+                // Trim the mapping to a huge page boundary.
+                uintptr_t start = (uintptr_t) address;
+                uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+
+                if (aligned > start)
+                {
+                    munmap(address, aligned - start);
+                }
+                munmap((void*) (aligned + length), start + HUGE_PAGE_SIZE - aligned);
+
+                block.data = (char*) aligned;
+                block.size = length;
+                block.mapped = true;
+                m_huge_pages = madvise(block.data, length, MADV_HUGEPAGE) == 0;
+            }
+        }
+#endif
+
+        if (!block.mapped)
+        {
+            block.data = static_cast<char*>(aligned_alloc(ALIGNMENT, block.size));
+
+            if (block.data == nullptr)
+            {
+                throw std::bad_alloc();
+            }
+        }
+
+        m_blocks.push_back(block);
+        m_used = 0;
+    }
+
+    void* Arena::allocate(size_t bytes)
+    {
+        bytes = round(bytes);
+
+        if (m_used + bytes > m_blocks.back().size)
+        {
+            // Not planned: at least as large as the plan, so that growing buffers do not add a block each time.
+            add_block(std::max(bytes, m_blocks.front().size), false);
+            m_overflow += m_blocks.back().size;
+        }
+
+        void *data = m_blocks.back().data + m_used;
+        m_used += bytes;
+
+        return data;
+    }
+
+    size_t Arena::capacity() const
+    {
+        return m_blocks.front().size;
+    }
+
+    size_t Arena::overflow() const
+    {
+        return m_overflow;
+    }
+
+    bool Arena::huge_pages() const
+    {
+        return m_huge_pages;
+    }
+}
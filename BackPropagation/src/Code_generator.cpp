@@ -0,0 +1,471 @@
+/*
+ * Code_generator.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <ctype.h>
+#include <math.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "Code_generator.hpp"
+#include "functions/Fast_math.hpp"
+#include "functions/Leaky_relu.hpp"
+#include "functions/Relu.hpp"
+#include "functions/Sigmoid.hpp"
+#include "functions/Softmax.hpp"
+#include "functions/Softplus.hpp"
+#include "functions/Tanh.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        using functions::Precision;
+
+        /** Class Layer_view: what the generated code needs of a layer */
+        template <typename T>
+        struct Layer_view
+        {
+                size_t neurons;             ///< Number of neurons
+                size_t inputs;              ///< Number of incoming connections
+                const T *weights;           ///< One row of inputs values per neuron
+                std::string activation;     ///< Activation_function::name()
+        };
+
+        /** Write lines of code, indented */
+        void write_indented(std::ostream &output, const std::string &code, const std::string &indent)
+        {
+            std::istringstream lines(code);
+            std::string line;
+
+            while (std::getline(lines, line))
+            {
+                output << (line.empty() ? "" : indent) << line << "\n";
+            }
+        }
+
+        /** Write a scalar as a literal which converts back to the same value */
+        template <typename T>
+        void write_literal(std::ostream &output, T value)
+        {
+            output << std::scientific << std::setprecision(std::numeric_limits<T>::max_digits10 - 1) << value
+                   << (sizeof(T) == sizeof(float) ? "f" : "");
+        }
+
+        /** Class Generated_activation: activation function of the generated code */
+        struct Generated_activation
+        {
+                std::string function;       ///< Name of the generated function
+                std::string body;           ///< Statements applying it to Scalar values[N]
+                bool fast;                  ///< Uses the approximations of functions::fast
+        };
+
+        /** @return the generated code of an activation function, throws std::invalid_argument if unknown */
+        template <typename T>
+        Generated_activation generated_activation(const std::string &name)
+        {
+            const bool fast = name == functions::Sigmoid<T, Precision::FAST>::NAME ||
+                              name == functions::Tanh<T, Precision::FAST>::NAME ||
+                              name == functions::Softplus<T, Precision::FAST>::NAME ||
+                              name == functions::Softmax<T, Precision::FAST>::NAME;
+            const std::string exp = fast ? "fast_exp" : "std::exp";
+            const std::string loop = "for (std::size_t i = 0; i < N; ++i)\n{\n    values[i] = ";
+            const std::string end = ";\n}\n";
+
+            if (name == functions::Sigmoid<T>::NAME || name == functions::Sigmoid<T, Precision::FAST>::NAME)
+            {
+                return { name, loop + "1 / (1 + " + exp + "(-values[i]))" + end, fast };
+            }
+            if (name == functions::Tanh<T>::NAME)
+            {
+                return { name, loop + "std::tanh(values[i])" + end, fast };
+            }
+            if (name == functions::Tanh<T, Precision::FAST>::NAME)
+            {
+                return { name, loop + "2 / (1 + fast_exp(-2 * values[i])) - 1" + end, fast };
+            }
+            if (name == functions::Softplus<T>::NAME)
+            {
+                return { name, loop + "(values[i] > 0 ? values[i] : Scalar()) + std::log1p(std::exp(-std::fabs(values[i])))" + end,
+                         fast };
+            }
+            if (name == functions::Softplus<T, Precision::FAST>::NAME)
+            {
+                return { name, loop + "(values[i] > 0 ? values[i] : Scalar()) + "
+                               "fast_log1p(fast_exp(values[i] < -values[i] ? values[i] : -values[i]))" + end, fast };
+            }
+            if (name == functions::Softmax<T>::NAME || name == functions::Softmax<T, Precision::FAST>::NAME)
+            {
+                return { name,
+                         "Scalar shift = values[0];\n"
+                         "Scalar sum = Scalar();\n"
+                         "\n"
+                         "for (std::size_t i = 1; i < N; ++i)\n"
+                         "{\n"
+                         "    shift = values[i] > shift ? values[i] : shift;\n"
+                         "}\n"
+                         "for (std::size_t i = 0; i < N; ++i)\n"
+                         "{\n"
+                         "    values[i] = " + exp + "(values[i] - shift);\n"
+                         "    sum += values[i];\n"
+                         "}\n"
+                         "\n"
+                         "const Scalar scale = 1 / sum;\n"
+                         "\n"
+                         "for (std::size_t i = 0; i < N; ++i)\n"
+                         "{\n"
+                         "    values[i] *= scale;\n"
+                         "}\n",
+                         fast };
+            }
+            if (name == functions::Relu<T>::NAME)
+            {
+                return { name, loop + "values[i] > 0 ? values[i] : Scalar()" + end, fast };
+            }
+            if (name == functions::Leaky_relu<T>::NAME)
+            {
+                std::ostringstream slope;
+
+                slope << std::setprecision(std::numeric_limits<T>::max_digits10) << functions::Leaky_relu<T>::SLOPE;
+
+                return { name, loop + "values[i] > 0 ? values[i] : Scalar(" + slope.str() + ") * values[i]" + end, fast };
+            }
+
+            throw std::invalid_argument("Activation function " + name + " can not be generated");
+        }
+
+        /**
+         * Write fast_exp() and fast_log1p(), the scalar versions of
+         * functions::fast::exp() and functions::fast::log1p().
+         */
+        template <typename T>
+        void write_fast_math(std::ostream &output)
+        {
+            typedef functions::fast::Limits<T> Limits;
+            const bool single = sizeof(T) == sizeof(float);
+
+            output << "\n"
+                   << "        /** e^x, relative error below 1e-8 (plus the rounding of Scalar) */\n"
+                   << "        inline Scalar fast_exp(Scalar x)\n"
+                   << "        {\n"
+                   << "            const Scalar min = ";
+            write_literal(output, Limits::EXP_MIN);
+            output << ";\n"
+                   << "            const Scalar max = ";
+            write_literal(output, Limits::EXP_MAX);
+            output << ";\n"
+                   << "            const Scalar round = ";
+            write_literal(output, Limits::ROUND);
+            output << ";\n"
+                   << "\n"
+                   << "            x = x < min ? min : (x > max ? max : x);\n"
+                   << "\n"
+                   << "            // 2^n * e^r, with n = round(x / ln(2)) held in the low bits of biased\n"
+                   << "            const Scalar biased = x * Scalar(";
+            write_literal(output, functions::fast::LOG2E);
+            output << ") + round;\n"
+                   << "            const Scalar n = biased - round;\n"
+                   << "            const Scalar r = (x - n * Scalar(";
+            write_literal(output, functions::fast::LN2_HIGH);
+            output << ")) - n * Scalar(";
+            write_literal(output, functions::fast::LN2_LOW);
+            output << ");\n"
+                   << "            Scalar p = Scalar(";
+            write_literal(output, functions::fast::EXP_COEFFICIENTS[functions::fast::EXP_DEGREE]);
+            output << ");\n";
+
+            for (size_t k = functions::fast::EXP_DEGREE; k-- > 0;)
+            {
+                output << "            p = p * r + Scalar(";
+                write_literal(output, functions::fast::EXP_COEFFICIENTS[k]);
+                output << ");\n";
+            }
+
+            output << "\n"
+                   << "            " << (single ? "std::uint32_t" : "std::uint64_t") << " bits;\n"
+                   << "            Scalar scale;\n"
+                   << "\n"
+                   << "            std::memcpy(&bits, &biased, sizeof(bits));\n"
+                   << "            bits = (bits << " << (single ? "23" : "52") << ") + ("
+                   << (single ? "UINT32_C(127) << 23" : "UINT64_C(1023) << 52") << ");\n"
+                   << "            std::memcpy(&scale, &bits, sizeof(bits));\n"
+                   << "\n"
+                   << "            return p * scale;\n"
+                   << "        }\n"
+                   << "\n"
+                   << "        /** log(1 + u) for u in [0, 1], absolute error below 1e-8 */\n"
+                   << "        inline Scalar fast_log1p(Scalar u)\n"
+                   << "        {\n"
+                   << "            const Scalar s = u / (2 + u);\n"
+                   << "            const Scalar s2 = s * s;\n"
+                   << "            Scalar p = Scalar(";
+            write_literal(output, functions::fast::LOG1P_COEFFICIENTS[functions::fast::LOG1P_DEGREE]);
+            output << ");\n";
+
+            for (size_t k = functions::fast::LOG1P_DEGREE; k-- > 0;)
+            {
+                output << "            p = p * s2 + Scalar(";
+                write_literal(output, functions::fast::LOG1P_COEFFICIENTS[k]);
+                output << ");\n";
+            }
+
+            output << "\n"
+                   << "            return 2 * s * p;\n"
+                   << "        }\n";
+        }
+
+        /** generate_code() on the layers of any network */
+        template <typename T>
+        void write_code(const std::vector<Layer_view<T>> &layers, std::ostream &output, const std::string &name)
+        {
+            if (name.empty() || !(isalpha(name[0]) || name[0] == '_') ||
+                name.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_") !=
+                std::string::npos)
+            {
+                throw std::invalid_argument("Invalid namespace name " + name);
+            }
+
+            const std::ios::fmtflags flags = output.flags();
+            const std::streamsize precision = output.precision();
+            std::vector<Generated_activation> activations;   // One per layer after the input layer
+            std::vector<std::string> generated;              // Functions written once each
+            std::string topology;
+            std::string guard;
+
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                topology += (i ? "-" : "") + std::to_string(layers[i].neurons);
+
+                if (i > 0)
+                {
+                    activations.push_back(generated_activation<T>(layers[i].activation));
+
+                    for (size_t w = 0; w < layers[i].neurons * layers[i].inputs; ++w)
+                    {
+                        if (!std::isfinite(layers[i].weights[w]))
+                        {
+                            throw std::invalid_argument("Network has weights which are not finite");
+                        }
+                    }
+                }
+            }
+
+            const bool fast = std::any_of(activations.begin(), activations.end(), [](const Generated_activation &activation) {
+                return activation.fast;
+            });
+
+            for (char c : name)
+            {
+                guard += (char) toupper(c);
+            }
+
+            guard += "_HPP_";
+
+            output << "/*\n"
+                   << " * " << name << ".hpp\n"
+                   << " *\n"
+                   << " * Generated by BackPropagation::generate_code() from a " << topology << " network.\n"
+                   << " * Do not edit.\n"
+                   << " */\n"
+                   << "\n"
+                   << "#ifndef " << guard << "\n"
+                   << "#define " << guard << "\n"
+                   << "\n"
+                   << "#include <cmath>\n"
+                   << "#include <cstddef>\n"
+                   << (fast ? "#include <cstdint>\n#include <cstring>\n" : "")
+                   << "\n"
+                   << "namespace " << name << "\n"
+                   << "{\n"
+                   << "    typedef " << (sizeof(T) == sizeof(float) ? "float" : "double") << " Scalar;\n"
+                   << "\n"
+                   << "    constexpr std::size_t LAYERS = " << layers.size() << ";  ///< Number of layers, with the input layer\n"
+                   << "    constexpr std::size_t SIZES[LAYERS] = { ";
+
+            for (size_t i = 0; i < layers.size(); ++i)
+            {
+                output << (i ? ", " : "") << layers[i].neurons;
+            }
+
+            output << " };  ///< Number of neurons of each layer\n"
+                   << "    constexpr std::size_t INPUTS = " << layers[0].neurons << ";  ///< Number of inputs\n"
+                   << "    constexpr std::size_t OUTPUTS = " << layers.back().neurons << ";  ///< Number of outputs\n"
+                   << "\n"
+                   << "    namespace detail\n"
+                   << "    {\n";
+
+            // Weights, transposed: one row of all the neurons per input
+            for (size_t i = 1; i < layers.size(); ++i)
+            {
+                const Layer_view<T> &layer = layers[i];
+
+                output << "        /** Weights of layer " << i << ", one row of " << layer.neurons
+                       << " neurons per input */\n"
+                       << "        alignas(64) inline constexpr Scalar WEIGHTS_" << i << "[" << layer.inputs << " * "
+                       << layer.neurons << "] = {\n";
+
+                for (size_t col = 0; col < layer.inputs; ++col)
+                {
+                    for (size_t row = 0; row < layer.neurons; ++row)
+                    {
+                        output << (row % 8 == 0 ? "            " : " ");
+                        write_literal(output, layer.weights[row * layer.inputs + col]);
+                        output << (col + 1 < layer.inputs || row + 1 < layer.neurons ? "," : "")
+                               << (row % 8 == 7 || row + 1 == layer.neurons ? "\n" : "");
+                    }
+                }
+
+                output << "        };\n"
+                       << "\n";
+            }
+
+            output << "        /** out = transpose(weights) * in, the sums of each neuron in the order of the inputs */\n"
+                   << "        template <std::size_t INPUT_COUNT, std::size_t NEURON_COUNT>\n"
+                   << "        inline void multiply(const Scalar *weights, const Scalar *in, Scalar *out)\n"
+                   << "        {\n"
+                   << "            Scalar sums[NEURON_COUNT] = {};\n"
+                   << "\n"
+                   << "            // Not unrolled, fully unrolled loops over constant weights end up as horizontal sums\n"
+                   << "#pragma GCC unroll 1\n"
+                   << "            for (std::size_t col = 0; col < INPUT_COUNT; ++col)\n"
+                   << "            {\n"
+                   << "                const Scalar x = in[col];\n"
+                   << "\n"
+                   << "#pragma GCC unroll 1\n"
+                   << "                for (std::size_t row = 0; row < NEURON_COUNT; ++row)\n"
+                   << "                {\n"
+                   << "                    sums[row] += weights[col * NEURON_COUNT + row] * x;\n"
+                   << "                }\n"
+                   << "            }\n"
+                   << "            for (std::size_t row = 0; row < NEURON_COUNT; ++row)\n"
+                   << "            {\n"
+                   << "                out[row] = sums[row];\n"
+                   << "            }\n"
+                   << "        }\n";
+
+            if (fast)
+            {
+                write_fast_math<T>(output);
+            }
+
+            for (const Generated_activation &activation : activations)
+            {
+                bool written = false;
+
+                for (const std::string &function : generated)
+                {
+                    written = written || function == activation.function;
+                }
+
+                if (written)
+                {
+                    continue;
+                }
+
+                output << "\n"
+                       << "        template <std::size_t N>\n"
+                       << "        inline void " << activation.function << "(Scalar *values)\n"
+                       << "        {\n";
+                write_indented(output, activation.body, "            ");
+                output << "        }\n";
+
+                generated.push_back(activation.function);
+            }
+
+            output << "    }\n"
+                   << "\n"
+                   << "    /**\n"
+                   << "     * Compute the outputs of the network, thread safe.\n"
+                   << "     *\n"
+                   << "     * @param[in]  inputs  INPUTS values.\n"
+                   << "     * @param[out] outputs OUTPUTS values.\n"
+                   << "     */\n"
+                   << "    inline void test(const Scalar *inputs, Scalar *outputs)\n"
+                   << "    {\n";
+
+            for (size_t i = 1; i < layers.size(); ++i)
+            {
+                output << "        alignas(64) Scalar layer" << i << "[" << layers[i].neurons << "];\n";
+            }
+
+            for (size_t i = 1; i < layers.size(); ++i)
+            {
+                output << "\n"
+                       << "        detail::multiply<" << layers[i].inputs << ", " << layers[i].neurons << ">(detail::WEIGHTS_"
+                       << i << ", " << (i == 1 ? std::string("inputs") : "layer" + std::to_string(i - 1)) << ", layer"
+                       << i << ");\n"
+                       << "        detail::" << activations[i - 1].function << "<" << layers[i].neurons << ">(layer" << i
+                       << ");\n";
+            }
+
+            output << "\n"
+                   << "        for (std::size_t i = 0; i < OUTPUTS; ++i)\n"
+                   << "        {\n"
+                   << "            outputs[i] = layer" << layers.size() - 1 << "[i];\n"
+                   << "        }\n"
+                   << "    }\n"
+                   << "}\n"
+                   << "\n"
+                   << "#endif /* " << guard << " */\n";
+
+            output.flags(flags);
+            output.precision(precision);
+        }
+    }
+
+    template <typename T>
+    void generate_code(const Network<T> &network, std::ostream &output, const std::string &name)
+    {
+        std::vector<Layer_view<T>> layers;
+
+        for (size_t i = 0; i < network.layers().size(); ++i)
+        {
+            const Layer<T> &layer = network.layers()[i];
+
+            layers.push_back({ layer.size(), layer.inputs(), layer.weights().data(), i ? layer.function()->name() : "" });
+        }
+
+        write_code(layers, output, name);
+    }
+
+    template <typename T>
+    void generate_code(const Mapped_network<T> &network, std::ostream &output, const std::string &name)
+    {
+        std::vector<Layer_view<T>> layers;
+        std::vector<std::vector<T>> dense(network.layers());
+
+        for (size_t i = 0; i < network.layers(); ++i)
+        {
+            const size_t inputs = i ? network.size(i - 1) : 0;
+            const T *weights = network.weights(i);
+
+            // The generated code multiplies dense rows
+            if (i && network.sparse(i))
+            {
+                dense[i].resize(network.size(i) * inputs);
+                network.copy_weights(i, dense[i].data());
+                weights = dense[i].data();
+            }
+
+            layers.push_back({
+                network.size(i),
+                inputs,
+                weights,
+                i ? network.function(i)->name() : "" });
+        }
+
+        write_code(layers, output, name);
+    }
+
+    template void generate_code(const Network<double>&, std::ostream&, const std::string&);
+    template void generate_code(const Network<float>&, std::ostream&, const std::string&);
+    template void generate_code(const Mapped_network<double>&, std::ostream&, const std::string&);
+    template void generate_code(const Mapped_network<float>&, std::ostream&, const std::string&);
+}
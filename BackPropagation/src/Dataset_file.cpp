@@ -0,0 +1,198 @@
+/*
+ * Dataset_file.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdexcept>
+
+#include "Aligned_allocator.hpp"
+#include "Dataset_file.hpp"
+
+namespace BackPropagation
+{
+    template <typename T>
+    Dataset_writer<T>::Dataset_writer(const std::string &path, size_t inputs, size_t outputs) :
+        m_file(path, std::ios::binary | std::ios::trunc),
+        m_path(path),
+        m_header()
+    {
+        if (!m_file)
+        {
+            throw std::runtime_error("Can not create dataset file " + path);
+        }
+
+        memcpy(m_header.magic, dataset::MAGIC, sizeof(m_header.magic));
+        m_header.version = dataset::VERSION;
+        m_header.byte_order = dataset::BYTE_ORDER_MARK;
+        m_header.scalar_size = sizeof(T);
+        m_header.inputs = inputs;
+        m_header.outputs = outputs;
+        m_header.data = ALIGNMENT;
+
+        static_assert(sizeof(dataset::Header) <= ALIGNMENT, "The header has to fit before the samples");
+
+        // The sample count is only known by close()
+        static const char zeros[ALIGNMENT] = {};
+        m_file.write(zeros, m_header.data);
+    }
+
+    template <typename T>
+    Dataset_writer<T>::~Dataset_writer()
+    {
+        if (m_file.is_open())
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+                // Nothing to report the error to
+            }
+        }
+    }
+
+    template <typename T>
+    void Dataset_writer<T>::add(const T *inputs, const T *outputs)
+    {
+        m_file.write(reinterpret_cast<const char*>(inputs), m_header.inputs * sizeof(T));
+        m_file.write(reinterpret_cast<const char*>(outputs), m_header.outputs * sizeof(T));
+        m_header.samples++;
+    }
+
+    template <typename T>
+    void Dataset_writer<T>::add(const Training_data<T> &sample)
+    {
+        assert(sample.inputs.size() == m_header.inputs && sample.outputs.size() == m_header.outputs);
+
+        add(sample.inputs.data(), sample.outputs.data());
+    }
+
+    template <typename T>
+    void Dataset_writer<T>::close()
+    {
+        m_file.seekp(0);
+        m_file.write(reinterpret_cast<const char*>(&m_header), sizeof(m_header));
+        m_file.close();
+
+        if (!m_file)
+        {
+            throw std::runtime_error("Can not write dataset file " + m_path);
+        }
+    }
+
+    template <typename T>
+    void save_dataset(const std::vector<Training_data<T>> &data, const std::string &path)
+    {
+        Dataset_writer<T> writer(
+            path,
+            data.empty() ? 0 : data[0].inputs.size(),
+            data.empty() ? 0 : data[0].outputs.size());
+
+        for (const auto &sample : data)
+        {
+            writer.add(sample);
+        }
+
+        writer.close();
+    }
+
+    template <typename T>
+    Mapped_dataset<T>::Mapped_dataset(const std::string &path) :
+        m_address(MAP_FAILED),
+        m_length(0),
+        m_samples(nullptr, 0, 0, 0)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+
+        if (fd < 0)
+        {
+            throw std::runtime_error("Can not open dataset file " + path);
+        }
+
+        if (fstat(fd, &info) == 0 && info.st_size >= (off_t) sizeof(dataset::Header))
+        {
+            m_length = info.st_size;
+            m_address = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        // The mapping keeps the file referenced.
+        close(fd);
+
+        if (m_address == MAP_FAILED)
+        {
+            throw std::runtime_error("Can not map dataset file " + path);
+        }
+
+        const char *base = static_cast<const char*>(m_address);
+        const dataset::Header &header = *reinterpret_cast<const dataset::Header*>(base);
+        const uint64_t stride = ((uint64_t) header.inputs + header.outputs) * sizeof(T);
+
+        if (memcmp(header.magic, dataset::MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != dataset::VERSION ||
+            header.byte_order != dataset::BYTE_ORDER_MARK ||
+            header.scalar_size != sizeof(T) ||
+            header.data % sizeof(T) != 0 ||
+            header.data > m_length ||
+            (m_length - header.data) / (stride ? stride : 1) < header.samples)
+        {
+            munmap(m_address, m_length);
+            throw std::runtime_error("Invalid dataset file " + path + " for this scalar type");
+        }
+
+        m_samples = Samples<T>(
+            reinterpret_cast<const T*>(base + header.data),
+            header.samples,
+            header.inputs,
+            header.outputs,
+            true);
+    }
+
+    template <typename T>
+    Mapped_dataset<T>::~Mapped_dataset()
+    {
+        munmap(m_address, m_length);
+    }
+
+    template <typename T>
+    const Samples<T>& Mapped_dataset<T>::samples() const
+    {
+        return m_samples;
+    }
+
+    template <typename T>
+    size_t Mapped_dataset<T>::size() const
+    {
+        return m_samples.size();
+    }
+
+    template <typename T>
+    size_t Mapped_dataset<T>::inputs() const
+    {
+        return static_cast<const dataset::Header*>(m_address)->inputs;
+    }
+
+    template <typename T>
+    size_t Mapped_dataset<T>::outputs() const
+    {
+        return static_cast<const dataset::Header*>(m_address)->outputs;
+    }
+
+    template class Dataset_writer<double>;
+    template class Dataset_writer<float>;
+
+    template void save_dataset(const std::vector<Training_data<double>> &data, const std::string &path);
+    template void save_dataset(const std::vector<Training_data<float>> &data, const std::string &path);
+
+    template class Mapped_dataset<double>;
+    template class Mapped_dataset<float>;
+}
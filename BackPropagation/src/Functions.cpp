@@ -0,0 +1,63 @@
+/*
+ * Functions.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include "functions/Activation_function.hpp"
+#include "functions/Leaky_relu.hpp"
+#include "functions/Relu.hpp"
+#include "functions/Sigmoid.hpp"
+#include "functions/Softmax.hpp"
+#include "functions/Softplus.hpp"
+#include "functions/Tanh.hpp"
+
+namespace BackPropagation
+{
+    namespace functions
+    {
+        namespace
+        {
+            /** @return F if name is its NAME, nullptr otherwise */
+            template <typename F, typename T>
+            Activation_function_cPtr<T> create_if(const std::string &name)
+            {
+                if (name == F::NAME)
+                {
+                    return std::make_shared<const F>();
+                }
+
+                return nullptr;
+            }
+        }
+
+        template <typename T>
+        Activation_function_cPtr<T> create(const std::string &name)
+        {
+            const Activation_function_cPtr<T> candidates[] = {
+                create_if<Sigmoid<T>, T>(name),
+                create_if<Sigmoid<T, Precision::FAST>, T>(name),
+                create_if<Tanh<T>, T>(name),
+                create_if<Tanh<T, Precision::FAST>, T>(name),
+                create_if<Softplus<T>, T>(name),
+                create_if<Softplus<T, Precision::FAST>, T>(name),
+                create_if<Softmax<T>, T>(name),
+                create_if<Softmax<T, Precision::FAST>, T>(name),
+                create_if<Relu<T>, T>(name),
+                create_if<Leaky_relu<T>, T>(name) };
+
+            for (const auto &candidate : candidates)
+            {
+                if (candidate)
+                {
+                    return candidate;
+                }
+            }
+
+            return nullptr;
+        }
+
+        template Activation_function_cPtr<double> create<double>(const std::string &name);
+        template Activation_function_cPtr<float> create<float>(const std::string &name);
+    }
+}
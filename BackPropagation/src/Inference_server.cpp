@@ -0,0 +1,582 @@
+/*
+ * Inference_server.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "Inference_server.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        /** @return false if the connection is closed before size bytes are read */
+        bool read_all(int fd, void *data, size_t size)
+        {
+            char *bytes = static_cast<char*>(data);
+
+            while (size > 0)
+            {
+                ssize_t count = read(fd, bytes, size);
+
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (count <= 0)
+                {
+                    return false;
+                }
+
+                bytes += count;
+                size -= count;
+            }
+
+            return true;
+        }
+
+        /** @return false if the connection is closed before size bytes are written */
+        bool write_all(int fd, const void *data, size_t size)
+        {
+            const char *bytes = static_cast<const char*>(data);
+
+            while (size > 0)
+            {
+                ssize_t count = send(fd, bytes, size, MSG_NOSIGNAL);
+
+                if (count < 0 && errno == EINTR)
+                {
+                    continue;
+                }
+                if (count <= 0)
+                {
+                    return false;
+                }
+
+                bytes += count;
+                size -= count;
+            }
+
+            return true;
+        }
+
+        /** @return the address of a Unix domain socket */
+        sockaddr_un unix_address(const std::string &path)
+        {
+            sockaddr_un address = {};
+
+            if (path.size() >= sizeof(address.sun_path))
+            {
+                throw std::runtime_error("Socket path too long " + path);
+            }
+
+            address.sun_family = AF_UNIX;
+            memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+            return address;
+        }
+
+        /** @return the address of a TCP port of localhost */
+        sockaddr_in local_address(uint16_t port)
+        {
+            sockaddr_in address = {};
+
+            address.sin_family = AF_INET;
+            address.sin_port = htons(port);
+            address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+            return address;
+        }
+
+        /** Requests are small, send them without waiting to fill a packet */
+        void disable_nagle(int fd)
+        {
+            int enable = 1;
+
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        }
+
+        /** @return p-quantile of values, which are reordered */
+        float quantile(std::vector<float> &values, double p)
+        {
+            if (values.empty())
+            {
+                return 0.0f;
+            }
+
+            auto nth = values.begin() + (size_t) (p * (values.size() - 1));
+
+            std::nth_element(values.begin(), nth, values.end());
+
+            return *nth;
+        }
+    }
+
+    Server_settings::Server_settings() :
+        port(serving::DEFAULT_PORT),
+        max_batch(32),
+        max_delay(1000),
+        workers(std::max(1u, std::thread::hardware_concurrency()))
+    {
+    }
+
+    template <typename T>
+    Inference_server<T>::Inference_server(const Mapped_network<T> &network, const Server_settings &settings) :
+        m_network(network),
+        m_settings(settings),
+        m_listener(-1),
+        m_pool(std::max<size_t>(1, settings.workers)),
+        m_start(Clock::now()),
+        m_queued_samples(0),
+        m_forming(false),
+        m_stop(false),
+        m_stats()
+    {
+        int result;
+
+        m_settings.max_batch = std::max<size_t>(1, m_settings.max_batch);
+
+        if (m_settings.socket_path.empty())
+        {
+            sockaddr_in address = local_address(m_settings.port);
+            int enable = 1;
+
+            m_listener = socket(AF_INET, SOCK_STREAM, 0);
+            setsockopt(m_listener, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+            result = bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        }
+        else
+        {
+            sockaddr_un address = unix_address(m_settings.socket_path);
+
+            // A socket left by a previous server would make bind() fail.
+            unlink(m_settings.socket_path.c_str());
+
+            m_listener = socket(AF_UNIX, SOCK_STREAM, 0);
+            result = bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        }
+
+        if (m_listener < 0 || result != 0 || listen(m_listener, SOMAXCONN) != 0)
+        {
+            std::string error = strerror(errno);
+
+            if (m_listener >= 0)
+            {
+                close(m_listener);
+            }
+
+            throw std::runtime_error("Can not listen on " +
+                                     (m_settings.socket_path.empty() ? "port " + std::to_string(m_settings.port)
+                                                                     : m_settings.socket_path) + ": " + error);
+        }
+    }
+
+    template <typename T>
+    Inference_server<T>::~Inference_server()
+    {
+        close(m_listener);
+
+        if (!m_settings.socket_path.empty())
+        {
+            unlink(m_settings.socket_path.c_str());
+        }
+    }
+
+    template <typename T>
+    void Inference_server<T>::run()
+    {
+        std::thread acceptor(&Inference_server::accept_connections, this);
+
+        m_pool.run([this](size_t) {
+            run_batches();
+        });
+
+        acceptor.join();
+
+        // The connections were shut down by stop(), their threads are ending.
+        for (auto &connection : m_connections)
+        {
+            connection.thread.join();
+            close(connection.fd);
+        }
+
+        m_connections.clear();
+    }
+
+    template <typename T>
+    void Inference_server<T>::stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            m_stop = true;
+
+            // Wakes accept() and the reads of the connections
+            shutdown(m_listener, SHUT_RDWR);
+
+            for (auto &connection : m_connections)
+            {
+                shutdown(connection.fd, SHUT_RDWR);
+            }
+        }
+
+        m_queued.notify_all();
+    }
+
+    template <typename T>
+    serving::Stats Inference_server<T>::stats()
+    {
+        std::vector<float> latencies;
+        serving::Stats stats;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            latencies = m_latencies;
+            stats = m_stats;
+        }
+
+        stats.seconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+        stats.p50 = quantile(latencies, 0.5);
+        stats.p99 = quantile(latencies, 0.99);
+
+        return stats;
+    }
+
+    template <typename T>
+    void Inference_server<T>::accept_connections()
+    {
+        while (true)
+        {
+            int fd = accept(m_listener, nullptr, nullptr);
+
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                {
+                    continue;
+                }
+
+                // Shut down by stop()
+                return;
+            }
+
+            if (m_settings.socket_path.empty())
+            {
+                disable_nagle(fd);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_stop)
+            {
+                close(fd);
+                return;
+            }
+
+            // Join the connections which ended, their threads only have to return.
+            for (auto it = m_connections.begin(); it != m_connections.end();)
+            {
+                if (it->finished)
+                {
+                    it->thread.join();
+                    close(it->fd);
+                    it = m_connections.erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+
+            m_connections.emplace_back();
+
+            Connection &connection = m_connections.back();
+
+            connection.fd = fd;
+            connection.finished = false;
+            connection.thread = std::thread(&Inference_server::serve_connection, this, std::ref(connection));
+        }
+    }
+
+    template <typename T>
+    void Inference_server<T>::serve_connection(Connection &connection)
+    {
+        const serving::Hello hello = { (uint32_t) m_network.inputs(), (uint32_t) m_network.outputs(), sizeof(T) };
+        std::vector<T> inputs;
+        std::vector<T> outputs;
+        Request request;
+        uint32_t count;
+        bool open = write_all(connection.fd, &hello, sizeof(hello));
+
+        while (open && read_all(connection.fd, &count, sizeof(count)))
+        {
+            if (count == serving::STATS_REQUEST)
+            {
+                serving::Stats current = stats();
+
+                open = write_all(connection.fd, &current, sizeof(current));
+                continue;
+            }
+
+            if (count > serving::MAX_REQUEST)
+            {
+                break;
+            }
+
+            inputs.resize((size_t) count * hello.inputs);
+            outputs.resize((size_t) count * hello.outputs);
+
+            if (!read_all(connection.fd, inputs.data(), inputs.size() * sizeof(T)))
+            {
+                break;
+            }
+
+            request.inputs = inputs.data();
+            request.outputs = outputs.data();
+            request.count = count;
+            request.arrival = Clock::now();
+            request.done = false;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+
+                // The workers answer every request queued before stopping.
+                if (m_stop)
+                {
+                    break;
+                }
+
+                m_queue.push_back(&request);
+                m_queued_samples += count;
+                m_queued.notify_all();
+
+                request.completed.wait(lock, [&] { return request.done; });
+            }
+
+            open = write_all(connection.fd, outputs.data(), outputs.size() * sizeof(T));
+
+            const float latency = std::chrono::duration<float, std::micro>(Clock::now() - request.arrival).count();
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_latencies.size() < serving::LATENCY_WINDOW)
+            {
+                m_latencies.push_back(latency);
+            }
+            else
+            {
+                m_latencies[m_stats.requests % serving::LATENCY_WINDOW] = latency;
+            }
+
+            m_stats.requests++;
+            m_stats.samples += count;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        connection.finished = true;
+    }
+
+    template <typename T>
+    void Inference_server<T>::run_batches()
+    {
+        const size_t inputSize = m_network.inputs();
+        const size_t outputSize = m_network.outputs();
+        const auto maxDelay = std::chrono::microseconds(m_settings.max_delay);
+
+        Workspace<T> workspace = m_network.create_workspace(m_settings.max_batch);
+        std::vector<T> inputs(m_settings.max_batch * inputSize);
+        std::vector<T> outputs(m_settings.max_batch * outputSize);
+        std::vector<Request*> batch;
+
+        while (true)
+        {
+            size_t samples = 0;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+
+                // One worker at a time waits for a batch to fill.
+                m_queued.wait(lock, [&] { return m_queue.empty() ? m_stop : !m_forming; });
+
+                if (m_queue.empty())
+                {
+                    return;
+                }
+
+                m_forming = true;
+
+                const Clock::time_point deadline = m_queue.front()->arrival + maxDelay;
+
+                m_queued.wait_until(lock, deadline, [&] {
+                    return m_stop || m_queued_samples >= m_settings.max_batch;
+                });
+
+                // Whole requests, the first one even if it is larger than a batch
+                batch.clear();
+
+                while (!m_queue.empty() &&
+                       (batch.empty() || samples + m_queue.front()->count <= m_settings.max_batch))
+                {
+                    batch.push_back(m_queue.front());
+                    samples += m_queue.front()->count;
+                    m_queue.pop_front();
+                }
+
+                m_queued_samples -= samples;
+                m_forming = false;
+                m_stats.batches++;
+            }
+
+            m_queued.notify_all();
+
+            if (inputs.size() < samples * inputSize)
+            {
+                inputs.resize(samples * inputSize);
+                outputs.resize(samples * outputSize);
+            }
+
+            T *position = inputs.data();
+
+            for (const Request *request : batch)
+            {
+                position = std::copy(request->inputs, request->inputs + request->count * inputSize, position);
+            }
+
+            m_network.test(workspace, inputs.data(), samples, outputs.data());
+
+            const T *output = outputs.data();
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            for (Request *request : batch)
+            {
+                const size_t size = request->count * outputSize;
+
+                std::copy(output, output + size, request->outputs);
+                output += size;
+
+                request->done = true;
+                request->completed.notify_one();
+            }
+        }
+    }
+
+    template <typename T>
+    Inference_client<T>::Inference_client(const std::string &socketPath) :
+        m_fd(socket(AF_UNIX, SOCK_STREAM, 0)),
+        m_hello()
+    {
+        sockaddr_un address = unix_address(socketPath);
+
+        if (m_fd < 0 || connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::string error = strerror(errno);
+
+            close(m_fd);
+            throw std::runtime_error("Can not connect to " + socketPath + ": " + error);
+        }
+
+        handshake();
+    }
+
+    template <typename T>
+    Inference_client<T>::Inference_client(uint16_t port) :
+        m_fd(socket(AF_INET, SOCK_STREAM, 0)),
+        m_hello()
+    {
+        sockaddr_in address = local_address(port);
+
+        if (m_fd < 0 || connect(m_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0)
+        {
+            std::string error = strerror(errno);
+
+            close(m_fd);
+            throw std::runtime_error("Can not connect to port " + std::to_string(port) + ": " + error);
+        }
+
+        disable_nagle(m_fd);
+        handshake();
+    }
+
+    template <typename T>
+    Inference_client<T>::~Inference_client()
+    {
+        close(m_fd);
+    }
+
+    template <typename T>
+    void Inference_client<T>::handshake()
+    {
+        if (!read_all(m_fd, &m_hello, sizeof(m_hello)))
+        {
+            close(m_fd);
+            throw std::runtime_error("Connection closed by the server");
+        }
+
+        if (m_hello.scalar_size != sizeof(T))
+        {
+            close(m_fd);
+            throw std::invalid_argument("Server uses another scalar type");
+        }
+    }
+
+    template <typename T>
+    void Inference_client<T>::test(const T *inputs, size_t count, T *outputs)
+    {
+        const uint32_t header = (uint32_t) count;
+
+        if (count == 0)
+        {
+            return;
+        }
+
+        if (!write_all(m_fd, &header, sizeof(header)) ||
+            !write_all(m_fd, inputs, count * m_hello.inputs * sizeof(T)) ||
+            !read_all(m_fd, outputs, count * m_hello.outputs * sizeof(T)))
+        {
+            throw std::runtime_error("Connection closed by the server");
+        }
+    }
+
+    template <typename T>
+    serving::Stats Inference_client<T>::stats()
+    {
+        const uint32_t header = serving::STATS_REQUEST;
+        serving::Stats stats;
+
+        if (!write_all(m_fd, &header, sizeof(header)) || !read_all(m_fd, &stats, sizeof(stats)))
+        {
+            throw std::runtime_error("Connection closed by the server");
+        }
+
+        return stats;
+    }
+
+    template <typename T>
+    size_t Inference_client<T>::inputs() const
+    {
+        return m_hello.inputs;
+    }
+
+    template <typename T>
+    size_t Inference_client<T>::outputs() const
+    {
+        return m_hello.outputs;
+    }
+
+    template class Inference_server<double>;
+    template class Inference_server<float>;
+    template class Inference_client<double>;
+    template class Inference_client<float>;
+}
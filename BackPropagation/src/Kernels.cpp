@@ -0,0 +1,301 @@
+/*
+ * Kernels.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <cmath>
+#include <initializer_list>
+
+#include "Kernels.hpp"
+#include "functions/Fast_math.hpp"
+
+namespace BackPropagation
+{
+    namespace kernels
+    {
+        namespace
+        {
+            template <typename T>
+            T dot(const T *x, const T *y, size_t count)
+            {
+                T sum = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    sum += x[i] * y[i];
+                }
+
+                return sum;
+            }
+
+            template <typename T>
+            void dot4(
+                const T *x0,
+                const T *x1,
+                const T *x2,
+                const T *x3,
+                const T *y,
+                size_t count,
+                T *sums)
+            {
+                T s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    s0 += x0[i] * y[i];
+                    s1 += x1[i] * y[i];
+                    s2 += x2[i] * y[i];
+                    s3 += x3[i] * y[i];
+                }
+
+                sums[0] = s0;
+                sums[1] = s1;
+                sums[2] = s2;
+                sums[3] = s3;
+            }
+
+            template <typename T>
+            void axpy(T alpha, const T *x, T *y, size_t count)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    y[i] += alpha * x[i];
+                }
+            }
+
+            template <typename T>
+            T sparse_dot(const T *values, const uint32_t *columns, const T *x, size_t count)
+            {
+                T sum = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    sum += values[i] * x[columns[i]];
+                }
+
+                return sum;
+            }
+
+            template <typename T>
+            void adjust(
+                T delta,
+                const T *inputs,
+                T *weights,
+                T *momentums,
+                T *errors,
+                size_t count)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    T momentum = momentums[i];
+                    momentums[i] = inputs[i] * delta;
+                    weights[i] += momentums[i] + momentum;
+                    errors[i] += weights[i] * delta;
+                }
+            }
+
+            template <typename T>
+            void apply(
+                T scale,
+                const T *gradients,
+                T *weights,
+                T *momentums,
+                size_t count)
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    T momentum = momentums[i];
+                    momentums[i] = gradients[i] * scale;
+                    weights[i] += momentums[i] + momentum;
+                }
+            }
+
+#define TARGET
+#include "Kernels_optimizers.inc"
+#include "Kernels_activations.inc"
+#undef TARGET
+
+            int32_t dot_int8(const uint8_t *x, const int8_t *w, size_t count)
+            {
+                int32_t sum = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    sum += x[i] * w[i];
+                }
+
+                return sum;
+            }
+
+            template <typename T>
+            const Table<T>& best()
+            {
+                // Widest instruction set first
+                for (Isa isa : { Isa::AVX512, Isa::AVX2, Isa::SSE2 })
+                {
+                    if (supported(isa))
+                    {
+                        return get<T>(isa);
+                    }
+                }
+
+                return scalar_table<T>();
+            }
+
+            template <typename T>
+            const Table<T>*& current()
+            {
+                static const Table<T> *table = &best<T>();
+                return table;
+            }
+        }
+
+        template <>
+        const Table<double>& scalar_table<double>()
+        {
+            static const Table<double> table = {
+                Isa::SCALAR, "scalar", dot<double>, dot4<double>, axpy<double>, sparse_dot<double>, adjust<double>, apply<double>,
+                optimize<Sgd_rule, Scalar_ops<double>>,
+                optimize<Nesterov_rule, Scalar_ops<double>>,
+                optimize<Rmsprop_rule, Scalar_ops<double>>,
+                optimize<Adam_rule, Scalar_ops<double>>,
+                { masked_optimize<Classic_rule, Scalar_ops<double>>,
+                  masked_optimize<Sgd_rule, Scalar_ops<double>>,
+                  masked_optimize<Nesterov_rule, Scalar_ops<double>>,
+                  masked_optimize<Rmsprop_rule, Scalar_ops<double>>,
+                  masked_optimize<Adam_rule, Scalar_ops<double>> },
+                fast_sigmoid<Scalar_ops<double>>,
+                fast_tanh<Scalar_ops<double>>,
+                fast_softplus<Scalar_ops<double>>,
+                fast_exp_sum<Scalar_ops<double>> };
+            return table;
+        }
+
+        template <>
+        const Table<float>& scalar_table<float>()
+        {
+            static const Table<float> table = {
+                Isa::SCALAR, "scalar", dot<float>, dot4<float>, axpy<float>, sparse_dot<float>, adjust<float>, apply<float>,
+                optimize<Sgd_rule, Scalar_ops<float>>,
+                optimize<Nesterov_rule, Scalar_ops<float>>,
+                optimize<Rmsprop_rule, Scalar_ops<float>>,
+                optimize<Adam_rule, Scalar_ops<float>>,
+                { masked_optimize<Classic_rule, Scalar_ops<float>>,
+                  masked_optimize<Sgd_rule, Scalar_ops<float>>,
+                  masked_optimize<Nesterov_rule, Scalar_ops<float>>,
+                  masked_optimize<Rmsprop_rule, Scalar_ops<float>>,
+                  masked_optimize<Adam_rule, Scalar_ops<float>> },
+                fast_sigmoid<Scalar_ops<float>>,
+                fast_tanh<Scalar_ops<float>>,
+                fast_softplus<Scalar_ops<float>>,
+                fast_exp_sum<Scalar_ops<float>> };
+            return table;
+        }
+
+        const Int8_table& scalar_int8_table()
+        {
+            static const Int8_table table = { Isa::SCALAR, "scalar", dot_int8 };
+            return table;
+        }
+
+        bool supported(Isa isa)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_cpu_init();
+
+            switch (isa)
+            {
+                case Isa::SCALAR:
+                    return true;
+                case Isa::SSE2:
+                    return __builtin_cpu_supports("sse2");
+                case Isa::AVX2:
+                    return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+                case Isa::AVX512:
+                    return __builtin_cpu_supports("avx512f");
+            }
+
+            return false;
+#else
+            return isa == Isa::SCALAR;
+#endif
+        }
+
+        template <typename T>
+        const Table<T>& get(Isa isa)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            switch (isa)
+            {
+                case Isa::SSE2:
+                    return sse2_table<T>();
+                case Isa::AVX2:
+                    return avx2_table<T>();
+                case Isa::AVX512:
+                    return avx512_table<T>();
+                default:
+                    return scalar_table<T>();
+            }
+#else
+            return scalar_table<T>();
+#endif
+        }
+
+        template <typename T>
+        const Table<T>& active()
+        {
+            return *current<T>();
+        }
+
+        const Int8_table& get_int8(Isa isa)
+        {
+#if defined(__x86_64__) || defined(__i386__)
+            switch (isa)
+            {
+                case Isa::AVX2:
+                    return avx2_int8_table();
+                case Isa::AVX512:
+                    __builtin_cpu_init();
+
+                    if (__builtin_cpu_supports("avx512vnni"))
+                    {
+                        return vnni_int8_table();
+                    }
+                    if (__builtin_cpu_supports("avx512bw"))
+                    {
+                        return avx512_int8_table();
+                    }
+                    return avx2_int8_table();
+                default:
+                    // No byte multiply-add before AVX2
+                    return scalar_int8_table();
+            }
+#else
+            return scalar_int8_table();
+#endif
+        }
+
+        const Int8_table& active_int8()
+        {
+            return get_int8(active<double>().isa);
+        }
+
+        bool select(Isa isa)
+        {
+            if (!supported(isa))
+            {
+                return false;
+            }
+
+            current<double>() = &get<double>(isa);
+            current<float>() = &get<float>(isa);
+            return true;
+        }
+
+        template const Table<double>& get<double>(Isa isa);
+        template const Table<float>& get<float>(Isa isa);
+        template const Table<double>& active<double>();
+        template const Table<float>& active<float>();
+    }
+}
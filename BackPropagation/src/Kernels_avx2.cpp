@@ -0,0 +1,465 @@
+/*
+ * Kernels_avx2.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include "Kernels.hpp"
+#include "functions/Fast_math.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// GCC 12 reports the undefined registers of its own intrinsics as uninitialized (bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+
+#include <cmath>
+
+#define TARGET __attribute__((target("avx2,fma")))
+
+namespace BackPropagation
+{
+    namespace kernels
+    {
+        namespace
+        {
+            // double
+
+            TARGET inline double horizontal_sum(__m256d v)
+            {
+                __m128d sum = _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1));
+
+                return _mm_cvtsd_f64(_mm_add_sd(sum, _mm_unpackhi_pd(sum, sum)));
+            }
+
+            TARGET double dot(const double *x, const double *y, size_t count)
+            {
+                __m256d s0 = _mm256_setzero_pd();
+                __m256d s1 = _mm256_setzero_pd();
+                size_t i = 0;
+
+                // Two accumulators to hide the latency of the additions
+                for (; i + 2 * 4 <= count; i += 2 * 4)
+                {
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+                    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i + 4), _mm256_loadu_pd(y + i + 4), s1);
+                }
+                for (; i + 4 <= count; i += 4)
+                {
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i), s0);
+                }
+
+                double sum = horizontal_sum(_mm256_add_pd(s0, s1));
+
+                for (; i < count; ++i)
+                {
+                    sum += x[i] * y[i];
+                }
+
+                return sum;
+            }
+
+            TARGET void dot4(
+                const double *x0,
+                const double *x1,
+                const double *x2,
+                const double *x3,
+                const double *y,
+                size_t count,
+                double *sums)
+            {
+                __m256d s0 = _mm256_setzero_pd();
+                __m256d s1 = _mm256_setzero_pd();
+                __m256d s2 = _mm256_setzero_pd();
+                __m256d s3 = _mm256_setzero_pd();
+                size_t i = 0;
+
+                for (; i + 4 <= count; i += 4)
+                {
+                    __m256d vy = _mm256_loadu_pd(y + i);
+
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x0 + i), vy, s0);
+                    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x1 + i), vy, s1);
+                    s2 = _mm256_fmadd_pd(_mm256_loadu_pd(x2 + i), vy, s2);
+                    s3 = _mm256_fmadd_pd(_mm256_loadu_pd(x3 + i), vy, s3);
+                }
+
+                sums[0] = horizontal_sum(s0);
+                sums[1] = horizontal_sum(s1);
+                sums[2] = horizontal_sum(s2);
+                sums[3] = horizontal_sum(s3);
+
+                for (; i < count; ++i)
+                {
+                    sums[0] += x0[i] * y[i];
+                    sums[1] += x1[i] * y[i];
+                    sums[2] += x2[i] * y[i];
+                    sums[3] += x3[i] * y[i];
+                }
+            }
+
+            TARGET void axpy(double alpha, const double *x, double *y, size_t count)
+            {
+                __m256d va = _mm256_set1_pd(alpha);
+                size_t i = 0;
+
+                for (; i + 4 <= count; i += 4)
+                {
+                    _mm256_storeu_pd(y + i, _mm256_fmadd_pd(va, _mm256_loadu_pd(x + i), _mm256_loadu_pd(y + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    y[i] += alpha * x[i];
+                }
+            }
+
+            TARGET double sparse_dot(const double *values, const uint32_t *columns, const double *x, size_t count)
+            {
+                __m256d s0 = _mm256_setzero_pd();
+                size_t i = 0;
+
+                // The inputs of four weights gathered at once
+                for (; i + 4 <= count; i += 4)
+                {
+                    __m128i indices = _mm_loadu_si128((const __m128i*) (columns + i));
+
+                    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(values + i), _mm256_i32gather_pd(x, indices, 8), s0);
+                }
+
+                double sum = horizontal_sum(s0);
+
+                for (; i < count; ++i)
+                {
+                    sum += values[i] * x[columns[i]];
+                }
+
+                return sum;
+            }
+
+            TARGET void adjust(
+                double delta,
+                const double *inputs,
+                double *weights,
+                double *momentums,
+                double *errors,
+                size_t count)
+            {
+                __m256d vd = _mm256_set1_pd(delta);
+                size_t i = 0;
+
+                for (; i + 4 <= count; i += 4)
+                {
+                    __m256d previous = _mm256_loadu_pd(momentums + i);
+                    __m256d momentum = _mm256_mul_pd(_mm256_loadu_pd(inputs + i), vd);
+                    __m256d weight = _mm256_add_pd(_mm256_loadu_pd(weights + i), _mm256_add_pd(momentum, previous));
+
+                    _mm256_storeu_pd(momentums + i, momentum);
+                    _mm256_storeu_pd(weights + i, weight);
+                    _mm256_storeu_pd(errors + i, _mm256_fmadd_pd(weight, vd, _mm256_loadu_pd(errors + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    double momentum = momentums[i];
+                    momentums[i] = inputs[i] * delta;
+                    weights[i] += momentums[i] + momentum;
+                    errors[i] += weights[i] * delta;
+                }
+            }
+
+            TARGET void apply(
+                double scale,
+                const double *gradients,
+                double *weights,
+                double *momentums,
+                size_t count)
+            {
+                __m256d vs = _mm256_set1_pd(scale);
+                size_t i = 0;
+
+                for (; i + 4 <= count; i += 4)
+                {
+                    __m256d previous = _mm256_loadu_pd(momentums + i);
+                    __m256d momentum = _mm256_mul_pd(_mm256_loadu_pd(gradients + i), vs);
+
+                    _mm256_storeu_pd(momentums + i, momentum);
+                    _mm256_storeu_pd(weights + i, _mm256_add_pd(_mm256_loadu_pd(weights + i), _mm256_add_pd(momentum, previous)));
+                }
+                for (; i < count; ++i)
+                {
+                    double momentum = momentums[i];
+                    momentums[i] = gradients[i] * scale;
+                    weights[i] += momentums[i] + momentum;
+                }
+            }
+
+            // float
+
+            TARGET inline float horizontal_sum(__m256 v)
+            {
+                __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+
+                sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+                return _mm_cvtss_f32(_mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1)));
+            }
+
+            TARGET float dot(const float *x, const float *y, size_t count)
+            {
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                size_t i = 0;
+
+                // Two accumulators to hide the latency of the additions
+                for (; i + 2 * 8 <= count; i += 2 * 8)
+                {
+                    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+                    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i + 8), _mm256_loadu_ps(y + i + 8), s1);
+                }
+                for (; i + 8 <= count; i += 8)
+                {
+                    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i), s0);
+                }
+
+                float sum = horizontal_sum(_mm256_add_ps(s0, s1));
+
+                for (; i < count; ++i)
+                {
+                    sum += x[i] * y[i];
+                }
+
+                return sum;
+            }
+
+            TARGET void dot4(
+                const float *x0,
+                const float *x1,
+                const float *x2,
+                const float *x3,
+                const float *y,
+                size_t count,
+                float *sums)
+            {
+                __m256 s0 = _mm256_setzero_ps();
+                __m256 s1 = _mm256_setzero_ps();
+                __m256 s2 = _mm256_setzero_ps();
+                __m256 s3 = _mm256_setzero_ps();
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m256 vy = _mm256_loadu_ps(y + i);
+
+                    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(x0 + i), vy, s0);
+                    s1 = _mm256_fmadd_ps(_mm256_loadu_ps(x1 + i), vy, s1);
+                    s2 = _mm256_fmadd_ps(_mm256_loadu_ps(x2 + i), vy, s2);
+                    s3 = _mm256_fmadd_ps(_mm256_loadu_ps(x3 + i), vy, s3);
+                }
+
+                sums[0] = horizontal_sum(s0);
+                sums[1] = horizontal_sum(s1);
+                sums[2] = horizontal_sum(s2);
+                sums[3] = horizontal_sum(s3);
+
+                for (; i < count; ++i)
+                {
+                    sums[0] += x0[i] * y[i];
+                    sums[1] += x1[i] * y[i];
+                    sums[2] += x2[i] * y[i];
+                    sums[3] += x3[i] * y[i];
+                }
+            }
+
+            TARGET void axpy(float alpha, const float *x, float *y, size_t count)
+            {
+                __m256 va = _mm256_set1_ps(alpha);
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    _mm256_storeu_ps(y + i, _mm256_fmadd_ps(va, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    y[i] += alpha * x[i];
+                }
+            }
+
+            TARGET float sparse_dot(const float *values, const uint32_t *columns, const float *x, size_t count)
+            {
+                __m256 s0 = _mm256_setzero_ps();
+                size_t i = 0;
+
+                // The inputs of eight weights gathered at once
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m256i indices = _mm256_loadu_si256((const __m256i*) (columns + i));
+
+                    s0 = _mm256_fmadd_ps(_mm256_loadu_ps(values + i), _mm256_i32gather_ps(x, indices, 4), s0);
+                }
+
+                float sum = horizontal_sum(s0);
+
+                for (; i < count; ++i)
+                {
+                    sum += values[i] * x[columns[i]];
+                }
+
+                return sum;
+            }
+
+            TARGET void adjust(
+                float delta,
+                const float *inputs,
+                float *weights,
+                float *momentums,
+                float *errors,
+                size_t count)
+            {
+                __m256 vd = _mm256_set1_ps(delta);
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m256 previous = _mm256_loadu_ps(momentums + i);
+                    __m256 momentum = _mm256_mul_ps(_mm256_loadu_ps(inputs + i), vd);
+                    __m256 weight = _mm256_add_ps(_mm256_loadu_ps(weights + i), _mm256_add_ps(momentum, previous));
+
+                    _mm256_storeu_ps(momentums + i, momentum);
+                    _mm256_storeu_ps(weights + i, weight);
+                    _mm256_storeu_ps(errors + i, _mm256_fmadd_ps(weight, vd, _mm256_loadu_ps(errors + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    float momentum = momentums[i];
+                    momentums[i] = inputs[i] * delta;
+                    weights[i] += momentums[i] + momentum;
+                    errors[i] += weights[i] * delta;
+                }
+            }
+
+            TARGET void apply(
+                float scale,
+                const float *gradients,
+                float *weights,
+                float *momentums,
+                size_t count)
+            {
+                __m256 vs = _mm256_set1_ps(scale);
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m256 previous = _mm256_loadu_ps(momentums + i);
+                    __m256 momentum = _mm256_mul_ps(_mm256_loadu_ps(gradients + i), vs);
+
+                    _mm256_storeu_ps(momentums + i, momentum);
+                    _mm256_storeu_ps(weights + i, _mm256_add_ps(_mm256_loadu_ps(weights + i), _mm256_add_ps(momentum, previous)));
+                }
+                for (; i < count; ++i)
+                {
+                    float momentum = momentums[i];
+                    momentums[i] = gradients[i] * scale;
+                    weights[i] += momentums[i] + momentum;
+                }
+            }
+
+            // Optimizers
+
+            template <typename T>
+            struct Vector_ops;
+
+            template <>
+            struct Vector_ops<double>
+            {
+                    typedef double scalar;
+                    typedef __m256d type;
+                    static constexpr size_t WIDTH = 4;
+
+                    TARGET static inline type set1(double x) { return _mm256_set1_pd(x); }
+                    TARGET static inline type load(const double *p) { return _mm256_loadu_pd(p); }
+                    TARGET static inline type load_mask(const uint8_t *p) { return _mm256_cvtepi32_pd(_mm_cvtepu8_epi32(_mm_loadu_si32(p))); }
+                    TARGET static inline void store(double *p, type x) { _mm256_storeu_pd(p, x); }
+                    TARGET static inline type add(type a, type b) { return _mm256_add_pd(a, b); }
+                    TARGET static inline type sub(type a, type b) { return _mm256_sub_pd(a, b); }
+                    TARGET static inline type mul(type a, type b) { return _mm256_mul_pd(a, b); }
+                    TARGET static inline type div(type a, type b) { return _mm256_div_pd(a, b); }
+                    TARGET static inline type fmadd(type a, type b, type c) { return _mm256_fmadd_pd(a, b, c); }
+                    TARGET static inline type sqrt(type a) { return _mm256_sqrt_pd(a); }
+                    TARGET static inline type min(type a, type b) { return _mm256_min_pd(a, b); }
+                    TARGET static inline type max(type a, type b) { return _mm256_max_pd(a, b); }
+                    TARGET static inline type pow2(type biased) { return _mm256_castsi256_pd(_mm256_add_epi64(_mm256_slli_epi64(_mm256_castpd_si256(biased), 52), _mm256_set1_epi64x(1023ll << 52))); }
+            };
+
+            template <>
+            struct Vector_ops<float>
+            {
+                    typedef float scalar;
+                    typedef __m256 type;
+                    static constexpr size_t WIDTH = 8;
+
+                    TARGET static inline type set1(float x) { return _mm256_set1_ps(x); }
+                    TARGET static inline type load(const float *p) { return _mm256_loadu_ps(p); }
+                    TARGET static inline type load_mask(const uint8_t *p) { return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) p))); }
+                    TARGET static inline void store(float *p, type x) { _mm256_storeu_ps(p, x); }
+                    TARGET static inline type add(type a, type b) { return _mm256_add_ps(a, b); }
+                    TARGET static inline type sub(type a, type b) { return _mm256_sub_ps(a, b); }
+                    TARGET static inline type mul(type a, type b) { return _mm256_mul_ps(a, b); }
+                    TARGET static inline type div(type a, type b) { return _mm256_div_ps(a, b); }
+                    TARGET static inline type fmadd(type a, type b, type c) { return _mm256_fmadd_ps(a, b, c); }
+                    TARGET static inline type sqrt(type a) { return _mm256_sqrt_ps(a); }
+                    TARGET static inline type min(type a, type b) { return _mm256_min_ps(a, b); }
+                    TARGET static inline type max(type a, type b) { return _mm256_max_ps(a, b); }
+                    TARGET static inline type pow2(type biased) { return _mm256_castsi256_ps(_mm256_add_epi32(_mm256_slli_epi32(_mm256_castps_si256(biased), 23), _mm256_set1_epi32(127 << 23))); }
+            };
+
+#include "Kernels_optimizers.inc"
+#include "Kernels_activations.inc"
+        }
+
+        template <>
+        const Table<double>& avx2_table<double>()
+        {
+            static const Table<double> table = {
+                Isa::AVX2, "avx2", dot, dot4, axpy, sparse_dot, adjust, apply,
+                optimize<Sgd_rule, Vector_ops<double>>,
+                optimize<Nesterov_rule, Vector_ops<double>>,
+                optimize<Rmsprop_rule, Vector_ops<double>>,
+                optimize<Adam_rule, Vector_ops<double>>,
+                { masked_optimize<Classic_rule, Vector_ops<double>>,
+                  masked_optimize<Sgd_rule, Vector_ops<double>>,
+                  masked_optimize<Nesterov_rule, Vector_ops<double>>,
+                  masked_optimize<Rmsprop_rule, Vector_ops<double>>,
+                  masked_optimize<Adam_rule, Vector_ops<double>> },
+                fast_sigmoid<Vector_ops<double>>,
+                fast_tanh<Vector_ops<double>>,
+                fast_softplus<Vector_ops<double>>,
+                fast_exp_sum<Vector_ops<double>> };
+            return table;
+        }
+
+        template <>
+        const Table<float>& avx2_table<float>()
+        {
+            static const Table<float> table = {
+                Isa::AVX2, "avx2", dot, dot4, axpy, sparse_dot, adjust, apply,
+                optimize<Sgd_rule, Vector_ops<float>>,
+                optimize<Nesterov_rule, Vector_ops<float>>,
+                optimize<Rmsprop_rule, Vector_ops<float>>,
+                optimize<Adam_rule, Vector_ops<float>>,
+                { masked_optimize<Classic_rule, Vector_ops<float>>,
+                  masked_optimize<Sgd_rule, Vector_ops<float>>,
+                  masked_optimize<Nesterov_rule, Vector_ops<float>>,
+                  masked_optimize<Rmsprop_rule, Vector_ops<float>>,
+                  masked_optimize<Adam_rule, Vector_ops<float>> },
+                fast_sigmoid<Vector_ops<float>>,
+                fast_tanh<Vector_ops<float>>,
+                fast_softplus<Vector_ops<float>>,
+                fast_exp_sum<Vector_ops<float>> };
+            return table;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,460 @@
+/*
+ * Kernels_avx512.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include "Kernels.hpp"
+#include "functions/Fast_math.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// GCC 12 reports the undefined registers of its own intrinsics as uninitialized (bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+
+#include <cmath>
+
+#define TARGET __attribute__((target("avx512f")))
+
+namespace BackPropagation
+{
+    namespace kernels
+    {
+        namespace
+        {
+            // double
+
+            TARGET inline double horizontal_sum(__m512d v)
+            {
+                return _mm512_reduce_add_pd(v);
+            }
+
+            TARGET double dot(const double *x, const double *y, size_t count)
+            {
+                __m512d s0 = _mm512_setzero_pd();
+                __m512d s1 = _mm512_setzero_pd();
+                size_t i = 0;
+
+                // Two accumulators to hide the latency of the additions
+                for (; i + 2 * 8 <= count; i += 2 * 8)
+                {
+                    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+                    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i + 8), _mm512_loadu_pd(y + i + 8), s1);
+                }
+                for (; i + 8 <= count; i += 8)
+                {
+                    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i), s0);
+                }
+
+                double sum = horizontal_sum(_mm512_add_pd(s0, s1));
+
+                for (; i < count; ++i)
+                {
+                    sum += x[i] * y[i];
+                }
+
+                return sum;
+            }
+
+            TARGET void dot4(
+                const double *x0,
+                const double *x1,
+                const double *x2,
+                const double *x3,
+                const double *y,
+                size_t count,
+                double *sums)
+            {
+                __m512d s0 = _mm512_setzero_pd();
+                __m512d s1 = _mm512_setzero_pd();
+                __m512d s2 = _mm512_setzero_pd();
+                __m512d s3 = _mm512_setzero_pd();
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m512d vy = _mm512_loadu_pd(y + i);
+
+                    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x0 + i), vy, s0);
+                    s1 = _mm512_fmadd_pd(_mm512_loadu_pd(x1 + i), vy, s1);
+                    s2 = _mm512_fmadd_pd(_mm512_loadu_pd(x2 + i), vy, s2);
+                    s3 = _mm512_fmadd_pd(_mm512_loadu_pd(x3 + i), vy, s3);
+                }
+
+                sums[0] = horizontal_sum(s0);
+                sums[1] = horizontal_sum(s1);
+                sums[2] = horizontal_sum(s2);
+                sums[3] = horizontal_sum(s3);
+
+                for (; i < count; ++i)
+                {
+                    sums[0] += x0[i] * y[i];
+                    sums[1] += x1[i] * y[i];
+                    sums[2] += x2[i] * y[i];
+                    sums[3] += x3[i] * y[i];
+                }
+            }
+
+            TARGET void axpy(double alpha, const double *x, double *y, size_t count)
+            {
+                __m512d va = _mm512_set1_pd(alpha);
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    _mm512_storeu_pd(y + i, _mm512_fmadd_pd(va, _mm512_loadu_pd(x + i), _mm512_loadu_pd(y + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    y[i] += alpha * x[i];
+                }
+            }
+
+            TARGET double sparse_dot(const double *values, const uint32_t *columns, const double *x, size_t count)
+            {
+                __m512d s0 = _mm512_setzero_pd();
+                size_t i = 0;
+
+                // The inputs of eight weights gathered at once
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m256i indices = _mm256_loadu_si256((const __m256i*) (columns + i));
+
+                    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(values + i), _mm512_i32gather_pd(indices, x, 8), s0);
+                }
+
+                double sum = horizontal_sum(s0);
+
+                for (; i < count; ++i)
+                {
+                    sum += values[i] * x[columns[i]];
+                }
+
+                return sum;
+            }
+
+            TARGET void adjust(
+                double delta,
+                const double *inputs,
+                double *weights,
+                double *momentums,
+                double *errors,
+                size_t count)
+            {
+                __m512d vd = _mm512_set1_pd(delta);
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m512d previous = _mm512_loadu_pd(momentums + i);
+                    __m512d momentum = _mm512_mul_pd(_mm512_loadu_pd(inputs + i), vd);
+                    __m512d weight = _mm512_add_pd(_mm512_loadu_pd(weights + i), _mm512_add_pd(momentum, previous));
+
+                    _mm512_storeu_pd(momentums + i, momentum);
+                    _mm512_storeu_pd(weights + i, weight);
+                    _mm512_storeu_pd(errors + i, _mm512_fmadd_pd(weight, vd, _mm512_loadu_pd(errors + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    double momentum = momentums[i];
+                    momentums[i] = inputs[i] * delta;
+                    weights[i] += momentums[i] + momentum;
+                    errors[i] += weights[i] * delta;
+                }
+            }
+
+            TARGET void apply(
+                double scale,
+                const double *gradients,
+                double *weights,
+                double *momentums,
+                size_t count)
+            {
+                __m512d vs = _mm512_set1_pd(scale);
+                size_t i = 0;
+
+                for (; i + 8 <= count; i += 8)
+                {
+                    __m512d previous = _mm512_loadu_pd(momentums + i);
+                    __m512d momentum = _mm512_mul_pd(_mm512_loadu_pd(gradients + i), vs);
+
+                    _mm512_storeu_pd(momentums + i, momentum);
+                    _mm512_storeu_pd(weights + i, _mm512_add_pd(_mm512_loadu_pd(weights + i), _mm512_add_pd(momentum, previous)));
+                }
+                for (; i < count; ++i)
+                {
+                    double momentum = momentums[i];
+                    momentums[i] = gradients[i] * scale;
+                    weights[i] += momentums[i] + momentum;
+                }
+            }
+
+            // float
+
+            TARGET inline float horizontal_sum(__m512 v)
+            {
+                return _mm512_reduce_add_ps(v);
+            }
+
+            TARGET float dot(const float *x, const float *y, size_t count)
+            {
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                size_t i = 0;
+
+                // Two accumulators to hide the latency of the additions
+                for (; i + 2 * 16 <= count; i += 2 * 16)
+                {
+                    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+                    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i + 16), _mm512_loadu_ps(y + i + 16), s1);
+                }
+                for (; i + 16 <= count; i += 16)
+                {
+                    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i), s0);
+                }
+
+                float sum = horizontal_sum(_mm512_add_ps(s0, s1));
+
+                for (; i < count; ++i)
+                {
+                    sum += x[i] * y[i];
+                }
+
+                return sum;
+            }
+
+            TARGET void dot4(
+                const float *x0,
+                const float *x1,
+                const float *x2,
+                const float *x3,
+                const float *y,
+                size_t count,
+                float *sums)
+            {
+                __m512 s0 = _mm512_setzero_ps();
+                __m512 s1 = _mm512_setzero_ps();
+                __m512 s2 = _mm512_setzero_ps();
+                __m512 s3 = _mm512_setzero_ps();
+                size_t i = 0;
+
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m512 vy = _mm512_loadu_ps(y + i);
+
+                    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(x0 + i), vy, s0);
+                    s1 = _mm512_fmadd_ps(_mm512_loadu_ps(x1 + i), vy, s1);
+                    s2 = _mm512_fmadd_ps(_mm512_loadu_ps(x2 + i), vy, s2);
+                    s3 = _mm512_fmadd_ps(_mm512_loadu_ps(x3 + i), vy, s3);
+                }
+
+                sums[0] = horizontal_sum(s0);
+                sums[1] = horizontal_sum(s1);
+                sums[2] = horizontal_sum(s2);
+                sums[3] = horizontal_sum(s3);
+
+                for (; i < count; ++i)
+                {
+                    sums[0] += x0[i] * y[i];
+                    sums[1] += x1[i] * y[i];
+                    sums[2] += x2[i] * y[i];
+                    sums[3] += x3[i] * y[i];
+                }
+            }
+
+            TARGET void axpy(float alpha, const float *x, float *y, size_t count)
+            {
+                __m512 va = _mm512_set1_ps(alpha);
+                size_t i = 0;
+
+                for (; i + 16 <= count; i += 16)
+                {
+                    _mm512_storeu_ps(y + i, _mm512_fmadd_ps(va, _mm512_loadu_ps(x + i), _mm512_loadu_ps(y + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    y[i] += alpha * x[i];
+                }
+            }
+
+            TARGET float sparse_dot(const float *values, const uint32_t *columns, const float *x, size_t count)
+            {
+                __m512 s0 = _mm512_setzero_ps();
+                size_t i = 0;
+
+                // The inputs of sixteen weights gathered at once
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m512i indices = _mm512_loadu_si512((const void*) (columns + i));
+
+                    s0 = _mm512_fmadd_ps(_mm512_loadu_ps(values + i), _mm512_i32gather_ps(indices, x, 4), s0);
+                }
+
+                float sum = horizontal_sum(s0);
+
+                for (; i < count; ++i)
+                {
+                    sum += values[i] * x[columns[i]];
+                }
+
+                return sum;
+            }
+
+            TARGET void adjust(
+                float delta,
+                const float *inputs,
+                float *weights,
+                float *momentums,
+                float *errors,
+                size_t count)
+            {
+                __m512 vd = _mm512_set1_ps(delta);
+                size_t i = 0;
+
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m512 previous = _mm512_loadu_ps(momentums + i);
+                    __m512 momentum = _mm512_mul_ps(_mm512_loadu_ps(inputs + i), vd);
+                    __m512 weight = _mm512_add_ps(_mm512_loadu_ps(weights + i), _mm512_add_ps(momentum, previous));
+
+                    _mm512_storeu_ps(momentums + i, momentum);
+                    _mm512_storeu_ps(weights + i, weight);
+                    _mm512_storeu_ps(errors + i, _mm512_fmadd_ps(weight, vd, _mm512_loadu_ps(errors + i)));
+                }
+                for (; i < count; ++i)
+                {
+                    float momentum = momentums[i];
+                    momentums[i] = inputs[i] * delta;
+                    weights[i] += momentums[i] + momentum;
+                    errors[i] += weights[i] * delta;
+                }
+            }
+
+            TARGET void apply(
+                float scale,
+                const float *gradients,
+                float *weights,
+                float *momentums,
+                size_t count)
+            {
+                __m512 vs = _mm512_set1_ps(scale);
+                size_t i = 0;
+
+                for (; i + 16 <= count; i += 16)
+                {
+                    __m512 previous = _mm512_loadu_ps(momentums + i);
+                    __m512 momentum = _mm512_mul_ps(_mm512_loadu_ps(gradients + i), vs);
+
+                    _mm512_storeu_ps(momentums + i, momentum);
+                    _mm512_storeu_ps(weights + i, _mm512_add_ps(_mm512_loadu_ps(weights + i), _mm512_add_ps(momentum, previous)));
+                }
+                for (; i < count; ++i)
+                {
+                    float momentum = momentums[i];
+                    momentums[i] = gradients[i] * scale;
+                    weights[i] += momentums[i] + momentum;
+                }
+            }
+
+            // Optimizers
+
+            template <typename T>
+            struct Vector_ops;
+
+            template <>
+            struct Vector_ops<double>
+            {
+                    typedef double scalar;
+                    typedef __m512d type;
+                    static constexpr size_t WIDTH = 8;
+
+                    TARGET static inline type set1(double x) { return _mm512_set1_pd(x); }
+                    TARGET static inline type load(const double *p) { return _mm512_loadu_pd(p); }
+                    TARGET static inline type load_mask(const uint8_t *p) { return _mm512_cvtepi32_pd(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) p))); }
+                    TARGET static inline void store(double *p, type x) { _mm512_storeu_pd(p, x); }
+                    TARGET static inline type add(type a, type b) { return _mm512_add_pd(a, b); }
+                    TARGET static inline type sub(type a, type b) { return _mm512_sub_pd(a, b); }
+                    TARGET static inline type mul(type a, type b) { return _mm512_mul_pd(a, b); }
+                    TARGET static inline type div(type a, type b) { return _mm512_div_pd(a, b); }
+                    TARGET static inline type fmadd(type a, type b, type c) { return _mm512_fmadd_pd(a, b, c); }
+                    TARGET static inline type sqrt(type a) { return _mm512_sqrt_pd(a); }
+                    TARGET static inline type min(type a, type b) { return _mm512_min_pd(a, b); }
+                    TARGET static inline type max(type a, type b) { return _mm512_max_pd(a, b); }
+                    TARGET static inline type pow2(type biased) { return _mm512_castsi512_pd(_mm512_add_epi64(_mm512_slli_epi64(_mm512_castpd_si512(biased), 52), _mm512_set1_epi64(1023ll << 52))); }
+            };
+
+            template <>
+            struct Vector_ops<float>
+            {
+                    typedef float scalar;
+                    typedef __m512 type;
+                    static constexpr size_t WIDTH = 16;
+
+                    TARGET static inline type set1(float x) { return _mm512_set1_ps(x); }
+                    TARGET static inline type load(const float *p) { return _mm512_loadu_ps(p); }
+                    TARGET static inline type load_mask(const uint8_t *p) { return _mm512_cvtepi32_ps(_mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*) p))); }
+                    TARGET static inline void store(float *p, type x) { _mm512_storeu_ps(p, x); }
+                    TARGET static inline type add(type a, type b) { return _mm512_add_ps(a, b); }
+                    TARGET static inline type sub(type a, type b) { return _mm512_sub_ps(a, b); }
+                    TARGET static inline type mul(type a, type b) { return _mm512_mul_ps(a, b); }
+                    TARGET static inline type div(type a, type b) { return _mm512_div_ps(a, b); }
+                    TARGET static inline type fmadd(type a, type b, type c) { return _mm512_fmadd_ps(a, b, c); }
+                    TARGET static inline type sqrt(type a) { return _mm512_sqrt_ps(a); }
+                    TARGET static inline type min(type a, type b) { return _mm512_min_ps(a, b); }
+                    TARGET static inline type max(type a, type b) { return _mm512_max_ps(a, b); }
+                    TARGET static inline type pow2(type biased) { return _mm512_castsi512_ps(_mm512_add_epi32(_mm512_slli_epi32(_mm512_castps_si512(biased), 23), _mm512_set1_epi32(127 << 23))); }
+            };
+
+#include "Kernels_optimizers.inc"
+#include "Kernels_activations.inc"
+        }
+
+        template <>
+        const Table<double>& avx512_table<double>()
+        {
+            static const Table<double> table = {
+                Isa::AVX512, "avx512", dot, dot4, axpy, sparse_dot, adjust, apply,
+                optimize<Sgd_rule, Vector_ops<double>>,
+                optimize<Nesterov_rule, Vector_ops<double>>,
+                optimize<Rmsprop_rule, Vector_ops<double>>,
+                optimize<Adam_rule, Vector_ops<double>>,
+                { masked_optimize<Classic_rule, Vector_ops<double>>,
+                  masked_optimize<Sgd_rule, Vector_ops<double>>,
+                  masked_optimize<Nesterov_rule, Vector_ops<double>>,
+                  masked_optimize<Rmsprop_rule, Vector_ops<double>>,
+                  masked_optimize<Adam_rule, Vector_ops<double>> },
+                fast_sigmoid<Vector_ops<double>>,
+                fast_tanh<Vector_ops<double>>,
+                fast_softplus<Vector_ops<double>>,
+                fast_exp_sum<Vector_ops<double>> };
+            return table;
+        }
+
+        template <>
+        const Table<float>& avx512_table<float>()
+        {
+            static const Table<float> table = {
+                Isa::AVX512, "avx512", dot, dot4, axpy, sparse_dot, adjust, apply,
+                optimize<Sgd_rule, Vector_ops<float>>,
+                optimize<Nesterov_rule, Vector_ops<float>>,
+                optimize<Rmsprop_rule, Vector_ops<float>>,
+                optimize<Adam_rule, Vector_ops<float>>,
+                { masked_optimize<Classic_rule, Vector_ops<float>>,
+                  masked_optimize<Sgd_rule, Vector_ops<float>>,
+                  masked_optimize<Nesterov_rule, Vector_ops<float>>,
+                  masked_optimize<Rmsprop_rule, Vector_ops<float>>,
+                  masked_optimize<Adam_rule, Vector_ops<float>> },
+                fast_sigmoid<Vector_ops<float>>,
+                fast_tanh<Vector_ops<float>>,
+                fast_softplus<Vector_ops<float>>,
+                fast_exp_sum<Vector_ops<float>> };
+            return table;
+        }
+    }
+}
+
+#endif
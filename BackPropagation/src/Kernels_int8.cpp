@@ -0,0 +1,125 @@
+/*
+ * Kernels_int8.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include "Kernels.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+
+// GCC 12 reports the undefined registers of its own intrinsics as uninitialized (bug 105593)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#include <immintrin.h>
+#pragma GCC diagnostic pop
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+#define TARGET_VNNI __attribute__((target("avx512f,avx512bw,avx512vnni")))
+
+namespace BackPropagation
+{
+    namespace kernels
+    {
+        namespace
+        {
+            TARGET_AVX2 int32_t dot_avx2(const uint8_t *x, const int8_t *w, size_t count)
+            {
+                const __m256i ones = _mm256_set1_epi16(1);
+                __m256i sum = _mm256_setzero_si256();
+                size_t i = 0;
+
+                for (; i + 32 <= count; i += 32)
+                {
+                    // u8 * s8 pairs summed to s16, then pairs of s16 summed to s32
+                    __m256i products = _mm256_maddubs_epi16(
+                        _mm256_loadu_si256((const __m256i*) (x + i)),
+                        _mm256_loadu_si256((const __m256i*) (w + i)));
+
+                    sum = _mm256_add_epi32(sum, _mm256_madd_epi16(products, ones));
+                }
+
+                __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+                half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+                half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+
+                int32_t result = _mm_cvtsi128_si32(half);
+
+                for (; i < count; ++i)
+                {
+                    result += x[i] * w[i];
+                }
+
+                return result;
+            }
+
+            TARGET_AVX512 int32_t dot_avx512(const uint8_t *x, const int8_t *w, size_t count)
+            {
+                const __m512i ones = _mm512_set1_epi16(1);
+                __m512i sum = _mm512_setzero_si512();
+                size_t i = 0;
+
+                for (; i + 64 <= count; i += 64)
+                {
+                    __m512i products = _mm512_maddubs_epi16(_mm512_loadu_si512(x + i), _mm512_loadu_si512(w + i));
+
+                    sum = _mm512_add_epi32(sum, _mm512_madd_epi16(products, ones));
+                }
+
+                if (i < count)
+                {
+                    // Tail through masked loads, the missing bytes being 0
+                    const __mmask64 mask = ~0ULL >> (64 - (count - i));
+                    __m512i products = _mm512_maddubs_epi16(_mm512_maskz_loadu_epi8(mask, x + i), _mm512_maskz_loadu_epi8(mask, w + i));
+
+                    sum = _mm512_add_epi32(sum, _mm512_madd_epi16(products, ones));
+                }
+
+                return _mm512_reduce_add_epi32(sum);
+            }
+
+            TARGET_VNNI int32_t dot_vnni(const uint8_t *x, const int8_t *w, size_t count)
+            {
+                __m512i sum = _mm512_setzero_si512();
+                size_t i = 0;
+
+                // Groups of four u8 * s8 products accumulated straight into s32
+                for (; i + 64 <= count; i += 64)
+                {
+                    sum = _mm512_dpbusd_epi32(sum, _mm512_loadu_si512(x + i), _mm512_loadu_si512(w + i));
+                }
+
+                if (i < count)
+                {
+                    const __mmask64 mask = ~0ULL >> (64 - (count - i));
+
+                    sum = _mm512_dpbusd_epi32(sum, _mm512_maskz_loadu_epi8(mask, x + i), _mm512_maskz_loadu_epi8(mask, w + i));
+                }
+
+                return _mm512_reduce_add_epi32(sum);
+            }
+        }
+
+        const Int8_table& avx2_int8_table()
+        {
+            static const Int8_table table = { Isa::AVX2, "avx2", dot_avx2 };
+            return table;
+        }
+
+        const Int8_table& avx512_int8_table()
+        {
+            static const Int8_table table = { Isa::AVX512, "avx512bw", dot_avx512 };
+            return table;
+        }
+
+        const Int8_table& vnni_int8_table()
+        {
+            static const Int8_table table = { Isa::AVX512, "avx512vnni", dot_vnni };
+            return table;
+        }
+    }
+}
+
+#endif
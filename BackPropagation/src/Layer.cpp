@@ -1,116 +1,560 @@
-/*
- * Layer.cpp
- *
- * Author: Nicolae Natea
- */
-
-#include <assert.h>
-#include <math.h>
-
-#include <algorithm>
-#include <numeric>
-
-#include "Layer.hpp"
-
-namespace BackPropagation
-{
-    Layer::Layer(size_t nbrOfNeurons, size_t nbrOfInputs, functions::Activation_function_cPtr& activation)
-    {
-        m_output.resize(nbrOfNeurons);
-        m_errors.resize(nbrOfInputs);
-
-        // Populate the current layer with neurons.
-        for (size_t i = 0; i < nbrOfNeurons; ++i)
-        {
-            m_neurons.push_back(Neuron(nbrOfInputs, activation));
-        }
-    }
-
-    size_t Layer::size() const
-    {
-        return m_neurons.size();
-    }
-
-    void Layer::propagate(const std::vector<double> &inputs)
-    {
-        size_t index = 0;
-
-        for (auto &neuron : m_neurons)
-        {
-            // Note: push_back is quite expensive for this repetitive task
-            m_output[index++] = neuron.compute(inputs);
-        }
-    }
-
-    void Layer::set_output(const std::vector<double> &outputs)
-    {
-        m_output = outputs;
-    }
-
-    const std::vector<double>& Layer::output() const
-    {
-        return m_output;
-    }
-
-    const std::vector<double> Layer::compute_errors(const std::vector<double> &targets)
-    {
-        std::vector<double> errors;
-        errors.reserve(size());
-        size_t index = 0;
-
-        assert(targets.size() == m_output.size());
-
-        for (auto &target : targets)
-        {
-            errors.push_back(target - m_output[index++]);
-        }
-
-        return errors;
-    }
-
-    double Layer::get_mean_error(const std::vector<double> &expected)
-    {
-        double meanAverageError = 0.0;
-        size_t index = 0;
-
-        assert(expected.size() == m_output.size());
-
-        for (double value : expected)
-        {
-            meanAverageError += abs(value - m_output[index++]);
-        }
-
-        return ((double) meanAverageError / (double) size());
-    }
-
-    const std::vector<double>& Layer::back_propagate(
-        const std::vector<double> &inputs,
-        const std::vector<double> &ouputErrors)
-    {
-        size_t offset = 0;
-
-        // Reset the current value
-        std::fill(m_errors.begin(), m_errors.end(), 0);
-
-        // Adjust all the neurons in the current layer.
-        for (auto &neuron : m_neurons)
-        {
-            neuron.adjust(ouputErrors.at(offset++), inputs, m_errors);
-        }
-
-        // Return the error for the input layer
-        return m_errors;
-    }
-
-    std::ostream& operator<<(std::ostream &output, const Layer &layer)
-    {
-        size_t index = 0;
-
-        for (auto &neuron : layer.m_neurons)
-        {
-            output << "\t\t[" << ++index << "]: " << neuron << std::endl;
-        }
-
-        return output;
-    }
-}
+/*
+ * Layer.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <numeric>
+
+#include "Kernels.hpp"
+#include "Layer.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        template <typename T>
+        typename kernels::Table<T>::Optimizer_kernel optimizer_kernel(const kernels::Table<T> &kernel, Optimizer optimizer)
+        {
+            switch (optimizer)
+            {
+                case Optimizer::SGD:
+                    return kernel.sgd;
+                case Optimizer::NESTEROV:
+                    return kernel.nesterov;
+                case Optimizer::RMSPROP:
+                    return kernel.rmsprop;
+                case Optimizer::ADAM:
+                    return kernel.adam;
+                default:
+                    return nullptr;
+            }
+        }
+
+        template <typename T>
+        typename kernels::Table<T>::Masked_kernel masked_kernel(const kernels::Table<T> &kernel, Optimizer optimizer)
+        {
+            switch (optimizer)
+            {
+                case Optimizer::SGD:
+                    return kernel.masked.sgd;
+                case Optimizer::NESTEROV:
+                    return kernel.masked.nesterov;
+                case Optimizer::RMSPROP:
+                    return kernel.masked.rmsprop;
+                case Optimizer::ADAM:
+                    return kernel.masked.adam;
+                default:
+                    return kernel.masked.classic;
+            }
+        }
+    }
+
+    template <typename T>
+    Layer<T>::Layer(
+        size_t nbrOfNeurons,
+        size_t nbrOfInputs,
+        functions::Activation_function_cPtr<T>& activation,
+        std::mt19937 &rng) :
+            m_weights(nbrOfNeurons, nbrOfInputs),
+            m_momentums(nbrOfNeurons, nbrOfInputs),
+            m_optimizer(Optimizer::CLASSIC),
+            m_func(activation)
+    {
+        // Same sequence for all the scalar types
+        std::uniform_real_distribution<double> distrib(-0.5, 0.5);
+
+        // Initialize internal weights with a small random value
+        for (size_t i = 0; i < m_weights.size(); ++i)
+        {
+            m_weights.data()[i] = (T) distrib(rng);
+        }
+    }
+
+    template <typename T>
+    size_t Layer<T>::size() const
+    {
+        return m_weights.rows();
+    }
+
+    template <typename T>
+    size_t Layer<T>::inputs() const
+    {
+        return m_weights.cols();
+    }
+
+    template <typename T>
+    size_t Layer<T>::parameters() const
+    {
+        return m_weights.size();
+    }
+
+    template <typename T>
+    void Layer<T>::propagate(const T *inputs, T *outputs) const
+    {
+        const size_t nbrOfInputs = m_weights.cols();
+        const kernels::Table<T> &kernel = kernels::active<T>();
+
+        // output = f(W * inputs)
+        for (size_t row = 0; row < m_weights.rows(); ++row)
+        {
+            outputs[row] = kernel.dot(m_weights.row(row), inputs, nbrOfInputs);
+        }
+
+        m_func->compute_all(outputs, size());
+    }
+
+    template <typename T>
+    void Layer<T>::back_propagate(
+        const T *inputs,
+        const T *outputs,
+        const T *ouputErrors,
+        T *deltas,
+        T *inputErrors,
+        const Update<T> &update)
+    {
+        const size_t nbrOfInputs = m_weights.cols();
+        const kernels::Table<T> &kernel = kernels::active<T>();
+
+        assert(update.optimizer == m_optimizer);
+
+        // Local gradient of each neuron
+        m_func->derivative_all(outputs, ouputErrors, deltas, size());
+
+        if (m_mask.size())
+        {
+            // Pruned layer: the same fusion, the pruned weights staying 0 and out of the errors
+            auto optimize = masked_kernel(kernel, update.optimizer);
+
+            std::fill(inputErrors, inputErrors + nbrOfInputs, T());
+
+            for (size_t row = 0; row < m_weights.rows(); ++row)
+            {
+                optimize(
+                    update.step,
+                    deltas[row],
+                    inputs,
+                    m_mask.data() + row * nbrOfInputs,
+                    m_weights.row(row),
+                    m_momentums.row(row),
+                    m_squares.size() ? m_squares.row(row) : nullptr,
+                    inputErrors,
+                    nbrOfInputs);
+            }
+
+            return;
+        }
+
+        if (update.optimizer != Optimizer::CLASSIC)
+        {
+            // Same fusion, the gradients being inputs * delta
+            auto optimize = optimizer_kernel(kernel, update.optimizer);
+
+            std::fill(inputErrors, inputErrors + nbrOfInputs, T());
+
+            for (size_t row = 0; row < m_weights.rows(); ++row)
+            {
+                optimize(
+                    update.step,
+                    deltas[row],
+                    inputs,
+                    m_weights.row(row),
+                    m_momentums.row(row),
+                    m_squares.size() ? m_squares.row(row) : nullptr,
+                    inputErrors,
+                    nbrOfInputs);
+            }
+
+            return;
+        }
+
+        // Rank-1 update: momentum = deltas x inputs, weights += momentum + previous momentum,
+        // fused with the errors for the input layer: transpose(W) * deltas, using the adjusted weights
+        std::fill(inputErrors, inputErrors + nbrOfInputs, T());
+
+        for (size_t row = 0; row < m_weights.rows(); ++row)
+        {
+            kernel.adjust(
+                deltas[row],
+                inputs,
+                m_weights.row(row),
+                m_momentums.row(row),
+                inputErrors,
+                nbrOfInputs);
+        }
+    }
+
+    template <typename T>
+    void Layer<T>::propagate(const Sparse_inputs<T> &inputs, T *outputs) const
+    {
+        const uint32_t *indices = inputs.indices.data();
+        const size_t count = inputs.indices.size();
+
+        // output = f(W * inputs), over the columns of the non-zero inputs
+        for (size_t row = 0; row < m_weights.rows(); ++row)
+        {
+            const T *weights = m_weights.row(row);
+            T sum = T();
+
+            if (inputs.values.empty())
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    sum += weights[indices[i]];
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < count; ++i)
+                {
+                    sum += weights[indices[i]] * inputs.values[i];
+                }
+            }
+
+            outputs[row] = sum;
+        }
+
+        m_func->compute_all(outputs, size());
+    }
+
+    template <typename T>
+    void Layer<T>::back_propagate(
+        const Sparse_inputs<T> &inputs,
+        const uint32_t *pending,
+        size_t pendingCount,
+        const T *outputs,
+        const T *ouputErrors,
+        T *deltas,
+        std::vector<T> &scratch,
+        const Update<T> &update)
+    {
+        const uint32_t *indices = inputs.indices.data();
+        const size_t count = inputs.indices.size();
+        const bool binary = inputs.values.empty();
+
+        assert(update.optimizer == m_optimizer);
+        assert(binary || inputs.values.size() == count);
+
+        // Local gradient of each neuron
+        m_func->derivative_all(outputs, ouputErrors, deltas, size());
+
+        if (update.optimizer != Optimizer::CLASSIC)
+        {
+            // Gather the non-zero inputs with the weights and the state they use,
+            // update them with the dense kernel, and scatter them back.
+            auto optimize = optimizer_kernel(kernels::active<T>(), update.optimizer);
+            const bool squares = m_squares.size() != 0;
+
+            scratch.resize(4 * count);
+
+            T *values = scratch.data();
+            T *weights = values + count;
+            T *first = weights + count;
+            T *second = first + count;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                values[i] = binary ? T(1) : inputs.values[i];
+            }
+
+            for (size_t row = 0; row < m_weights.rows(); ++row)
+            {
+                T *rowWeights = m_weights.row(row);
+                T *rowFirst = m_momentums.row(row);
+                T *rowSecond = squares ? m_squares.row(row) : nullptr;
+                const uint8_t *mask = m_mask.size() ? m_mask.data() + row * m_weights.cols() : nullptr;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    weights[i] = rowWeights[indices[i]];
+                    first[i] = rowFirst[indices[i]];
+                    second[i] = squares ? rowSecond[indices[i]] : T();
+                }
+
+                optimize(update.step, deltas[row], values, weights, first, second, nullptr, count);
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    const T kept = mask ? T(mask[indices[i]]) : T(1);
+
+                    rowWeights[indices[i]] = weights[i] * kept;
+                    rowFirst[indices[i]] = first[i] * kept;
+
+                    if (squares)
+                    {
+                        rowSecond[indices[i]] = second[i] * kept;
+                    }
+                }
+            }
+
+            return;
+        }
+
+        // weights += momentum + previous momentum, the momentums of zero inputs becoming 0
+        for (size_t row = 0; row < m_weights.rows(); ++row)
+        {
+            T *weights = m_weights.row(row);
+            T *momentums = m_momentums.row(row);
+            const uint8_t *mask = m_mask.size() ? m_mask.data() + row * m_weights.cols() : nullptr;
+
+            if (pending)
+            {
+                for (size_t i = 0; i < pendingCount; ++i)
+                {
+                    weights[pending[i]] += momentums[pending[i]];
+                    momentums[pending[i]] = T();
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < m_weights.cols(); ++i)
+                {
+                    weights[i] += momentums[i];
+                    momentums[i] = T();
+                }
+            }
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                const T momentum = (binary ? T(1) : inputs.values[i]) * deltas[row] * (mask ? T(mask[indices[i]]) : T(1));
+
+                weights[indices[i]] += momentum;
+                momentums[indices[i]] = momentum;
+            }
+        }
+    }
+
+    template <typename T>
+    void Layer<T>::propagate(const Matrix<T> &inputs, Matrix<T> &outputs) const
+    {
+        // output = f(inputs * transpose(W))
+        multiply_abt(inputs, m_weights, outputs);
+
+        m_func->compute_rows(outputs.data(), outputs.rows(), outputs.cols());
+    }
+
+    template <typename T>
+    void Layer<T>::compute_gradients(
+        const Matrix<T> &inputs,
+        const Matrix<T> &outputs,
+        const Matrix<T> &ouputErrors,
+        Matrix<T> &deltas,
+        Matrix<T> &inputErrors,
+        Matrix<T> &gradients) const
+    {
+        const size_t batchSize = inputs.rows();
+
+        assert(inputs.cols() == m_weights.cols());
+        assert(outputs.rows() == batchSize && outputs.cols() == size());
+        assert(ouputErrors.rows() == batchSize && ouputErrors.cols() == size());
+
+        // Local gradients of each neuron, for each sample
+        deltas.resize(batchSize, size());
+
+        m_func->derivative_all(outputs.data(), ouputErrors.data(), deltas.data(), deltas.size());
+
+        // Errors for the input layer: deltas * W, using the weights the batch was propagated with
+        multiply_ab(deltas, m_weights, inputErrors);
+
+        // Gradients summed over the batch: transpose(deltas) * inputs
+        multiply_atb(deltas, inputs, gradients);
+    }
+
+    template <typename T>
+    void Layer<T>::apply_gradients(
+        const Matrix<T> &gradients,
+        T scale,
+        size_t first,
+        size_t last,
+        const Update<T> &update)
+    {
+        assert(gradients.size() == m_weights.size() && last <= m_weights.size());
+        assert(update.optimizer == m_optimizer);
+
+        if (first == last)
+        {
+            return;
+        }
+
+        if (m_mask.size())
+        {
+            masked_kernel(kernels::active<T>(), update.optimizer)(
+                update.step,
+                scale,
+                gradients.data() + first,
+                m_mask.data() + first,
+                m_weights.data() + first,
+                m_momentums.data() + first,
+                m_squares.size() ? m_squares.data() + first : nullptr,
+                nullptr,
+                last - first);
+        }
+        else if (update.optimizer == Optimizer::CLASSIC)
+        {
+            kernels::active<T>().apply(
+                scale,
+                gradients.data() + first,
+                m_weights.data() + first,
+                m_momentums.data() + first,
+                last - first);
+        }
+        else
+        {
+            optimizer_kernel(kernels::active<T>(), update.optimizer)(
+                update.step,
+                scale,
+                gradients.data() + first,
+                m_weights.data() + first,
+                m_momentums.data() + first,
+                m_squares.size() ? m_squares.data() + first : nullptr,
+                nullptr,
+                last - first);
+        }
+    }
+
+    template <typename T>
+    void Layer<T>::set_optimizer(Optimizer optimizer)
+    {
+        if (optimizer == m_optimizer)
+        {
+            return;
+        }
+
+        std::fill(m_momentums.data(), m_momentums.data() + m_momentums.size(), T());
+
+        if (Update<T>::uses_squares(optimizer))
+        {
+            m_squares = Matrix<T>(m_weights.rows(), m_weights.cols());
+        }
+        else
+        {
+            m_squares = Matrix<T>();
+        }
+
+        m_optimizer = optimizer;
+    }
+
+    template <typename T>
+    size_t Layer<T>::prune(T threshold)
+    {
+        if (m_mask.size() == 0)
+        {
+            m_mask.assign(m_weights.size(), 1);
+        }
+
+        for (size_t i = 0; i < m_weights.size(); ++i)
+        {
+            if (fabs(m_weights.data()[i]) < threshold)
+            {
+                m_mask[i] = 0;
+            }
+        }
+
+        apply_mask();
+
+        return pruned();
+    }
+
+    template <typename T>
+    size_t Layer<T>::pruned() const
+    {
+        return std::count(m_mask.begin(), m_mask.end(), 0);
+    }
+
+    template <typename T>
+    void Layer<T>::apply_mask()
+    {
+        for (size_t i = 0; i < m_mask.size(); ++i)
+        {
+            if (!m_mask[i])
+            {
+                m_weights.data()[i] = T();
+                m_momentums.data()[i] = T();
+
+                if (m_squares.size())
+                {
+                    m_squares.data()[i] = T();
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    size_t Layer<T>::snapshot_size() const
+    {
+        return m_weights.size() + m_momentums.size() + m_squares.size();
+    }
+
+    template <typename T>
+    T* Layer<T>::save(T *buffer) const
+    {
+        buffer = std::copy(m_weights.data(), m_weights.data() + m_weights.size(), buffer);
+        buffer = std::copy(m_momentums.data(), m_momentums.data() + m_momentums.size(), buffer);
+
+        return std::copy(m_squares.data(), m_squares.data() + m_squares.size(), buffer);
+    }
+
+    template <typename T>
+    const T* Layer<T>::restore(const T *buffer)
+    {
+        std::copy(buffer, buffer + m_weights.size(), m_weights.data());
+        buffer += m_weights.size();
+
+        std::copy(buffer, buffer + m_momentums.size(), m_momentums.data());
+        buffer += m_momentums.size();
+
+        std::copy(buffer, buffer + m_squares.size(), m_squares.data());
+        return buffer + m_squares.size();
+    }
+
+    template <typename T>
+    void Layer<T>::copy_parameters(const Layer &other)
+    {
+        assert(other.m_weights.size() == m_weights.size());
+        assert(other.m_squares.size() == m_squares.size());
+
+        std::copy(other.m_weights.data(), other.m_weights.data() + m_weights.size(), m_weights.data());
+        std::copy(other.m_momentums.data(), other.m_momentums.data() + m_momentums.size(), m_momentums.data());
+        std::copy(other.m_squares.data(), other.m_squares.data() + m_squares.size(), m_squares.data());
+    }
+
+    template <typename T>
+    const Matrix<T>& Layer<T>::weights() const
+    {
+        return m_weights;
+    }
+
+    template <typename T>
+    const functions::Activation_function_cPtr<T>& Layer<T>::function() const
+    {
+        return m_func;
+    }
+
+    template <typename T>
+    std::ostream& operator<<(std::ostream &output, const Layer<T> &layer)
+    {
+        for (size_t row = 0; row < layer.m_weights.rows(); ++row)
+        {
+            output << "\t\t[" << row + 1 << "]: ";
+
+            for (size_t col = 0; col < layer.m_weights.cols(); ++col)
+            {
+                output << layer.m_weights(row, col) << " ";
+            }
+
+            output << std::endl;
+        }
+
+        return output;
+    }
+
+    template class Layer<double>;
+    template class Layer<float>;
+
+    template std::ostream& operator<<(std::ostream &output, const Layer<double> &layer);
+    template std::ostream& operator<<(std::ostream &output, const Layer<float> &layer);
+}
@@ -0,0 +1,148 @@
+/*
+ * Matrix.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "Kernels.hpp"
+#include "Matrix.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        /** Number of bytes of the right hand operand kept hot while streaming the left one. */
+        constexpr size_t BLOCK_BYTES = 128 * 1024;
+
+        template <typename T>
+        size_t block_rows(size_t cols)
+        {
+            return std::max<size_t>(1, BLOCK_BYTES / (std::max<size_t>(1, cols) * sizeof(T)));
+        }
+    }
+
+    template <typename T>
+    void multiply_abt(const T *a, size_t m, size_t k, const T *b, size_t n, T *c)
+    {
+        const size_t block = block_rows<T>(k);
+        const kernels::Table<T> &kernel = kernels::active<T>();
+
+        // Keep a block of rows of B in cache while all the rows of A go through it.
+        for (size_t first = 0; first < n; first += block)
+        {
+            const size_t last = std::min(n, first + block);
+            size_t i = 0;
+
+            // Four rows of A at a time, to reuse each loaded element of B.
+            for (; i + 4 <= m; i += 4)
+            {
+                const T *a0 = a + i * k;
+                const T *a1 = a0 + k;
+                const T *a2 = a1 + k;
+                const T *a3 = a2 + k;
+                T *ci = c + i * n;
+
+                for (size_t j = first; j < last; ++j)
+                {
+                    T sums[4];
+
+                    kernel.dot4(a0, a1, a2, a3, b + j * k, k, sums);
+
+                    ci[j] = sums[0];
+                    ci[n + j] = sums[1];
+                    ci[2 * n + j] = sums[2];
+                    ci[3 * n + j] = sums[3];
+                }
+            }
+
+            for (; i < m; ++i)
+            {
+                const T *ai = a + i * k;
+                T *ci = c + i * n;
+
+                for (size_t j = first; j < last; ++j)
+                {
+                    ci[j] = kernel.dot(ai, b + j * k, k);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void multiply_abt(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c)
+    {
+        assert(b.cols() == a.cols());
+        c.resize(a.rows(), b.rows());
+
+        multiply_abt(a.data(), a.rows(), a.cols(), b.data(), b.rows(), c.data());
+    }
+
+    template <typename T>
+    void multiply_ab(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c)
+    {
+        const size_t m = a.rows();
+        const size_t k = a.cols();
+        const size_t n = b.cols();
+        const size_t block = block_rows<T>(n);
+        const kernels::Table<T> &kernel = kernels::active<T>();
+
+        assert(b.rows() == k);
+        c.resize(m, n);
+        std::fill(c.data(), c.data() + c.size(), T());
+
+        // Row i of C is a linear combination of the rows of B.
+        for (size_t first = 0; first < k; first += block)
+        {
+            const size_t last = std::min(k, first + block);
+
+            for (size_t i = 0; i < m; ++i)
+            {
+                const T *ai = a.row(i);
+                T *ci = c.row(i);
+
+                for (size_t p = first; p < last; ++p)
+                {
+                    kernel.axpy(ai[p], b.row(p), ci, n);
+                }
+            }
+        }
+    }
+
+    template <typename T>
+    void multiply_atb(const Matrix<T> &a, const Matrix<T> &b, Matrix<T> &c)
+    {
+        const size_t k = a.rows();
+        const size_t m = a.cols();
+        const size_t n = b.cols();
+        const kernels::Table<T> &kernel = kernels::active<T>();
+
+        assert(b.rows() == k);
+        c.resize(m, n);
+        std::fill(c.data(), c.data() + c.size(), T());
+
+        // Sum of the outer products of the rows of A and B, one row of C
+        // at a time so that it stays in cache while B is streamed.
+        for (size_t i = 0; i < m; ++i)
+        {
+            T *ci = c.row(i);
+
+            for (size_t p = 0; p < k; ++p)
+            {
+                kernel.axpy(a(p, i), b.row(p), ci, n);
+            }
+        }
+    }
+
+    template void multiply_abt(const double *a, size_t m, size_t k, const double *b, size_t n, double *c);
+    template void multiply_abt(const float *a, size_t m, size_t k, const float *b, size_t n, float *c);
+    template void multiply_abt(const Matrix<double> &a, const Matrix<double> &b, Matrix<double> &c);
+    template void multiply_ab(const Matrix<double> &a, const Matrix<double> &b, Matrix<double> &c);
+    template void multiply_atb(const Matrix<double> &a, const Matrix<double> &b, Matrix<double> &c);
+    template void multiply_abt(const Matrix<float> &a, const Matrix<float> &b, Matrix<float> &c);
+    template void multiply_ab(const Matrix<float> &a, const Matrix<float> &b, Matrix<float> &c);
+    template void multiply_atb(const Matrix<float> &a, const Matrix<float> &b, Matrix<float> &c);
+}
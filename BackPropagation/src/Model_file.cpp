@@ -0,0 +1,480 @@
+/*
+ * Model_file.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include "Aligned_allocator.hpp"
+#include "Kernels.hpp"
+#include "Matrix.hpp"
+#include "Model_file.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        uint64_t align(uint64_t offset)
+        {
+            return (offset + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+
+        /** Class Sparse_rows: a layer in compressed sparse row format */
+        template <typename T>
+        struct Sparse_rows
+        {
+                std::vector<T> weights;             ///< Non-zero weights, row by row
+                std::vector<uint32_t> row_starts;   ///< First weight of each row, and the end
+                std::vector<uint32_t> columns;      ///< Input index of each weight
+        };
+
+        /**
+         * @return true if the rows were compressed, false if the layer is to
+         * be stored dense: not enough zero weights, as in Sparse_network.
+         */
+        template <typename T>
+        bool compress(const Matrix<T> &weights, double minSparsity, Sparse_rows<T> &sparse)
+        {
+            const size_t zeros = std::count(weights.data(), weights.data() + weights.size(), T());
+
+            if (weights.size() == 0 || weights.size() > UINT32_MAX || zeros < minSparsity * weights.size())
+            {
+                return false;
+            }
+
+            sparse.row_starts.push_back(0);
+
+            for (size_t row = 0; row < weights.rows(); ++row)
+            {
+                for (size_t col = 0; col < weights.cols(); ++col)
+                {
+                    if (weights(row, col) != T())
+                    {
+                        sparse.columns.push_back((uint32_t) col);
+                        sparse.weights.push_back(weights(row, col));
+                    }
+                }
+
+                sparse.row_starts.push_back((uint32_t) sparse.weights.size());
+            }
+
+            return true;
+        }
+
+        /**
+         * @return true if the compressed rows of a record, inside the mapping
+         * starting at base, are consistent: the rows in order, within the
+         * layer, and the columns within the inputs.
+         */
+        bool valid_rows(const model::Layer_record &record, const char *base)
+        {
+            const uint32_t *rowStarts = reinterpret_cast<const uint32_t*>(base + record.row_starts);
+            const uint32_t *columns = reinterpret_cast<const uint32_t*>(base + record.columns);
+
+            if (rowStarts[0] != 0 || rowStarts[record.neurons] != record.nonzeros)
+            {
+                return false;
+            }
+
+            for (size_t row = 0; row < record.neurons; ++row)
+            {
+                if (rowStarts[row] > rowStarts[row + 1] || rowStarts[row + 1] - rowStarts[row] > record.inputs)
+                {
+                    return false;
+                }
+            }
+
+            for (size_t i = 0; i < record.nonzeros; ++i)
+            {
+                if (columns[i] >= record.inputs)
+                {
+                    return false;
+                }
+            }
+
+            return true;
+        }
+
+        /**
+         * @return true if the array of count values of the given size at offset
+         * is aligned and inside a mapping of length bytes, without overflowing.
+         */
+        bool inside(uint64_t offset, uint64_t count, size_t size, uint64_t length)
+        {
+            uint64_t bytes;
+
+            return !__builtin_mul_overflow(count, size, &bytes) &&
+                   offset % ALIGNMENT == 0 &&
+                   offset <= length &&
+                   bytes <= length - offset;
+        }
+    }
+
+    template <typename T>
+    void save_model(const Network<T> &network, const std::string &path, double minSparsity)
+    {
+        const std::vector<Layer<T>> &layers = network.layers();
+
+        model::Header header = {};
+        std::vector<model::Layer_record> records(layers.size());
+        std::vector<Sparse_rows<T>> sparse(layers.size());
+
+        memcpy(header.magic, model::MAGIC, sizeof(header.magic));
+        header.version = model::VERSION;
+        header.byte_order = model::BYTE_ORDER_MARK;
+        header.scalar_size = sizeof(T);
+        header.layers = layers.size();
+
+        uint64_t offset = sizeof(header) + records.size() * sizeof(model::Layer_record);
+
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            const char *name = layers[i].function()->name();
+
+            if (!*name || strlen(name) >= model::NAME_LENGTH)
+            {
+                throw std::invalid_argument("Activation function can not be saved");
+            }
+
+            records[i] = {};
+            records[i].neurons = layers[i].size();
+            records[i].inputs = layers[i].inputs();
+            strcpy(records[i].activation, name);
+
+            if (!compress(layers[i].weights(), minSparsity, sparse[i]))
+            {
+                offset = align(offset);
+                records[i].weights = offset;
+                offset += layers[i].parameters() * sizeof(T);
+                continue;
+            }
+
+            records[i].nonzeros = sparse[i].weights.size();
+
+            offset = align(offset);
+            records[i].weights = offset;
+            offset += sparse[i].weights.size() * sizeof(T);
+
+            offset = align(offset);
+            records[i].row_starts = offset;
+            offset += sparse[i].row_starts.size() * sizeof(uint32_t);
+
+            offset = align(offset);
+            records[i].columns = offset;
+            offset += sparse[i].columns.size() * sizeof(uint32_t);
+        }
+
+        header.file_size = offset;
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+        if (!file)
+        {
+            throw std::runtime_error("Can not create model file " + path);
+        }
+
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(model::Layer_record));
+
+        // Padding up to the aligned offset, then the array
+        auto write_at = [&file](uint64_t offset, const void *data, size_t bytes) {
+            static const char zeros[ALIGNMENT] = {};
+
+            file.write(zeros, offset - (uint64_t) file.tellp());
+            file.write(static_cast<const char*>(data), bytes);
+        };
+
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            const Matrix<T> &weights = layers[i].weights();
+
+            if (!records[i].row_starts)
+            {
+                write_at(records[i].weights, weights.data(), weights.size() * sizeof(T));
+                continue;
+            }
+
+            write_at(records[i].weights, sparse[i].weights.data(), sparse[i].weights.size() * sizeof(T));
+            write_at(records[i].row_starts, sparse[i].row_starts.data(), sparse[i].row_starts.size() * sizeof(uint32_t));
+            write_at(records[i].columns, sparse[i].columns.data(), sparse[i].columns.size() * sizeof(uint32_t));
+        }
+
+        if (!file.flush())
+        {
+            throw std::runtime_error("Can not write model file " + path);
+        }
+    }
+
+    template <typename T>
+    Mapped_network<T>::Mapped_network(const std::string &path) :
+        m_address(MAP_FAILED),
+        m_length(0)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+
+        if (fd < 0)
+        {
+            throw std::runtime_error("Can not open model file " + path);
+        }
+
+        if (fstat(fd, &info) == 0 && info.st_size >= (off_t) sizeof(model::Header))
+        {
+            m_length = info.st_size;
+            m_address = mmap(nullptr, m_length, PROT_READ, MAP_SHARED, fd, 0);
+        }
+
+        // The mapping keeps the file referenced.
+        close(fd);
+
+        if (m_address == MAP_FAILED)
+        {
+            throw std::runtime_error("Can not map model file " + path);
+        }
+
+        try
+        {
+            const char *base = static_cast<const char*>(m_address);
+            const model::Header &header = *reinterpret_cast<const model::Header*>(base);
+            const uint64_t recordsEnd = sizeof(header) + (uint64_t) header.layers * sizeof(model::Layer_record);
+
+            if (memcmp(header.magic, model::MAGIC, sizeof(header.magic)) != 0 ||
+                header.version != model::VERSION ||
+                header.byte_order != model::BYTE_ORDER_MARK ||
+                header.file_size != m_length ||
+                header.layers < 2 ||
+                recordsEnd > m_length)
+            {
+                throw std::runtime_error("Invalid model file " + path);
+            }
+
+            if (header.scalar_size != sizeof(T))
+            {
+                throw std::runtime_error("Model file " + path + " holds another scalar type");
+            }
+
+            const model::Layer_record *records = reinterpret_cast<const model::Layer_record*>(base + sizeof(header));
+
+            for (size_t i = 0; i < header.layers; ++i)
+            {
+                const model::Layer_record &record = records[i];
+                const bool sparse = record.row_starts != 0;
+                const uint64_t parameters = (uint64_t) record.neurons * record.inputs;
+
+                // Sizes and offsets come from the file: compared without overflowing
+                if (!inside(record.weights, sparse ? record.nonzeros : parameters, sizeof(T), m_length) ||
+                    record.inputs != (i > 0 ? records[i - 1].neurons : 0) ||
+                    record.neurons == 0 ||
+                    !memchr(record.activation, 0, sizeof(record.activation)))
+                {
+                    throw std::runtime_error("Invalid model file " + path);
+                }
+
+                if (sparse &&
+                    (record.nonzeros > parameters ||
+                     !inside(record.row_starts, (uint64_t) record.neurons + 1, sizeof(uint32_t), m_length) ||
+                     !inside(record.columns, record.nonzeros, sizeof(uint32_t), m_length) ||
+                     !valid_rows(record, base)))
+                {
+                    throw std::runtime_error("Invalid model file " + path);
+                }
+
+                auto func = functions::create<T>(record.activation);
+
+                if (!func)
+                {
+                    throw std::invalid_argument("Unknown activation function " + std::string(record.activation));
+                }
+
+                m_layers.push_back({
+                    record.neurons,
+                    record.inputs,
+                    reinterpret_cast<const T*>(base + record.weights),
+                    sparse ? reinterpret_cast<const uint32_t*>(base + record.row_starts) : nullptr,
+                    sparse ? reinterpret_cast<const uint32_t*>(base + record.columns) : nullptr,
+                    func });
+            }
+        }
+        catch (...)
+        {
+            munmap(m_address, m_length);
+            throw;
+        }
+    }
+
+    template <typename T>
+    Mapped_network<T>::~Mapped_network()
+    {
+        munmap(m_address, m_length);
+    }
+
+    template <typename T>
+    void Mapped_network<T>::propagate(const Mapped_layer &layer, const T *inputs, T *sums)
+    {
+        const kernels::Table<T> &kernel = kernels::active<T>();
+
+        if (!layer.row_starts)
+        {
+            for (size_t row = 0; row < layer.neurons; ++row)
+            {
+                sums[row] = kernel.dot(layer.weights + row * layer.inputs, inputs, layer.inputs);
+            }
+
+            return;
+        }
+
+        for (size_t row = 0; row < layer.neurons; ++row)
+        {
+            const uint32_t first = layer.row_starts[row];
+
+            sums[row] = kernel.sparse_dot(layer.weights + first, layer.columns + first, inputs, layer.row_starts[row + 1] - first);
+        }
+    }
+
+    template <typename T>
+    void Mapped_network<T>::test(Workspace<T> &workspace, const T *inputs, size_t count, T *outputs) const
+    {
+        assert(workspace.layers.size() == m_layers.size());
+
+        if (count == 1)
+        {
+            // Matrix-vector products, no batch buffers involved
+            const T *layerInputs = inputs;
+
+            for (size_t i = 1; i < m_layers.size(); ++i)
+            {
+                const Mapped_layer &layer = m_layers[i];
+                T *layerOutputs = workspace.layers[i].output.data();
+
+                propagate(layer, layerInputs, layerOutputs);
+                layer.func->compute_all(layerOutputs, layer.neurons);
+                layerInputs = layerOutputs;
+            }
+
+            std::copy(layerInputs, layerInputs + m_layers.back().neurons, outputs);
+            return;
+        }
+
+        const T *layerInputs = inputs;
+
+        for (size_t i = 1; i < m_layers.size(); ++i)
+        {
+            const Mapped_layer &layer = m_layers[i];
+            Matrix<T> &layerOutputs = workspace.layers[i].batch_output;
+
+            layerOutputs.resize(count, layer.neurons);
+
+            if (layer.row_starts)
+            {
+                for (size_t sample = 0; sample < count; ++sample)
+                {
+                    propagate(layer, layerInputs + sample * layer.inputs, layerOutputs.row(sample));
+                }
+            }
+            else
+            {
+                // output = f(inputs * transpose(W))
+                multiply_abt(layerInputs, count, layer.inputs, layer.weights, layer.neurons, layerOutputs.data());
+            }
+
+            layer.func->compute_rows(layerOutputs.data(), count, layer.neurons);
+
+            layerInputs = layerOutputs.data();
+        }
+
+        std::copy(layerInputs, layerInputs + count * m_layers.back().neurons, outputs);
+    }
+
+    template <typename T>
+    Workspace<T> Mapped_network<T>::create_workspace(size_t batchSize) const
+    {
+        std::vector<size_t> sizes;
+
+        for (const auto &layer : m_layers)
+        {
+            sizes.push_back(layer.neurons);
+        }
+
+        return Workspace<T>(sizes, batchSize > 1 ? batchSize : 0);
+    }
+
+    template <typename T>
+    size_t Mapped_network<T>::inputs() const
+    {
+        return m_layers[0].neurons;
+    }
+
+    template <typename T>
+    size_t Mapped_network<T>::outputs() const
+    {
+        return m_layers.back().neurons;
+    }
+
+    template <typename T>
+    size_t Mapped_network<T>::layers() const
+    {
+        return m_layers.size();
+    }
+
+    template <typename T>
+    size_t Mapped_network<T>::size(size_t layer) const
+    {
+        return m_layers[layer].neurons;
+    }
+
+    template <typename T>
+    bool Mapped_network<T>::sparse(size_t layer) const
+    {
+        return m_layers[layer].row_starts != nullptr;
+    }
+
+    template <typename T>
+    const T* Mapped_network<T>::weights(size_t layer) const
+    {
+        return m_layers[layer].weights;
+    }
+
+    template <typename T>
+    void Mapped_network<T>::copy_weights(size_t layer, T *weights) const
+    {
+        const Mapped_layer &source = m_layers[layer];
+
+        if (!source.row_starts)
+        {
+            std::copy(source.weights, source.weights + source.neurons * source.inputs, weights);
+            return;
+        }
+
+        std::fill(weights, weights + source.neurons * source.inputs, T());
+
+        for (size_t row = 0; row < source.neurons; ++row)
+        {
+            for (uint32_t i = source.row_starts[row]; i < source.row_starts[row + 1]; ++i)
+            {
+                weights[row * source.inputs + source.columns[i]] = source.weights[i];
+            }
+        }
+    }
+
+    template <typename T>
+    functions::Activation_function_cPtr<T> Mapped_network<T>::function(size_t layer) const
+    {
+        return m_layers[layer].func;
+    }
+
+    template void save_model(const Network<double> &network, const std::string &path, double minSparsity);
+    template void save_model(const Network<float> &network, const std::string &path, double minSparsity);
+
+    template class Mapped_network<double>;
+    template class Mapped_network<float>;
+}
@@ -1,229 +1,1488 @@
-/*
- * Network.cpp
- *
- * Author: Nicolae Natea
- */
-
-#include <assert.h>
-#include <math.h>
-
-#include <algorithm>
-#include <numeric>
-#include <random>
-
-#include "Network.hpp"
-
-namespace BackPropagation
-{
-    namespace
-    {
-        auto rng = std::default_random_engine { };
-    }
-
-    Network::Settings::Settings(
-        uint32_t maxIterations,
-        double targetError,
-        double storeThreshold,
-        double restoreThreshold) :
-            max_iterations(maxIterations),
-            target_error(targetError),
-            store_threshold(storeThreshold),
-            restore_threshold(restoreThreshold)
-    {
-        // Probably a throw would be more appropriate
-        assert(store_threshold >= 0.0 && store_threshold <= 1.0);
-        assert(restore_threshold >= 1.0);
-    }
-
-    Network::Network(
-        std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr>> layers)
-    {
-        uint32_t incomingInputs = 0;
-
-        // Populate the current network with layers.
-        for (auto layer : layers)
-        {
-            m_layers.push_back(Layer(layer.first, incomingInputs, layer.second));
-            incomingInputs = layer.first;
-        }
-
-        // Save the current network state.
-        save();
-    }
-
-    Network::Network(std::vector<std::uint32_t> layers, functions::Activation_function_cPtr func)
-    {
-        uint32_t incomingInputs = 0;
-
-        // Populate the current network with layers.
-        for (auto nbrOfNeurons : layers)
-        {
-            m_layers.push_back(Layer(nbrOfNeurons, incomingInputs, func));
-            incomingInputs = nbrOfNeurons;
-        }
-
-        // Save the current network state.
-        save();
-    }
-
-    Network::~Network()
-    {
-    }
-
-    double Network::iterate(
-        const std::vector<Training_data> &trainingData,
-        const std::vector<uint32_t> &order,
-        const Settings &settings)
-    {
-        auto &outputLayer = m_layers[m_layers.size() - 1];
-
-        for (int index : order)
-        {
-            const Training_data &data = trainingData[index];
-
-            // Forward propagation.
-            propagate(data.inputs);
-
-            // Compute the output error for the current data set.
-            std::vector<double> errors = outputLayer.compute_errors(data.outputs);
-
-            // Back-propagate the error starting from the output layer to the input layer.
-            // The first layer shall not perform any adjustments.
-            for (int index = m_layers.size() - 1; index > 0; index--)
-            {
-                auto &currLayer = m_layers[index];
-                auto &prevLayer = m_layers[index - 1];
-
-                errors = currLayer.back_propagate(prevLayer.output(), errors);
-            }
-        }
-
-        double averageError = 0.0;
-
-        // Compute average error for all data sets.
-        for (const Training_data &data : trainingData)
-        {
-            propagate(data.inputs);
-            averageError += outputLayer.get_mean_error(data.outputs);
-        }
-
-        averageError /= trainingData.size();
-
-        return averageError;
-    }
-
-    void Network::propagate(const std::vector<double> &inputs)
-    {
-        auto &inputLayer = m_layers[0];
-        auto &outputLayer = m_layers[m_layers.size() - 1];
-
-        // Set the output of the first/input layer.
-        inputLayer.set_output(inputs);
-
-        // Forward propagation
-        for (uint32_t i = 1; i < m_layers.size(); i++)
-        {
-            auto &prevLayer = m_layers[i - 1];
-            auto &currLayer = m_layers[i];
-
-            currLayer.propagate(prevLayer.output());
-        }
-    }
-
-    std::vector<double> Network::test(const std::vector<double> &inputs)
-    {
-        auto &outLayer = m_layers[m_layers.size() - 1];
-        propagate(inputs);
-
-        return outLayer.output();
-    }
-
-    double Network::train(const std::vector<Training_data> &data, const Settings &settings)
-    {
-        std::vector<uint32_t> order(data.size());
-        std::iota(std::begin(order), std::end(order), 0);
-
-        size_t inputLayerSize = m_layers[0].size();
-        size_t outputLayerSize = m_layers[m_layers.size() - 1].size();
-
-        for(auto &trainingData : data) {
-            assert(trainingData.inputs.size() == inputLayerSize);
-            assert(trainingData.outputs.size() == outputLayerSize);
-        }
-
-        // Perform an iteration to get a reference error.
-        double error = iterate(data, order, settings);
-
-        // Save network state for which we have the error computed.
-        save();
-
-        double previousError = error;
-        double storeThreshold = error * settings.store_threshold;
-        double restoreThreshold = error * settings.restore_threshold;
-        uint32_t interation = 0;
-
-        while (++interation < settings.max_iterations)
-        {
-            std::shuffle(std::begin(order), std::end(order), rng);
-            error = iterate(data, order, settings);
-
-            if (error <= settings.target_error)
-            {
-                break;
-            }
-            if (error < storeThreshold)
-            {
-                // Save the network only when the specified improvement is reached
-                previousError = error;
-                storeThreshold = error * settings.store_threshold;
-                restoreThreshold = error * settings.restore_threshold;
-                save();
-            }
-            else if (error > restoreThreshold)
-            {
-                // Pretty unlikely with the right data in the current form
-                restore();
-            }
-        }
-
-        if (error < previousError)
-        {
-            save();
-        }
-        else if (error > previousError) {
-            error = previousError;
-            restore();
-        }
-
-        return error;
-    }
-
-    void Network::save()
-    {
-        m_layers_restore_point.assign(m_layers.begin(), m_layers.end());
-    }
-
-    void Network::restore()
-    {
-        m_layers.assign(m_layers_restore_point.begin(), m_layers_restore_point.end());
-    }
-
-    std::ostream& operator<<(std::ostream &output, const Network &net)
-    {
-        size_t index = 0;
-
-        output << "Network: ";
-
-        for (auto layer : net.m_layers)
-        {
-            output << layer.size() << " ";
-        }
-
-        for (auto layer : net.m_layers)
-        {
-            output << "\n\t[Layer " << ++index << "]" << std::endl << layer;
-        }
-
-        return output;
-    }
-}
+/*
+ * Network.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#include "Network.hpp"
+#include "Thread_pool.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        /** Accumulates the time elapsed between laps, when enabled */
+        class Stopwatch
+        {
+            private:
+                bool m_enabled;             ///< Nothing is measured otherwise
+                Clock::time_point m_last;   ///< Start of the current lap
+
+                // Construction
+            public:
+                explicit Stopwatch(bool enabled) :
+                    m_enabled(enabled)
+                {
+                    if (m_enabled)
+                    {
+                        m_last = Clock::now();
+                    }
+                }
+
+                // Methods
+            public:
+                /** Add the seconds elapsed since the previous lap to total, and start a new lap */
+                void lap(double &total)
+                {
+                    if (m_enabled)
+                    {
+                        Clock::time_point now = Clock::now();
+
+                        total += std::chrono::duration<double>(now - m_last).count();
+                        m_last = now;
+                    }
+                }
+        };
+
+        /** errors = targets - outputs */
+        template <typename T>
+        void compute_errors(const T *targets, const T *outputs, T *errors, size_t count)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                errors[i] = targets[i] - outputs[i];
+            }
+        }
+
+        /** Check that all the samples fit the network */
+        template <typename T>
+        void check_sizes(const std::vector<Training_data<T>> &data, size_t inputs, size_t outputs)
+        {
+            for (auto &sample : data)
+            {
+                assert(sample.inputs.size() == inputs ||
+                    (sample.inputs.empty() &&
+                        (sample.sparse_inputs.indices.empty() || sample.sparse_inputs.indices.back() < inputs)));
+                assert(sample.outputs.size() == outputs);
+            }
+
+            (void) inputs;
+            (void) outputs;
+        }
+
+        /**
+         * Check that a view of samples has the widths of the network, its
+         * samples being read without bounds checks.
+         */
+        template <typename T>
+        void check_widths(const Samples<T> &data, size_t inputs, size_t outputs)
+        {
+            if (data.size() && ((data.inputs() != inputs && !data.sparse_inputs(0)) || data.outputs() != outputs))
+            {
+                throw std::invalid_argument("Samples do not match the inputs and outputs of the network");
+            }
+        }
+
+        /**
+         * @param[in,out] magnitudes of the weights, reordered.
+         * @param[in]     sparsity   fraction of the weights to prune.
+         *
+         * @return the magnitude below which weights are pruned to reach the
+         * sparsity, 0 if none has to be.
+         */
+        template <typename T>
+        T pruning_threshold(std::vector<T> &magnitudes, double sparsity)
+        {
+            const size_t count = (size_t) llround(std::min(std::max(sparsity, 0.0), 1.0) * magnitudes.size());
+
+            if (count == 0)
+            {
+                return T();
+            }
+
+            if (count == magnitudes.size())
+            {
+                return std::numeric_limits<T>::infinity();
+            }
+
+            std::nth_element(magnitudes.begin(), magnitudes.begin() + count, magnitudes.end());
+            return magnitudes[count];
+        }
+
+        /** @return sum(|errors|) / width */
+        template <typename T>
+        double get_mean_error(const T *errors, size_t count, size_t width)
+        {
+            double meanAverageError = 0.0;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                meanAverageError += fabs(errors[i]);
+            }
+
+            return (meanAverageError / (double) width);
+        }
+
+        /** @return sum(|expected - outputs|) / width */
+        template <typename T>
+        double get_mean_error(const T *expected, const T *outputs, size_t count, size_t width)
+        {
+            double meanAverageError = 0.0;
+
+            for (size_t i = 0; i < count; ++i)
+            {
+                meanAverageError += fabs(expected[i] - outputs[i]);
+            }
+
+            return (meanAverageError / (double) width);
+        }
+    }
+
+    template <typename T>
+    Network<T>::Settings::Settings(
+        uint32_t maxIterations,
+        double targetError,
+        double storeThreshold,
+        double restoreThreshold,
+        uint32_t batchSize) :
+            max_iterations(maxIterations),
+            target_error(targetError),
+            store_threshold(storeThreshold),
+            restore_threshold(restoreThreshold),
+            batch_size(batchSize),
+            threads(1),
+            parallel_mode(Parallel_mode::SYNCHRONOUS),
+            evaluation(Evaluation::FULL),
+            evaluation_samples(1000),
+            evaluation_period(10),
+            chunk_size(0),
+            timing(true),
+            patience(10),
+            huge_pages(false),
+            optimizer(Optimizer::CLASSIC),
+            learning_rate(0.01),
+            learning_rate_decay(1.0),
+            momentum(0.9),
+            squares_decay(0.999),
+            epsilon(1e-8)
+    {
+        // Probably a throw would be more appropriate
+        assert(store_threshold >= 0.0 && store_threshold <= 1.0);
+        assert(restore_threshold >= 1.0);
+        assert(batch_size >= 1);
+    }
+
+    template <typename T>
+    Network<T>::Network(
+        std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<T>>> layers,
+        std::mt19937::result_type seed) :
+            m_rng(seed)
+    {
+        uint32_t incomingInputs = 0;
+
+        // Populate the current network with layers.
+        for (auto layer : layers)
+        {
+            m_layers.push_back(Layer<T>(layer.first, incomingInputs, layer.second, m_rng));
+            incomingInputs = layer.first;
+        }
+
+        m_workspaces.emplace_back(m_layers);
+
+        // Save the current network state.
+        save();
+    }
+
+    template <typename T>
+    Network<T>::Network(
+        std::vector<std::uint32_t> layers,
+        functions::Activation_function_cPtr<T> func,
+        std::mt19937::result_type seed) :
+            m_rng(seed)
+    {
+        uint32_t incomingInputs = 0;
+
+        // Populate the current network with layers.
+        for (auto nbrOfNeurons : layers)
+        {
+            m_layers.push_back(Layer<T>(nbrOfNeurons, incomingInputs, func, m_rng));
+            incomingInputs = nbrOfNeurons;
+        }
+
+        m_workspaces.emplace_back(m_layers);
+
+        // Save the current network state.
+        save();
+    }
+
+    template <typename T>
+    Network<T>::~Network()
+    {
+    }
+
+    template <typename T>
+    double Network<T>::iterate(
+        const Samples<T> &trainingData,
+        const std::vector<uint32_t> &order,
+        const Settings &settings,
+        Thread_pool *pool)
+    {
+        const size_t threads = pool ? pool->size() : 1;
+        const size_t batchSize = settings.batch_size;
+        const size_t count = order.size();
+        double error = 0.0;
+
+        if (threads == 1)
+        {
+            if (batchSize > 1)
+            {
+                error = train_batches(m_workspaces[0], trainingData, order, 0, count, batchSize);
+            }
+            else
+            {
+                error = train_samples(m_workspaces[0], trainingData, order, 0, count);
+            }
+        }
+        else
+        {
+            if (settings.parallel_mode == Parallel_mode::HOGWILD)
+            {
+                // Each thread trains on a contiguous share of the order, on the shared weights.
+                pool->run([&](size_t thread) {
+                    size_t first = count * thread / threads;
+                    size_t last = count * (thread + 1) / threads;
+
+                    if (batchSize > 1)
+                    {
+                        m_workspaces[thread].error =
+                            train_batches(m_workspaces[thread], trainingData, order, first, last, batchSize);
+                    }
+                    else
+                    {
+                        m_workspaces[thread].error =
+                            train_samples(m_workspaces[thread], trainingData, order, first, last);
+                    }
+                });
+            }
+            else
+            {
+                train_synchronous(trainingData, order, settings, *pool);
+            }
+
+            // Sum in a fixed order, to keep the result reproducible.
+            for (size_t thread = 0; thread < threads; ++thread)
+            {
+                error += m_workspaces[thread].error;
+            }
+        }
+
+        return error / count;
+    }
+
+    template <typename T>
+    double Network<T>::train_epoch(
+        const Samples<T> &trainingData,
+        std::vector<uint32_t> &order,
+        const Settings &settings,
+        Thread_pool *pool)
+    {
+        const size_t count = trainingData.size();
+        const size_t chunkSize = settings.chunk_size;
+
+        if (chunkSize == 0 || chunkSize >= count)
+        {
+            std::shuffle(std::begin(order), std::end(order), m_rng);
+            return iterate(trainingData, order, settings, pool);
+        }
+
+        // The chunk boundaries move at every epoch, so that neighbouring samples
+        // do not always end up in the same chunk, and the chunks come in random order.
+        const size_t offset = std::uniform_int_distribution<size_t>(0, chunkSize - 1)(m_rng);
+        std::vector<size_t> &starts = m_chunk_starts;
+
+        starts.clear();
+
+        if (offset > 0)
+        {
+            starts.push_back(0);
+        }
+
+        for (size_t start = offset; start < count; start += chunkSize)
+        {
+            starts.push_back(start);
+        }
+
+        std::shuffle(std::begin(starts), std::end(starts), m_rng);
+
+        auto chunk_end = [&](size_t start) {
+            return start < offset ? offset : std::min(count, start + chunkSize);
+        };
+
+        double error = 0.0;
+
+        trainingData.prefetch(starts[0], chunk_end(starts[0]));
+
+        for (size_t chunk = 0; chunk < starts.size(); ++chunk)
+        {
+            const size_t first = starts[chunk];
+            const size_t last = chunk_end(first);
+
+            if (chunk + 1 < starts.size())
+            {
+                trainingData.prefetch(starts[chunk + 1], chunk_end(starts[chunk + 1]));
+            }
+
+            // Shuffled within the chunk
+            order.resize(last - first);
+            std::iota(std::begin(order), std::end(order), first);
+            std::shuffle(std::begin(order), std::end(order), m_rng);
+
+            error += iterate(trainingData, order, settings, pool) * order.size();
+
+            trainingData.release(first, last);
+        }
+
+        return error / count;
+    }
+
+    template <typename T>
+    double Network<T>::evaluate(
+        const Samples<T> &trainingData,
+        const uint32_t *samples,
+        size_t count,
+        const Settings &settings,
+        Thread_pool *pool)
+    {
+        const size_t threads = pool ? pool->size() : 1;
+        const size_t batchSize = settings.batch_size;
+
+        // Sum of the errors of the selected samples [first, last)
+        auto evaluate_range = [&](size_t first, size_t last) {
+            double error = 0.0;
+
+            if (threads == 1)
+            {
+                error = evaluate(m_workspaces[0], trainingData, samples, first, last, batchSize);
+            }
+            else
+            {
+                pool->run([&](size_t thread) {
+                    m_workspaces[thread].error = evaluate(
+                        m_workspaces[thread],
+                        trainingData,
+                        samples,
+                        first + (last - first) * thread / threads,
+                        first + (last - first) * (thread + 1) / threads,
+                        batchSize);
+                });
+
+                // Sum in a fixed order, to keep the result reproducible.
+                for (size_t thread = 0; thread < threads; ++thread)
+                {
+                    error += m_workspaces[thread].error;
+                }
+            }
+
+            return error;
+        };
+
+        double averageError = 0.0;
+
+        // Compute average error for all the selected data sets.
+        if (samples || settings.chunk_size == 0 || settings.chunk_size >= count)
+        {
+            averageError = evaluate_range(0, count);
+        }
+        else
+        {
+            // Stream through the whole data set, chunk by chunk.
+            for (size_t first = 0; first < count; first += settings.chunk_size)
+            {
+                const size_t last = std::min(count, first + settings.chunk_size);
+
+                trainingData.prefetch(last, std::min(count, last + settings.chunk_size));
+                averageError += evaluate_range(first, last);
+                trainingData.release(first, last);
+            }
+        }
+
+        return averageError / count;
+    }
+
+    template <typename T>
+    double Network<T>::train_samples(
+        Workspace<T> &workspace,
+        const Samples<T> &trainingData,
+        const std::vector<uint32_t> &order,
+        size_t first,
+        size_t last)
+    {
+        const size_t outputs = m_layers.back().size();
+        double error = 0.0;
+        Stopwatch watch(workspace.timed);
+
+        // The momentums may have been changed by other threads or restored since the last call.
+        workspace.pending_known = false;
+
+        for (; first < last; ++first)
+        {
+            const size_t sample = order[first];
+            const Sparse_inputs<T> *sparse = trainingData.sparse_inputs(sample);
+            const Update<T> update = next_update(workspace);
+
+            // Forward propagation.
+            propagate(workspace, trainingData, sample);
+
+            // Compute the output error for the current data set.
+            compute_errors(
+                trainingData.outputs(sample), workspace.layers.back().output.data(), workspace.output_errors.data(), outputs);
+            error += get_mean_error(workspace.output_errors.data(), outputs, outputs);
+            watch.lap(workspace.forward_time);
+
+            // Back-propagate the error starting from the output layer to the input layer.
+            // The first layer shall not perform any adjustments.
+            const T *errors = workspace.output_errors.data();
+
+            for (int index = m_layers.size() - 1; index > 0; index--)
+            {
+                if (index == 1 && sparse)
+                {
+                    // Only the weights of the non-zero inputs, and of the pending momentums.
+                    m_layers[1].back_propagate(
+                        *sparse,
+                        workspace.pending_known ? workspace.pending_inputs.data() : nullptr,
+                        workspace.pending_inputs.size(),
+                        workspace.layers[1].output.data(),
+                        errors,
+                        workspace.layers[1].deltas.data(),
+                        workspace.sparse_scratch,
+                        update);
+
+                    workspace.pending_inputs.assign(sparse->indices.begin(), sparse->indices.end());
+                    workspace.pending_known = true;
+                    break;
+                }
+
+                auto &currBuffers = workspace.layers[index];
+                auto &prevBuffers = workspace.layers[index - 1];
+
+                m_layers[index].back_propagate(
+                    prevBuffers.output.data(),
+                    currBuffers.output.data(),
+                    errors,
+                    currBuffers.deltas.data(),
+                    currBuffers.errors.data(),
+                    update);
+
+                errors = currBuffers.errors.data();
+            }
+
+            if (!sparse)
+            {
+                workspace.pending_known = false;
+            }
+
+            watch.lap(workspace.backward_time);
+        }
+
+        return error;
+    }
+
+    template <typename T>
+    double Network<T>::train_batches(
+        Workspace<T> &workspace,
+        const Samples<T> &trainingData,
+        const std::vector<uint32_t> &order,
+        size_t first,
+        size_t last,
+        size_t batchSize)
+    {
+        double error = 0.0;
+
+        for (; first < last; first += batchSize)
+        {
+            size_t end = std::min(last, first + batchSize);
+
+            error += compute_gradients(workspace, trainingData, order, first, end);
+
+            Stopwatch watch(workspace.timed);
+            const Update<T> update = next_update(workspace);
+
+            // One weight update per layer for the whole batch.
+            for (size_t index = 1; index < m_layers.size(); index++)
+            {
+                m_layers[index].apply_gradients(
+                    workspace.layers[index].gradients, 1.0 / (end - first), 0, m_layers[index].parameters(), update);
+            }
+
+            watch.lap(workspace.backward_time);
+        }
+
+        return error;
+    }
+
+    template <typename T>
+    void Network<T>::train_synchronous(
+        const Samples<T> &trainingData,
+        const std::vector<uint32_t> &order,
+        const Settings &settings,
+        Thread_pool &pool)
+    {
+        const size_t threads = pool.size();
+        const size_t batchSize = std::max<size_t>(settings.batch_size, threads);
+        size_t first = 0;
+        size_t count = 0;
+        Update<T> update;
+
+        // Each thread computes the gradients for its share of the batch...
+        auto gradients = [&](size_t thread) {
+            m_workspaces[thread].error += compute_gradients(
+                m_workspaces[thread],
+                trainingData,
+                order,
+                first + count * thread / threads,
+                first + count * (thread + 1) / threads);
+        };
+
+        // ... then sums a share of the weights' gradients from all threads and applies them.
+        auto reduce = [&](size_t thread) {
+            Stopwatch watch(m_workspaces[thread].timed);
+
+            for (size_t index = 1; index < m_layers.size(); index++)
+            {
+                const size_t parameters = m_layers[index].parameters();
+                const size_t begin = parameters * thread / threads;
+                const size_t end = parameters * (thread + 1) / threads;
+                Matrix<T> &sum = m_workspaces[0].layers[index].gradients;
+
+                for (size_t other = 1; other < threads; ++other)
+                {
+                    const Matrix<T> &gradients = m_workspaces[other].layers[index].gradients;
+
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        sum.data()[i] += gradients.data()[i];
+                    }
+                }
+
+                m_layers[index].apply_gradients(sum, 1.0 / count, begin, end, update);
+            }
+
+            watch.lap(m_workspaces[thread].backward_time);
+        };
+
+        for (size_t thread = 0; thread < threads; ++thread)
+        {
+            m_workspaces[thread].error = 0.0;
+        }
+
+        for (; first < order.size(); first += batchSize)
+        {
+            count = std::min(order.size() - first, batchSize);
+
+            pool.run(gradients);
+
+            // One step for the whole batch, whichever thread applies it.
+            update = next_update(m_workspaces[0]);
+            pool.run(reduce);
+        }
+    }
+
+    template <typename T>
+    double Network<T>::compute_gradients(
+        Workspace<T> &workspace,
+        const Samples<T> &trainingData,
+        const std::vector<uint32_t> &order,
+        size_t first,
+        size_t last) const
+    {
+        if (first == last)
+        {
+            // Nothing to contribute to the batch
+            for (size_t index = 1; index < m_layers.size(); index++)
+            {
+                Matrix<T> &gradients = workspace.layers[index].gradients;
+
+                gradients.resize(m_layers[index].size(), m_layers[index].inputs());
+                std::fill(gradients.data(), gradients.data() + gradients.size(), T());
+            }
+
+            return 0.0;
+        }
+
+        Stopwatch watch(workspace.timed);
+
+        load_batch(workspace, trainingData, order.data(), first, last);
+
+        // Forward propagation of the whole batch.
+        propagate(workspace);
+
+        // Compute the output errors for the current batch.
+        const Matrix<T> &outputs = workspace.layers.back().batch_output;
+
+        workspace.batch_output_errors.resize(outputs.rows(), outputs.cols());
+        compute_errors(
+            workspace.batch_targets.data(), outputs.data(), workspace.batch_output_errors.data(), outputs.size());
+        watch.lap(workspace.forward_time);
+
+        // Back-propagate the errors, accumulating the gradients of the whole batch.
+        const Matrix<T> *errors = &workspace.batch_output_errors;
+
+        for (int index = m_layers.size() - 1; index > 0; index--)
+        {
+            auto &currBuffers = workspace.layers[index];
+            auto &prevBuffers = workspace.layers[index - 1];
+
+            m_layers[index].compute_gradients(
+                prevBuffers.batch_output,
+                currBuffers.batch_output,
+                *errors,
+                currBuffers.batch_deltas,
+                currBuffers.batch_errors,
+                currBuffers.gradients);
+
+            errors = &currBuffers.batch_errors;
+        }
+
+        watch.lap(workspace.backward_time);
+
+        return get_mean_error(workspace.batch_output_errors.data(), outputs.size(), outputs.cols());
+    }
+
+    template <typename T>
+    double Network<T>::evaluate(
+        Workspace<T> &workspace,
+        const Samples<T> &trainingData,
+        const uint32_t *samples,
+        size_t first,
+        size_t last,
+        size_t batchSize) const
+    {
+        const size_t outputs = m_layers.back().size();
+        double error = 0.0;
+
+        if (batchSize > 1)
+        {
+            for (; first < last; first += batchSize)
+            {
+                load_batch(workspace, trainingData, samples, first, std::min(last, first + batchSize));
+                propagate(workspace);
+
+                const Matrix<T> &output = workspace.layers.back().batch_output;
+
+                error += get_mean_error(workspace.batch_targets.data(), output.data(), output.size(), outputs);
+            }
+        }
+        else
+        {
+            for (; first < last; ++first)
+            {
+                const size_t sample = samples ? samples[first] : first;
+
+                propagate(workspace, trainingData, sample);
+                error += get_mean_error(trainingData.outputs(sample), workspace.layers.back().output.data(), outputs, outputs);
+            }
+        }
+
+        return error;
+    }
+
+    template <typename T>
+    void Network<T>::load_batch(
+        Workspace<T> &workspace,
+        const Samples<T> &trainingData,
+        const uint32_t *order,
+        size_t first,
+        size_t last) const
+    {
+        Matrix<T> &inputs = workspace.layers[0].batch_output;
+        Matrix<T> &targets = workspace.batch_targets;
+
+        inputs.resize(last - first, m_layers[0].size());
+        targets.resize(last - first, m_layers.back().size());
+
+        for (size_t row = 0; first < last; ++first, ++row)
+        {
+            const size_t sample = order ? order[first] : first;
+
+            const Sparse_inputs<T> *sparse = trainingData.sparse_inputs(sample);
+
+            if (sparse)
+            {
+                T *values = inputs.row(row);
+
+                std::fill(values, values + inputs.cols(), T());
+
+                for (size_t i = 0; i < sparse->indices.size(); ++i)
+                {
+                    values[sparse->indices[i]] = sparse->values.empty() ? T(1) : sparse->values[i];
+                }
+            }
+            else
+            {
+                std::copy(trainingData.inputs(sample), trainingData.inputs(sample) + inputs.cols(), inputs.row(row));
+            }
+            std::copy(trainingData.outputs(sample), trainingData.outputs(sample) + targets.cols(), targets.row(row));
+        }
+    }
+
+    template <typename T>
+    Update<T> Network<T>::next_update(Workspace<T> &workspace) const
+    {
+        Update<T> update = m_update;
+
+        if (update.optimizer == Optimizer::ADAM)
+        {
+            // Counters of each thread with HOGWILD, which only makes the corrections last a bit longer.
+            const double steps = (double) ++workspace.steps;
+
+            update.step.rate *= sqrt(1.0 - pow(update.step.beta2, steps)) / (1.0 - pow(update.step.beta1, steps));
+        }
+
+        return update;
+    }
+
+    template <typename T>
+    void Network<T>::propagate(Workspace<T> &workspace) const
+    {
+        // The batch inputs are loaded as the output of the first/input layer.
+        for (uint32_t i = 1; i < m_layers.size(); i++)
+        {
+            m_layers[i].propagate(workspace.layers[i - 1].batch_output, workspace.layers[i].batch_output);
+        }
+    }
+
+    template <typename T>
+    void Network<T>::propagate(Workspace<T> &workspace, const T *inputs) const
+    {
+        // Set the output of the first/input layer.
+        std::copy(inputs, inputs + m_layers[0].size(), workspace.layers[0].output.begin());
+
+        // Forward propagation
+        for (uint32_t i = 1; i < m_layers.size(); i++)
+        {
+            m_layers[i].propagate(workspace.layers[i - 1].output.data(), workspace.layers[i].output.data());
+        }
+    }
+
+    template <typename T>
+    void Network<T>::propagate(Workspace<T> &workspace, const Sparse_inputs<T> &inputs) const
+    {
+        // The first layer only reads the weights of the non-zero inputs.
+        m_layers[1].propagate(inputs, workspace.layers[1].output.data());
+
+        for (uint32_t i = 2; i < m_layers.size(); i++)
+        {
+            m_layers[i].propagate(workspace.layers[i - 1].output.data(), workspace.layers[i].output.data());
+        }
+    }
+
+    template <typename T>
+    void Network<T>::propagate(Workspace<T> &workspace, const Samples<T> &trainingData, size_t sample) const
+    {
+        const Sparse_inputs<T> *sparse = trainingData.sparse_inputs(sample);
+
+        if (sparse)
+        {
+            propagate(workspace, *sparse);
+        }
+        else
+        {
+            propagate(workspace, trainingData.inputs(sample));
+        }
+    }
+
+    template <typename T>
+    std::vector<T> Network<T>::test(const std::vector<T> &inputs)
+    {
+        assert(inputs.size() == m_layers[0].size());
+
+        propagate(m_workspaces[0], inputs.data());
+
+        const Aligned_vector<T> &output = m_workspaces[0].layers.back().output;
+
+        return std::vector<T>(output.begin(), output.end());
+    }
+
+    template <typename T>
+    void Network<T>::test(Workspace<T> &workspace, const T *inputs, size_t count, T *outputs) const
+    {
+        const size_t inputSize = m_layers[0].size();
+        const size_t outputSize = m_layers.back().size();
+
+        assert(workspace.layers.size() == m_layers.size());
+
+        if (count == 1)
+        {
+            // Matrix-vector products, no batch buffers involved
+            propagate(workspace, inputs);
+
+            const Aligned_vector<T> &output = workspace.layers.back().output;
+            std::copy(output.begin(), output.end(), outputs);
+            return;
+        }
+
+        Matrix<T> &batch = workspace.layers[0].batch_output;
+
+        batch.resize(count, inputSize);
+        std::copy(inputs, inputs + count * inputSize, batch.data());
+
+        propagate(workspace);
+
+        const Matrix<T> &output = workspace.layers.back().batch_output;
+        std::copy(output.data(), output.data() + count * outputSize, outputs);
+    }
+
+    template <typename T>
+    std::vector<T> Network<T>::test(const Sparse_inputs<T> &inputs)
+    {
+        assert(inputs.indices.empty() || inputs.indices.back() < m_layers[0].size());
+
+        propagate(m_workspaces[0], inputs);
+
+        const Aligned_vector<T> &output = m_workspaces[0].layers.back().output;
+
+        return std::vector<T>(output.begin(), output.end());
+    }
+
+    template <typename T>
+    void Network<T>::test(Workspace<T> &workspace, const Sparse_inputs<T> *inputs, size_t count, T *outputs) const
+    {
+        const size_t outputSize = m_layers.back().size();
+
+        assert(workspace.layers.size() == m_layers.size());
+
+        // Sample by sample, a batch would be dense
+        for (size_t sample = 0; sample < count; ++sample)
+        {
+            propagate(workspace, inputs[sample]);
+
+            const Aligned_vector<T> &output = workspace.layers.back().output;
+            std::copy(output.begin(), output.end(), outputs + sample * outputSize);
+        }
+    }
+
+    template <typename T>
+    Workspace<T> Network<T>::create_workspace(size_t batchSize, bool hugePages) const
+    {
+        return Workspace<T>(m_layers, batchSize > 1 ? batchSize : 0, hugePages);
+    }
+
+    template <typename T>
+    size_t Network<T>::inputs() const
+    {
+        return m_layers[0].size();
+    }
+
+    template <typename T>
+    size_t Network<T>::outputs() const
+    {
+        return m_layers.back().size();
+    }
+
+    template <typename T>
+    double Network<T>::train(const std::vector<Training_data<T>> &data, const Settings &settings)
+    {
+        check_sizes(data, m_layers.front().size(), m_layers.back().size());
+
+        return train(Samples<T>(data), settings);
+    }
+
+    template <typename T>
+    double Network<T>::train(const Samples<T> &data, const Settings &settings)
+    {
+        check_widths(data, m_layers.front().size(), m_layers.back().size());
+
+        return train_session(data, nullptr, settings);
+    }
+
+    template <typename T>
+    double Network<T>::train(
+        const std::vector<Training_data<T>> &data,
+        const std::vector<Training_data<T>> &validation,
+        const Settings &settings)
+    {
+        check_sizes(data, m_layers.front().size(), m_layers.back().size());
+        check_sizes(validation, m_layers.front().size(), m_layers.back().size());
+
+        return train(Samples<T>(data), Samples<T>(validation), settings);
+    }
+
+    template <typename T>
+    double Network<T>::train(const Samples<T> &data, const Samples<T> &validation, const Settings &settings)
+    {
+        check_widths(data, m_layers.front().size(), m_layers.back().size());
+        check_widths(validation, m_layers.front().size(), m_layers.back().size());
+
+        return train_session(data, validation.size() ? &validation : nullptr, settings);
+    }
+
+    template <typename T>
+    double Network<T>::evaluate(const std::vector<Training_data<T>> &data) const
+    {
+        check_sizes(data, m_layers.front().size(), m_layers.back().size());
+
+        return evaluate(Samples<T>(data));
+    }
+
+    template <typename T>
+    double Network<T>::evaluate(const Samples<T> &data) const
+    {
+        check_widths(data, m_layers.front().size(), m_layers.back().size());
+
+        Workspace<T> workspace = create_workspace();
+
+        return data.size() ? evaluate(workspace, data, nullptr, 0, data.size(), 1) / data.size() : 0.0;
+    }
+
+    template <typename T>
+    void Network<T>::prune(double sparsity)
+    {
+        std::vector<T> magnitudes;
+
+        for (const auto &layer : m_layers)
+        {
+            for (size_t i = 0; i < layer.parameters(); ++i)
+            {
+                magnitudes.push_back(fabs(layer.weights().data()[i]));
+            }
+        }
+
+        const T threshold = pruning_threshold(magnitudes, sparsity);
+
+        if (threshold == T())
+        {
+            return;
+        }
+
+        for (auto &layer : m_layers)
+        {
+            layer.prune(threshold);
+        }
+
+        // A restore must not bring the pruned weights back.
+        save();
+    }
+
+    template <typename T>
+    void Network<T>::prune(const std::vector<double> &sparsities)
+    {
+        if (sparsities.size() + 1 != m_layers.size())
+        {
+            throw std::invalid_argument("One sparsity is required per layer, but the input layer");
+        }
+
+        for (size_t index = 1; index < m_layers.size(); ++index)
+        {
+            Layer<T> &layer = m_layers[index];
+            std::vector<T> magnitudes(layer.parameters());
+
+            for (size_t i = 0; i < magnitudes.size(); ++i)
+            {
+                magnitudes[i] = fabs(layer.weights().data()[i]);
+            }
+
+            const T threshold = pruning_threshold(magnitudes, sparsities[index - 1]);
+
+            if (threshold != T())
+            {
+                layer.prune(threshold);
+            }
+        }
+
+        save();
+    }
+
+    template <typename T>
+    double Network<T>::sparsity() const
+    {
+        size_t pruned = 0;
+        size_t parameters = 0;
+
+        for (const auto &layer : m_layers)
+        {
+            pruned += layer.pruned();
+            parameters += layer.parameters();
+        }
+
+        return parameters ? (double) pruned / parameters : 0.0;
+    }
+
+    template <typename T>
+    double Network<T>::train_session(const Samples<T> &data, const Samples<T> *validation, const Settings &settings)
+    {
+        // Optimizer, its state kept from the previous session if it did not change.
+        kernels::Step<T> step = {
+            (T) settings.learning_rate, (T) settings.momentum, (T) settings.squares_decay, (T) settings.epsilon };
+
+        if (settings.optimizer != m_update.optimizer)
+        {
+            for (auto &workspace : m_workspaces)
+            {
+                workspace.steps = 0;
+            }
+        }
+
+        m_update = Update<T>(settings.optimizer, step);
+
+        for (auto &layer : m_layers)
+        {
+            layer.set_optimizer(settings.optimizer);
+        }
+
+        // Training order, or the order within the current chunk when streaming.
+        std::vector<uint32_t> order;
+
+        if (settings.chunk_size == 0 || settings.chunk_size >= data.size())
+        {
+            order.resize(data.size());
+            std::iota(std::begin(order), std::end(order), 0);
+        }
+
+        // Additional threads and their workspaces, if requested.
+        std::unique_ptr<Thread_pool> pool;
+
+        if (settings.threads > 1)
+        {
+            pool.reset(new Thread_pool(settings.threads));
+
+            while (m_workspaces.size() < settings.threads)
+            {
+                m_workspaces.emplace_back(m_layers, 0, settings.huge_pages);
+            }
+        }
+
+        // Plan the workspaces for the largest batch and the largest sparse sample of the session,
+        // so that the epochs do not allocate.
+        const bool batched =
+            settings.batch_size > 1 || (settings.threads > 1 && settings.parallel_mode == Parallel_mode::SYNCHRONOUS);
+        const size_t nonzeros = data.max_nonzeros();
+
+        for (auto &workspace : m_workspaces)
+        {
+            workspace.huge_pages = workspace.huge_pages || settings.huge_pages;
+            workspace.reserve(batched ? std::max(settings.batch_size, settings.threads) : 0, batched, nonzeros);
+        }
+
+        // Samples the error is evaluated on, nullptr for the whole data set.
+        std::vector<uint32_t> subsample;
+        const uint32_t *samples = nullptr;
+        size_t sampleCount = data.size();
+
+        if (settings.evaluation == Evaluation::SUBSAMPLE && settings.evaluation_samples < data.size())
+        {
+            // Fixed for the whole session, so that the errors remain comparable.
+            subsample.resize(data.size());
+            std::iota(std::begin(subsample), std::end(subsample), 0);
+            std::shuffle(std::begin(subsample), std::end(subsample), m_rng);
+            subsample.resize(settings.evaluation_samples);
+            std::sort(std::begin(subsample), std::end(subsample));
+
+            samples = subsample.data();
+            sampleCount = subsample.size();
+        }
+
+        // Copy of the network evaluated on a background thread, for Evaluation::PARALLEL.
+        std::unique_ptr<Network<T>> snapshot;
+        double snapshotError = 0.0;
+        bool evaluating = false;
+
+        auto evaluate_snapshot = [&] {
+            snapshotError = snapshot->evaluate(data, samples, sampleCount, settings, nullptr);
+        };
+
+        Background_thread evaluator;
+
+        if (settings.evaluation == Evaluation::PARALLEL)
+        {
+            snapshot.reset(new Network<T>(*this));
+            evaluator.launch();
+        }
+
+        // Copy of the network evaluated on the validation data on a background
+        // thread, while the next epoch is trained. Its restore point holds the
+        // parameters with the lowest validation error.
+        std::unique_ptr<Network<T>> validated;
+        double validationError = 0.0;
+        double bestValidationError = std::numeric_limits<double>::infinity();
+        uint32_t staleValidations = 0;
+        bool validating = false;
+
+        auto validate_snapshot = [&] {
+            validationError = validated->evaluate(*validation, nullptr, validation->size(), settings, nullptr);
+        };
+
+        Background_thread validator;
+
+        if (validation)
+        {
+            validated.reset(new Network<T>(*this));
+        }
+
+        // Telemetry, only measured when observed.
+        const bool observed = static_cast<bool>(settings.observer);
+        const bool timed = observed && settings.timing;
+        const size_t threads = pool ? pool->size() : 1;
+        Epoch_report report = Epoch_report();
+
+        for (auto &workspace : m_workspaces)
+        {
+            workspace.timed = timed;
+        }
+
+        uint32_t epochs = 0;
+
+        auto train_once = [&] {
+            Stopwatch watch(timed);
+
+            m_update.step.rate = (T) (settings.learning_rate * pow(settings.learning_rate_decay, epochs++));
+
+            report.training_error = train_epoch(data, order, settings, pool.get());
+            watch.lap(report.training_time);
+
+            return report.training_error;
+        };
+
+        auto evaluate_all = [&] {
+            Stopwatch watch(timed);
+            double evaluationError = evaluate(data, samples, sampleCount, settings, pool.get());
+
+            watch.lap(report.evaluation_time);
+
+            return evaluationError;
+        };
+
+        // Perform an iteration to get a reference error.
+        double error = train_once();
+
+        if (settings.evaluation != Evaluation::TRAINING)
+        {
+            error = evaluate_all();
+        }
+
+        // Save network state for which we have the error computed.
+        Stopwatch snapshotWatch(timed);
+
+        save();
+        snapshotWatch.lap(report.snapshot_time);
+        report.stores++;
+
+        // Validate a copy of the current parameters while the next epoch is trained.
+        auto start_validation = [&] {
+            validated->copy_parameters(*this);
+            validator.start(validate_snapshot);
+            validating = true;
+        };
+
+        // Wait for the pending validation and keep its parameters if they are the best so far.
+        // Returns true if the validation error did not improve for settings.patience validations.
+        auto check_validation = [&] {
+            validator.wait();
+            validating = false;
+            report.validation_error = validationError;
+
+            if (validationError < bestValidationError)
+            {
+                bestValidationError = validationError;
+                staleValidations = 0;
+                validated->save();
+            }
+            else
+            {
+                staleValidations++;
+            }
+
+            return staleValidations >= settings.patience;
+        };
+
+        if (validation)
+        {
+            start_validation();
+        }
+
+        double previousError = error;
+        double storeThreshold = error * settings.store_threshold;
+        double restoreThreshold = error * settings.restore_threshold;
+        uint32_t interation = 0;
+        bool evaluated = true; // The error corresponds to the current weights
+
+        // Decide what to do with the parameters which got the given error.
+        // Returns true if the target error has been reached.
+        auto check = [&](double epochError, const Network<T> &parameters) {
+            Stopwatch watch(timed);
+            bool done = false;
+
+            error = epochError;
+
+            if (error <= settings.target_error)
+            {
+                copy_parameters(parameters);
+                done = true;
+            }
+            else if (error < storeThreshold)
+            {
+                // Save the network only when the specified improvement is reached
+                previousError = error;
+                storeThreshold = error * settings.store_threshold;
+                restoreThreshold = error * settings.restore_threshold;
+                save(parameters);
+                report.stores++;
+            }
+            else if (error > restoreThreshold)
+            {
+                // Pretty unlikely with the right data in the current form
+                restore();
+                report.restores++;
+            }
+
+            watch.lap(report.snapshot_time);
+
+            return done;
+        };
+
+        // Report an epoch to the observer, returns true if it requested to stop.
+        auto notify = [&](uint32_t epoch) {
+            report.epoch = epoch;
+            report.error = error;
+            report.forward_time = 0.0;
+            report.backward_time = 0.0;
+
+            for (size_t thread = 0; thread < threads; ++thread)
+            {
+                report.forward_time += m_workspaces[thread].forward_time / threads;
+                report.backward_time += m_workspaces[thread].backward_time / threads;
+                m_workspaces[thread].forward_time = 0.0;
+                m_workspaces[thread].backward_time = 0.0;
+            }
+
+            double seconds = report.training_time + report.evaluation_time + report.snapshot_time;
+            report.samples_per_second = seconds > 0.0 ? data.size() / seconds : 0.0;
+
+            bool stop = settings.observer(report);
+
+            report.training_time = 0.0;
+            report.evaluation_time = 0.0;
+            report.snapshot_time = 0.0;
+
+            return stop;
+        };
+
+        bool stopped = observed && notify(1);
+
+        while (!stopped && ++interation < settings.max_iterations)
+        {
+            double trainingError = train_once();
+            bool done = false;
+
+            switch (settings.evaluation)
+            {
+                case Evaluation::TRAINING:
+                    // Errors measured before each update, during the epoch.
+                    done = check(trainingError, *this);
+                    break;
+
+                case Evaluation::PERIODIC:
+                    evaluated = (interation % settings.evaluation_period) == 0;
+
+                    if (evaluated)
+                    {
+                        done = check(evaluate_all(), *this);
+                    }
+                    break;
+
+                case Evaluation::PARALLEL:
+                    // Check the previous epoch, whose error was computed meanwhile...
+                    if (evaluating)
+                    {
+                        Stopwatch watch(timed);
+
+                        evaluator.wait();
+                        evaluating = false;
+                        watch.lap(report.evaluation_time);
+                        done = check(snapshotError, *snapshot);
+                    }
+
+                    // ... and start evaluating the current one.
+                    if (!done)
+                    {
+                        Stopwatch watch(timed);
+
+                        snapshot->copy_parameters(*this);
+                        evaluator.start(evaluate_snapshot);
+                        evaluating = true;
+                        watch.lap(report.evaluation_time);
+                    }
+
+                    evaluated = done;
+                    break;
+
+                default:
+                    done = check(evaluate_all(), *this);
+                    break;
+            }
+
+            if (validation)
+            {
+                Stopwatch watch(timed);
+
+                if (validating && check_validation())
+                {
+                    done = true;
+                }
+
+                if (!done)
+                {
+                    start_validation();
+                }
+
+                watch.lap(report.evaluation_time);
+            }
+
+            if (observed && notify(interation + 1))
+            {
+                done = true;
+            }
+
+            if (done)
+            {
+                break;
+            }
+        }
+
+        if (evaluating)
+        {
+            evaluator.wait();
+            evaluated = check(snapshotError, *snapshot);
+        }
+
+        if (!evaluated)
+        {
+            error = evaluate_all();
+        }
+
+        if (error < previousError)
+        {
+            save();
+        }
+        else if (error > previousError) {
+            error = previousError;
+            restore();
+        }
+
+        if (validation)
+        {
+            if (validating)
+            {
+                check_validation();
+            }
+
+            // The parameters kept are validated as well, the best ones are restored.
+            validated->copy_parameters(*this);
+            validate_snapshot();
+
+            if (validationError >= bestValidationError)
+            {
+                validated->restore();
+                copy_parameters(*validated);
+                error = evaluate_all();
+                save();
+            }
+        }
+
+        return error;
+    }
+
+    template <typename T>
+    void Network<T>::copy_parameters(const Network &other)
+    {
+        if (&other != this)
+        {
+            for (size_t index = 0; index < m_layers.size(); ++index)
+            {
+                m_layers[index].copy_parameters(other.m_layers[index]);
+            }
+        }
+    }
+
+    template <typename T>
+    void Network<T>::save()
+    {
+        save(*this);
+    }
+
+    template <typename T>
+    void Network<T>::save(const Network &source)
+    {
+        size_t parameters = 0;
+
+        for (const auto &layer : source.m_layers)
+        {
+            parameters += layer.snapshot_size();
+        }
+
+        // Allocated when constructing the network, reused afterwards
+        m_restore_point.resize(parameters);
+
+        T *buffer = m_restore_point.data();
+
+        for (const auto &layer : source.m_layers)
+        {
+            buffer = layer.save(buffer);
+        }
+    }
+
+    template <typename T>
+    void Network<T>::restore()
+    {
+        const T *buffer = m_restore_point.data();
+
+        for (auto &layer : m_layers)
+        {
+            buffer = layer.restore(buffer);
+        }
+    }
+
+    template <typename T>
+    const std::vector<Layer<T>>& Network<T>::layers() const
+    {
+        return m_layers;
+    }
+
+    template <typename T>
+    std::ostream& operator<<(std::ostream &output, const Network<T> &net)
+    {
+        size_t index = 0;
+
+        output << "Network: ";
+
+        for (const auto &layer : net.m_layers)
+        {
+            output << layer.size() << " ";
+        }
+
+        for (const auto &layer : net.m_layers)
+        {
+            output << "\n\t[Layer " << ++index << "]" << std::endl << layer;
+        }
+
+        return output;
+    }
+
+    template class Network<double>;
+    template class Network<float>;
+
+    template std::ostream& operator<<(std::ostream &output, const Network<double> &net);
+    template std::ostream& operator<<(std::ostream &output, const Network<float> &net);
+}
@@ -0,0 +1,382 @@
+/*
+ * Pipelined_network.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+#include "Matrix.hpp"
+#include "Pipelined_network.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        /**
+         * Class Backoff: waiting for the other side of a ring, spinning first,
+         * then yielding the core, then sleeping, so that idle stages do not
+         * keep a core busy.
+         */
+        struct Backoff
+        {
+                size_t rounds = 0;  ///< Times waited so far
+
+                void wait()
+                {
+                    ++rounds;
+
+                    if (rounds < 64)
+                    {
+                        return;
+                    }
+                    if (rounds < 4096)
+                    {
+                        std::this_thread::yield();
+                        return;
+                    }
+
+                    std::this_thread::sleep_for(std::chrono::microseconds(50));
+                }
+        };
+
+        uint64_t nanoseconds(Clock::duration duration)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+        }
+    }
+
+    Pipeline_settings::Pipeline_settings(size_t stages) :
+        stages(stages),
+        batch_size(16),
+        ring_capacity(4),
+        pin_threads(false)
+    {
+    }
+
+    template <typename T>
+    Pipelined_network<T>::Pipelined_network(const Network<T> &network, const Pipeline_settings &settings) :
+        m_network(network),
+        m_settings(settings),
+        m_popped(0),
+        m_stop(false)
+    {
+        const std::vector<Layer<T>> &layers = network.layers();
+        std::vector<size_t> stageLayers = settings.stage_layers;
+
+        m_settings.batch_size = std::max<size_t>(1, m_settings.batch_size);
+        m_settings.ring_capacity = std::max<size_t>(1, m_settings.ring_capacity);
+
+        if (stageLayers.empty())
+        {
+            // Consecutive layers, a layer joining a stage if half of its weights fit in the stage's share.
+            const size_t stages = std::min(std::max<size_t>(1, settings.stages), layers.size() - 1);
+            size_t total = 0;
+            size_t assigned = 0;
+            size_t layer = 1;
+
+            for (size_t i = 1; i < layers.size(); ++i)
+            {
+                total += layers[i].parameters();
+            }
+
+            for (size_t stage = 0; stage < stages; ++stage)
+            {
+                const double share = (double) total * (stage + 1) / stages;
+                size_t count = 0;
+
+                while (layer + (stages - stage - 1) < layers.size() &&
+                       (count == 0 || stage + 1 == stages || assigned + layers[layer].parameters() / 2.0 <= share))
+                {
+                    assigned += layers[layer].parameters();
+                    ++layer;
+                    ++count;
+                }
+
+                stageLayers.push_back(count);
+            }
+        }
+
+        size_t sum = 0;
+
+        for (size_t count : stageLayers)
+        {
+            if (count == 0)
+            {
+                throw std::invalid_argument("Pipeline stage without layers");
+            }
+
+            sum += count;
+        }
+
+        if (sum != layers.size() - 1)
+        {
+            throw std::invalid_argument("Pipeline stages do not cover the layers of the network");
+        }
+
+        m_settings.stages = stageLayers.size();
+        m_settings.stage_layers = stageLayers;
+
+        // Ring i holds the inputs of stage i, the last one the outputs of the network.
+        size_t first = 1;
+
+        m_rings.emplace_back(new Ring(m_settings.ring_capacity, { Aligned_vector<T>(m_settings.batch_size * layers[0].size()), 0 }));
+
+        for (size_t count : stageLayers)
+        {
+            std::unique_ptr<Stage> stage(new Stage());
+
+            stage->first = first;
+            stage->last = first + count;
+            stage->batches = 0;
+            stage->samples = 0;
+            stage->busy = 0;
+            stage->starved = 0;
+            stage->blocked = 0;
+
+            for (size_t layer = stage->first; layer + 1 < stage->last; ++layer)
+            {
+                stage->scratch.emplace_back(m_settings.batch_size * layers[layer].size());
+            }
+
+            m_rings.emplace_back(new Ring(m_settings.ring_capacity,
+                                          { Aligned_vector<T>(m_settings.batch_size * layers[stage->last - 1].size()), 0 }));
+            m_stages.push_back(std::move(stage));
+            first += count;
+        }
+
+        const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+        for (size_t index = 0; index < m_stages.size(); ++index)
+        {
+            m_stages[index]->thread = std::thread(&Pipelined_network::run_stage, this, index);
+
+            if (m_settings.pin_threads)
+            {
+                cpu_set_t cpus;
+
+                CPU_ZERO(&cpus);
+                CPU_SET(index % cores, &cpus);
+                pthread_setaffinity_np(m_stages[index]->thread.native_handle(), sizeof(cpus), &cpus);
+            }
+        }
+    }
+
+    template <typename T>
+    Pipelined_network<T>::~Pipelined_network()
+    {
+        m_stop.store(true, std::memory_order_release);
+
+        for (auto &stage : m_stages)
+        {
+            stage->thread.join();
+        }
+    }
+
+    template <typename T>
+    void Pipelined_network<T>::run_stage(size_t index)
+    {
+        const std::vector<Layer<T>> &layers = m_network.layers();
+        Stage &stage = *m_stages[index];
+        Ring &input = *m_rings[index];
+        Ring &output = *m_rings[index + 1];
+        Clock::time_point start = Clock::now();
+
+        while (true)
+        {
+            Backoff backoff;
+            Batch *in;
+            Batch *out;
+
+            while (!(in = input.consumer_slot()))
+            {
+                if (m_stop.load(std::memory_order_acquire))
+                {
+                    return;
+                }
+
+                backoff.wait();
+            }
+
+            const Clock::time_point ready = Clock::now();
+
+            backoff = Backoff();
+
+            while (!(out = output.producer_slot()))
+            {
+                if (m_stop.load(std::memory_order_acquire))
+                {
+                    return;
+                }
+
+                backoff.wait();
+            }
+
+            const Clock::time_point unblocked = Clock::now();
+            const T *values = in->values.data();
+
+            // output = f(inputs * transpose(W)) for each layer, the last one writing to the next ring
+            for (size_t layer = stage.first; layer < stage.last; ++layer)
+            {
+                const Layer<T> &current = layers[layer];
+                T *result = layer + 1 == stage.last ? out->values.data() : stage.scratch[layer - stage.first].data();
+
+                multiply_abt(values, in->count, current.inputs(), current.weights().data(), current.size(), result);
+                current.function()->compute_rows(result, in->count, current.size());
+                values = result;
+            }
+
+            out->count = in->count;
+            input.release();
+            output.publish();
+
+            const Clock::time_point end = Clock::now();
+
+            stage.starved.fetch_add(nanoseconds(ready - start), std::memory_order_relaxed);
+            stage.blocked.fetch_add(nanoseconds(unblocked - ready), std::memory_order_relaxed);
+            stage.busy.fetch_add(nanoseconds(end - unblocked), std::memory_order_relaxed);
+            stage.samples.fetch_add(out->count, std::memory_order_relaxed);
+            stage.batches.fetch_add(1, std::memory_order_relaxed);
+            start = end;
+        }
+    }
+
+    template <typename T>
+    size_t Pipelined_network<T>::push(const T *inputs, size_t count)
+    {
+        Ring &ring = *m_rings.front();
+        const size_t width = this->inputs();
+        size_t pushed = 0;
+
+        while (pushed < count)
+        {
+            Batch *batch = ring.producer_slot();
+
+            if (!batch)
+            {
+                break;
+            }
+
+            batch->count = std::min(m_settings.batch_size, count - pushed);
+            std::copy(inputs + pushed * width, inputs + (pushed + batch->count) * width, batch->values.data());
+            ring.publish();
+            pushed += batch->count;
+        }
+
+        return pushed;
+    }
+
+    template <typename T>
+    size_t Pipelined_network<T>::pop(T *outputs, size_t count)
+    {
+        Ring &ring = *m_rings.back();
+        const size_t width = this->outputs();
+        size_t popped = 0;
+
+        while (popped < count)
+        {
+            Batch *batch = ring.consumer_slot();
+
+            if (!batch)
+            {
+                break;
+            }
+
+            const size_t taken = std::min(batch->count - m_popped, count - popped);
+            const T *first = batch->values.data() + m_popped * width;
+
+            std::copy(first, first + taken * width, outputs + popped * width);
+            m_popped += taken;
+            popped += taken;
+
+            if (m_popped == batch->count)
+            {
+                m_popped = 0;
+                ring.release();
+            }
+        }
+
+        return popped;
+    }
+
+    template <typename T>
+    void Pipelined_network<T>::test(const T *inputs, size_t count, T *outputs)
+    {
+        Backoff backoff;
+        size_t pushed = 0;
+        size_t popped = 0;
+
+        while (popped < count)
+        {
+            const size_t fed = push(inputs + pushed * this->inputs(), count - pushed);
+            const size_t read = pop(outputs + popped * this->outputs(), count - popped);
+
+            pushed += fed;
+            popped += read;
+
+            if (fed || read)
+            {
+                backoff = Backoff();
+            }
+            else
+            {
+                backoff.wait();
+            }
+        }
+    }
+
+    template <typename T>
+    std::vector<Stage_stats> Pipelined_network<T>::stage_stats() const
+    {
+        std::vector<Stage_stats> result;
+
+        for (const auto &stage : m_stages)
+        {
+            Stage_stats stats;
+            const uint64_t busy = stage->busy.load(std::memory_order_relaxed);
+            const uint64_t starved = stage->starved.load(std::memory_order_relaxed);
+            const uint64_t blocked = stage->blocked.load(std::memory_order_relaxed);
+
+            stats.first_layer = stage->first;
+            stats.last_layer = stage->last - 1;
+            stats.batches = stage->batches.load(std::memory_order_relaxed);
+            stats.samples = stage->samples.load(std::memory_order_relaxed);
+            stats.busy = busy * 1e-9;
+            stats.starved = starved * 1e-9;
+            stats.blocked = blocked * 1e-9;
+            stats.occupancy = busy + starved + blocked ? (double) busy / (busy + starved + blocked) : 0.0;
+
+            result.push_back(stats);
+        }
+
+        return result;
+    }
+
+    template <typename T>
+    size_t Pipelined_network<T>::stages() const
+    {
+        return m_stages.size();
+    }
+
+    template <typename T>
+    size_t Pipelined_network<T>::inputs() const
+    {
+        return m_network.layers().front().size();
+    }
+
+    template <typename T>
+    size_t Pipelined_network<T>::outputs() const
+    {
+        return m_network.layers().back().size();
+    }
+
+    template class Pipelined_network<double>;
+    template class Pipelined_network<float>;
+}
@@ -0,0 +1,293 @@
+/*
+ * Quantized_network.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+#include <math.h>
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "Kernels.hpp"
+#include "Quantized_network.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        /** Largest quantized value, so that u8 * s8 pairs never saturate 16 bits */
+        constexpr int32_t QUANTIZED_MAX = 127;
+
+        /** Number of entries of the activation tables */
+        constexpr size_t TABLE_SIZE = 4096;
+
+        /** Class Range: smallest and largest value seen */
+        struct Range
+        {
+                double min = std::numeric_limits<double>::max();
+                double max = std::numeric_limits<double>::lowest();
+
+                template <typename T>
+                void add(const T *values, size_t count)
+                {
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        min = std::min<double>(min, values[i]);
+                        max = std::max<double>(max, values[i]);
+                    }
+                }
+        };
+
+        uint8_t clamp_quantized(float value)
+        {
+            return (uint8_t) std::min<float>(std::max<float>(nearbyintf(value), 0.0f), QUANTIZED_MAX);
+        }
+    }
+
+    template <typename T>
+    Quantized_network<T>::Quantized_network(
+        const Network<T> &network,
+        const std::vector<Training_data<T>> &calibration) :
+            m_inputs(network.inputs()),
+            m_width(0)
+    {
+        const std::vector<Layer<T>> &layers = network.layers();
+
+        if (calibration.empty())
+        {
+            throw std::invalid_argument("Quantization requires calibration samples");
+        }
+
+        for (size_t i = 1; i < layers.size(); ++i)
+        {
+            if (!layers[i].function()->elementwise())
+            {
+                throw std::invalid_argument("Activation function can not be tabulated");
+            }
+        }
+
+        // Ranges of the network inputs, then of the sums and outputs of each layer.
+        Range inputRange;
+        std::vector<Range> sumRanges(layers.size());
+        std::vector<Range> outputRanges(layers.size());
+        std::vector<T> values;
+        std::vector<T> sums;
+
+        for (const auto &sample : calibration)
+        {
+            assert(sample.inputs.size() == m_inputs);
+
+            values = sample.inputs;
+            inputRange.add(values.data(), values.size());
+
+            for (size_t i = 1; i < layers.size(); ++i)
+            {
+                const Matrix<T> &weights = layers[i].weights();
+
+                sums.resize(layers[i].size());
+
+                for (size_t row = 0; row < weights.rows(); ++row)
+                {
+                    sums[row] = kernels::active<T>().dot(weights.row(row), values.data(), weights.cols());
+                }
+
+                sumRanges[i].add(sums.data(), sums.size());
+
+                values = sums;
+                layers[i].function()->compute_all(values.data(), values.size());
+                outputRanges[i].add(values.data(), values.size());
+            }
+        }
+
+        // Asymmetric quantization of a range, which has to include 0.
+        auto quantization = [](const Range &range) {
+            double min = std::min(range.min, 0.0);
+            double max = std::max(range.max, 0.0);
+            Quantization result;
+
+            result.scale = max > min ? (max - min) / QUANTIZED_MAX : 1.0;
+            result.zero = (int32_t) lround(-min / result.scale);
+
+            return result;
+        };
+
+        m_input = quantization(inputRange);
+        m_width = m_inputs;
+
+        Quantization input = m_input;
+
+        for (size_t i = 1; i < layers.size(); ++i)
+        {
+            const Layer<T> &source = layers[i];
+            const Matrix<T> &weights = source.weights();
+            const bool last = (i + 1 == layers.size());
+            Quantized_layer layer;
+
+            layer.neurons = source.size();
+            layer.inputs = source.inputs();
+            layer.weights.resize(layer.neurons * layer.inputs);
+            layer.scales.resize(layer.neurons);
+            layer.offsets.resize(layer.neurons);
+
+            // Symmetric quantization of each row of weights
+            for (size_t row = 0; row < layer.neurons; ++row)
+            {
+                const T *values = weights.row(row);
+                double largest = 0.0;
+                int32_t sum = 0;
+
+                for (size_t col = 0; col < layer.inputs; ++col)
+                {
+                    largest = std::max<double>(largest, fabs(values[col]));
+                }
+
+                double scale = largest > 0.0 ? largest / QUANTIZED_MAX : 1.0;
+
+                for (size_t col = 0; col < layer.inputs; ++col)
+                {
+                    int8_t quantized = (int8_t) lround(values[col] / scale);
+
+                    layer.weights[row * layer.inputs + col] = quantized;
+                    sum += quantized;
+                }
+
+                layer.scales[row] = input.scale * scale;
+                layer.offsets[row] = input.zero * sum;
+            }
+
+            // Activation tables, over the range of the sums seen during calibration
+            const Range &sums = sumRanges[i];
+            double start = sums.min;
+            double end = sums.max > sums.min ? sums.max : sums.min + 1.0;
+            Quantization output = quantization(outputRanges[i]);
+
+            layer.table_start = start;
+            layer.table_step = (TABLE_SIZE - 1) / (end - start);
+
+            for (size_t entry = 0; entry < TABLE_SIZE; ++entry)
+            {
+                T value = source.function()->compute((T) (start + entry / layer.table_step));
+
+                if (last)
+                {
+                    layer.output_table.push_back(value);
+                }
+                else
+                {
+                    layer.table.push_back(clamp_quantized(value / output.scale + output.zero));
+                }
+            }
+
+            m_width = std::max(m_width, layer.neurons);
+            m_layers.push_back(std::move(layer));
+            input = output;
+        }
+    }
+
+    template <typename T>
+    void Quantized_network<T>::test(Quantized_workspace &workspace, const T *inputs, size_t count, T *outputs) const
+    {
+        const kernels::Int8_table &kernel = kernels::active_int8();
+        const float inverseScale = 1.0f / m_input.scale;
+
+        assert(workspace.inputs.size() >= m_width && workspace.outputs.size() >= m_width);
+
+        for (size_t sample = 0; sample < count; ++sample)
+        {
+            uint8_t *layerInputs = workspace.inputs.data();
+            uint8_t *layerOutputs = workspace.outputs.data();
+
+            for (size_t i = 0; i < m_inputs; ++i)
+            {
+                layerInputs[i] = clamp_quantized(inputs[i] * inverseScale + m_input.zero);
+            }
+
+            for (const auto &layer : m_layers)
+            {
+                const bool last = !layer.output_table.empty();
+
+                for (size_t row = 0; row < layer.neurons; ++row)
+                {
+                    int32_t product = kernel.dot(layerInputs, layer.weights.data() + row * layer.inputs, layer.inputs);
+                    float sum = (product - layer.offsets[row]) * layer.scales[row];
+                    float position = (sum - layer.table_start) * layer.table_step + 0.5f;
+                    size_t entry = (size_t) std::min<float>(std::max<float>(position, 0.0f), TABLE_SIZE - 1);
+
+                    if (last)
+                    {
+                        outputs[row] = layer.output_table[entry];
+                    }
+                    else
+                    {
+                        layerOutputs[row] = layer.table[entry];
+                    }
+                }
+
+                std::swap(layerInputs, layerOutputs);
+            }
+
+            inputs += m_inputs;
+            outputs += m_layers.back().neurons;
+        }
+    }
+
+    template <typename T>
+    Quantized_workspace Quantized_network<T>::create_workspace() const
+    {
+        Quantized_workspace workspace;
+
+        workspace.inputs.assign(m_width, 0);
+        workspace.outputs.assign(m_width, 0);
+
+        return workspace;
+    }
+
+    template <typename T>
+    size_t Quantized_network<T>::inputs() const
+    {
+        return m_inputs;
+    }
+
+    template <typename T>
+    size_t Quantized_network<T>::outputs() const
+    {
+        return m_layers.back().neurons;
+    }
+
+    template <typename T>
+    size_t Quantized_network<T>::weight_bytes() const
+    {
+        size_t bytes = 0;
+
+        for (const auto &layer : m_layers)
+        {
+            bytes += layer.weights.size() * sizeof(int8_t);
+        }
+
+        return bytes;
+    }
+
+    template <typename T>
+    size_t Quantized_network<T>::bytes() const
+    {
+        size_t bytes = sizeof(*this);
+
+        for (const auto &layer : m_layers)
+        {
+            bytes += sizeof(layer) +
+                     layer.weights.size() * sizeof(int8_t) +
+                     layer.scales.size() * sizeof(float) +
+                     layer.offsets.size() * sizeof(int32_t) +
+                     layer.table.size() * sizeof(uint8_t) +
+                     layer.output_table.size() * sizeof(T);
+        }
+
+        return bytes;
+    }
+
+    template class Quantized_network<double>;
+    template class Quantized_network<float>;
+}
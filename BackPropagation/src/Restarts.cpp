@@ -0,0 +1,204 @@
+/*
+ * Restarts.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "Restarts.hpp"
+#include "Thread_pool.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        /** Class Run_progress: checkpoints reached by a run */
+        struct Run_progress
+        {
+                std::vector<double> checkpoints;    ///< Error at each multiple of check_period epochs, infinity once abandoned
+                bool finished = false;              ///< The run ended, no more checkpoint will be reached
+        };
+
+        /** @return the seed of a run, from the seed of the session */
+        std::mt19937::result_type run_seed(std::mt19937::result_type seed, uint32_t run)
+        {
+            std::seed_seq sequence = { (uint32_t) seed, run };
+            uint32_t result;
+
+            sequence.generate(&result, &result + 1);
+            return result;
+        }
+    }
+
+    Restart_settings::Restart_settings(uint32_t runs, std::mt19937::result_type seed) :
+        runs(runs),
+        threads(std::max(1u, std::thread::hardware_concurrency())),
+        seed(seed),
+        check_period(100),
+        abandon_ratio(2.0)
+    {
+        assert(runs >= 1);
+    }
+
+    template <typename T>
+    Network<T> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<T>>> &layers,
+        const Samples<T> &trainingData,
+        const typename Network<T>::Settings &settings,
+        const Restart_settings &restarts,
+        std::vector<Restart_run> *runs)
+    {
+        if (restarts.runs == 0)
+        {
+            throw std::invalid_argument("At least one run is required");
+        }
+
+        std::vector<Restart_run> outcomes(restarts.runs);
+        std::atomic<uint32_t> next(0);
+
+        // Progress of each run. A run is only compared with the runs of lower
+        // index, which started before it, so that which runs are abandoned does
+        // not depend on the threads.
+        std::mutex mutex;
+        std::condition_variable changed;
+        std::vector<Run_progress> progress(restarts.runs);
+
+        // Best network trained by each thread, the best one being picked at the end.
+        Thread_pool pool(std::min(restarts.threads, restarts.runs));
+        std::vector<std::unique_ptr<Network<T>>> best(pool.size());
+        std::vector<uint32_t> bestRun(pool.size());
+
+        // Lower error first, then lower run index, so that the choice does not depend on the threads.
+        auto better = [&](uint32_t run, uint32_t other) {
+            return outcomes[run].error < outcomes[other].error ||
+                (outcomes[run].error == outcomes[other].error && run < other);
+        };
+
+        pool.run([&](size_t thread) {
+            for (uint32_t run = next++; run < restarts.runs; run = next++)
+            {
+                Restart_run &outcome = outcomes[run];
+                typename Network<T>::Settings runSettings = settings;
+
+                outcome.seed = run_seed(restarts.seed, run);
+                outcome.epochs = 0;
+                outcome.abandoned = false;
+
+                // The runs are the parallelism, and only the errors are observed.
+                runSettings.threads = 1;
+                runSettings.timing = false;
+                runSettings.observer = [&](const typename Network<T>::Epoch_report &report) {
+                    outcome.epochs = report.epoch;
+
+                    if (restarts.check_period == 0 || report.epoch % restarts.check_period != 0)
+                    {
+                        return false;
+                    }
+
+                    const size_t checkpoint = report.epoch / restarts.check_period - 1;
+                    double best = std::numeric_limits<double>::infinity();
+                    std::unique_lock<std::mutex> lock(mutex);
+
+                    // Wait for the earlier runs to reach the checkpoint or to end.
+                    for (uint32_t other = 0; other < run; ++other)
+                    {
+                        const Run_progress &earlier = progress[other];
+
+                        changed.wait(lock, [&] { return earlier.finished || earlier.checkpoints.size() > checkpoint; });
+
+                        if (earlier.checkpoints.size() > checkpoint)
+                        {
+                            best = std::min(best, earlier.checkpoints[checkpoint]);
+                        }
+                    }
+
+                    outcome.abandoned = report.error > best * restarts.abandon_ratio;
+                    progress[run].checkpoints.push_back(
+                        outcome.abandoned ? std::numeric_limits<double>::infinity() : report.error);
+                    changed.notify_all();
+
+                    return outcome.abandoned;
+                };
+
+                std::unique_ptr<Network<T>> network(new Network<T>(layers, outcome.seed));
+                outcome.error = network->train(trainingData, runSettings);
+
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    progress[run].finished = true;
+                }
+
+                changed.notify_all();
+
+                if (!best[thread] || better(run, bestRun[thread]))
+                {
+                    best[thread] = std::move(network);
+                    bestRun[thread] = run;
+                }
+            }
+        });
+
+        size_t winner = 0;
+
+        for (size_t thread = 1; thread < best.size(); ++thread)
+        {
+            if (best[thread] && better(bestRun[thread], bestRun[winner]))
+            {
+                winner = thread;
+            }
+        }
+
+        if (runs)
+        {
+            *runs = outcomes;
+        }
+
+        return *best[winner];
+    }
+
+    template <typename T>
+    Network<T> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<T>>> &layers,
+        const std::vector<Training_data<T>> &trainingData,
+        const typename Network<T>::Settings &settings,
+        const Restart_settings &restarts,
+        std::vector<Restart_run> *runs)
+    {
+        return train_restarts(layers, Samples<T>(trainingData), settings, restarts, runs);
+    }
+
+    template Network<double> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<double>>>&,
+        const Samples<double>&,
+        const Network<double>::Settings&,
+        const Restart_settings&,
+        std::vector<Restart_run>*);
+    template Network<double> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<double>>>&,
+        const std::vector<Training_data<double>>&,
+        const Network<double>::Settings&,
+        const Restart_settings&,
+        std::vector<Restart_run>*);
+    template Network<float> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<float>>>&,
+        const Samples<float>&,
+        const Network<float>::Settings&,
+        const Restart_settings&,
+        std::vector<Restart_run>*);
+    template Network<float> train_restarts(
+        const std::vector<std::pair<std::uint32_t, functions::Activation_function_cPtr<float>>>&,
+        const std::vector<Training_data<float>>&,
+        const Network<float>::Settings&,
+        const Restart_settings&,
+        std::vector<Restart_run>*);
+}
@@ -0,0 +1,85 @@
+/*
+ * Samples.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <stdint.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+
+#include "Samples.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        /**
+         * Apply advice to the whole pages of [begin, end), or to all the pages
+         * touched by the range when inclusive is set.
+         */
+        void advise(const void *begin, const void *end, int advice, bool inclusive)
+        {
+            static const uintptr_t pageSize = sysconf(_SC_PAGESIZE);
+
+            uintptr_t first = (uintptr_t) begin;
+            uintptr_t last = (uintptr_t) end;
+
+            if (inclusive)
+            {
+                first = first / pageSize * pageSize;
+                last = (last + pageSize - 1) / pageSize * pageSize;
+            }
+            else
+            {
+                first = (first + pageSize - 1) / pageSize * pageSize;
+                last = last / pageSize * pageSize;
+            }
+
+            if (first < last)
+            {
+                madvise((void*) first, last - first, advice);
+            }
+        }
+    }
+
+    template <typename T>
+    size_t Samples<T>::max_nonzeros() const
+    {
+        size_t nonzeros = 0;
+
+        for (size_t i = 0; m_entries && i < m_count; ++i)
+        {
+            if (const Sparse_inputs<T> *sparse = sparse_inputs(i))
+            {
+                nonzeros = std::max(nonzeros, sparse->indices.size());
+            }
+        }
+
+        return nonzeros;
+    }
+
+    template <typename T>
+    void Samples<T>::prefetch(size_t first, size_t last) const
+    {
+        if (m_mapped && first < last)
+        {
+            advise(inputs(first), inputs(last), MADV_WILLNEED, true);
+        }
+    }
+
+    template <typename T>
+    void Samples<T>::release(size_t first, size_t last) const
+    {
+        // Only the pages holding no other samples, they might be in use.
+        if (m_mapped && first < last)
+        {
+            advise(inputs(first), inputs(last), MADV_DONTNEED, false);
+        }
+    }
+
+    template class Samples<double>;
+    template class Samples<float>;
+}
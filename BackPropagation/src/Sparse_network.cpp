@@ -0,0 +1,213 @@
+/*
+ * Sparse_network.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <assert.h>
+
+#include <algorithm>
+
+#include "Kernels.hpp"
+#include "Sparse_network.hpp"
+
+namespace BackPropagation
+{
+    Pruning_settings::Pruning_settings(double sparsity) :
+        sparsity(sparsity)
+    {
+    }
+
+    template <typename T>
+    Pruning_report prune(
+        Network<T> &network,
+        const Samples<T> &data,
+        const Pruning_settings &pruning,
+        const typename Network<T>::Settings *fineTuning)
+    {
+        Pruning_report report;
+
+        report.error_before = network.evaluate(data);
+
+        if (pruning.layer_sparsities.empty())
+        {
+            network.prune(pruning.sparsity);
+        }
+        else
+        {
+            network.prune(pruning.layer_sparsities);
+        }
+
+        report.error_pruned = network.evaluate(data);
+        report.error_after = report.error_pruned;
+
+        if (fineTuning && fineTuning->max_iterations)
+        {
+            report.error_after = network.train(data, *fineTuning);
+        }
+
+        report.sparsity = network.sparsity();
+        report.dense_bytes = 0;
+
+        for (size_t index = 1; index < network.layers().size(); ++index)
+        {
+            const Layer<T> &layer = network.layers()[index];
+
+            report.layer_sparsities.push_back((double) layer.pruned() / layer.parameters());
+            report.dense_bytes += layer.parameters() * sizeof(T);
+        }
+
+        report.sparse_bytes = Sparse_network<T>(network).weight_bytes();
+
+        return report;
+    }
+
+    template <typename T>
+    Pruning_report prune(
+        Network<T> &network,
+        const std::vector<Training_data<T>> &data,
+        const Pruning_settings &pruning,
+        const typename Network<T>::Settings *fineTuning)
+    {
+        return prune(network, Samples<T>(data), pruning, fineTuning);
+    }
+
+    template <typename T>
+    Sparse_network<T>::Sparse_network(const Network<T> &network, double minSparsity)
+    {
+        for (const auto &layer : network.layers())
+        {
+            const Matrix<T> &weights = layer.weights();
+            const size_t zeros = std::count(weights.data(), weights.data() + weights.size(), T());
+            Sparse_layer sparse;
+
+            sparse.neurons = layer.size();
+            sparse.inputs = layer.inputs();
+            sparse.func = layer.function();
+
+            if (weights.size() == 0 || zeros < minSparsity * weights.size())
+            {
+                sparse.weights.assign(weights.data(), weights.data() + weights.size());
+            }
+            else
+            {
+                // Compressed sparse rows: the non-zero weights of each row, with their column
+                sparse.row_starts.push_back(0);
+
+                for (size_t row = 0; row < weights.rows(); ++row)
+                {
+                    for (size_t col = 0; col < weights.cols(); ++col)
+                    {
+                        if (weights(row, col) != T())
+                        {
+                            sparse.columns.push_back((uint32_t) col);
+                            sparse.weights.push_back(weights(row, col));
+                        }
+                    }
+
+                    sparse.row_starts.push_back((uint32_t) sparse.weights.size());
+                }
+            }
+
+            m_layers.push_back(std::move(sparse));
+        }
+    }
+
+    template <typename T>
+    void Sparse_network<T>::test(Workspace<T> &workspace, const T *inputs, size_t count, T *outputs) const
+    {
+        const kernels::Table<T> &kernel = kernels::active<T>();
+        const size_t inputSize = m_layers[0].neurons;
+        const size_t outputSize = m_layers.back().neurons;
+
+        assert(workspace.layers.size() == m_layers.size());
+
+        for (size_t sample = 0; sample < count; ++sample)
+        {
+            const T *layerInputs = inputs + sample * inputSize;
+
+            for (size_t i = 1; i < m_layers.size(); ++i)
+            {
+                const Sparse_layer &layer = m_layers[i];
+                T *layerOutputs = workspace.layers[i].output.data();
+
+                if (layer.row_starts.empty())
+                {
+                    for (size_t row = 0; row < layer.neurons; ++row)
+                    {
+                        layerOutputs[row] = kernel.dot(layer.weights.data() + row * layer.inputs, layerInputs, layer.inputs);
+                    }
+                }
+                else
+                {
+                    for (size_t row = 0; row < layer.neurons; ++row)
+                    {
+                        const uint32_t first = layer.row_starts[row];
+
+                        layerOutputs[row] = kernel.sparse_dot(
+                            layer.weights.data() + first,
+                            layer.columns.data() + first,
+                            layerInputs,
+                            layer.row_starts[row + 1] - first);
+                    }
+                }
+
+                layer.func->compute_all(layerOutputs, layer.neurons);
+                layerInputs = layerOutputs;
+            }
+
+            std::copy(layerInputs, layerInputs + outputSize, outputs + sample * outputSize);
+        }
+    }
+
+    template <typename T>
+    Workspace<T> Sparse_network<T>::create_workspace() const
+    {
+        std::vector<size_t> sizes;
+
+        for (const auto &layer : m_layers)
+        {
+            sizes.push_back(layer.neurons);
+        }
+
+        return Workspace<T>(sizes);
+    }
+
+    template <typename T>
+    size_t Sparse_network<T>::inputs() const
+    {
+        return m_layers[0].neurons;
+    }
+
+    template <typename T>
+    size_t Sparse_network<T>::outputs() const
+    {
+        return m_layers.back().neurons;
+    }
+
+    template <typename T>
+    size_t Sparse_network<T>::weight_bytes() const
+    {
+        size_t bytes = 0;
+
+        for (const auto &layer : m_layers)
+        {
+            bytes += layer.weights.size() * sizeof(T);
+            bytes += (layer.row_starts.size() + layer.columns.size()) * sizeof(uint32_t);
+        }
+
+        return bytes;
+    }
+
+    template Pruning_report prune(
+        Network<double>&, const Samples<double>&, const Pruning_settings&, const Network<double>::Settings*);
+    template Pruning_report prune(
+        Network<double>&, const std::vector<Training_data<double>>&, const Pruning_settings&, const Network<double>::Settings*);
+    template Pruning_report prune(
+        Network<float>&, const Samples<float>&, const Pruning_settings&, const Network<float>::Settings*);
+    template Pruning_report prune(
+        Network<float>&, const std::vector<Training_data<float>>&, const Pruning_settings&, const Network<float>::Settings*);
+
+    template class Sparse_network<double>;
+    template class Sparse_network<float>;
+}
@@ -0,0 +1,162 @@
+/*
+ * Thread_pool.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include "Thread_pool.hpp"
+
+namespace BackPropagation
+{
+    Thread_pool::Thread_pool(size_t threads) :
+        m_invoke(nullptr), m_task(nullptr), m_generation(0), m_pending(0), m_stop(false)
+    {
+        for (size_t index = 1; index < threads; ++index)
+        {
+            m_threads.emplace_back(&Thread_pool::worker, this, index);
+        }
+    }
+
+    Thread_pool::~Thread_pool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_start.notify_all();
+
+        for (auto &thread : m_threads)
+        {
+            thread.join();
+        }
+    }
+
+    size_t Thread_pool::size() const
+    {
+        return m_threads.size() + 1;
+    }
+
+    void Thread_pool::worker(size_t index)
+    {
+        size_t generation = 0;
+
+        while (true)
+        {
+            void (*invoke)(const void*, size_t);
+            const void *task;
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+                if (m_stop)
+                {
+                    return;
+                }
+
+                generation = m_generation;
+                invoke = m_invoke;
+                task = m_task;
+            }
+
+            invoke(task, index);
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                if (--m_pending == 0)
+                {
+                    m_done.notify_one();
+                }
+            }
+        }
+    }
+
+    void Thread_pool::run(void (*invoke)(const void*, size_t), const void *task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_invoke = invoke;
+            m_task = task;
+            m_pending = m_threads.size();
+            ++m_generation;
+        }
+
+        m_start.notify_all();
+
+        // The caller takes the first share of the work.
+        invoke(task, 0);
+
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [&] { return m_pending == 0; });
+    }
+
+    Background_thread::Background_thread() :
+        m_invoke(nullptr), m_task(nullptr), m_stop(false)
+    {
+    }
+
+    Background_thread::~Background_thread()
+    {
+        if (m_thread.joinable())
+        {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_changed.wait(lock, [&] { return m_task == nullptr; });
+                m_stop = true;
+            }
+
+            m_changed.notify_all();
+            m_thread.join();
+        }
+    }
+
+    void Background_thread::worker()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        while (true)
+        {
+            m_changed.wait(lock, [&] { return m_stop || m_task != nullptr; });
+
+            if (m_stop)
+            {
+                return;
+            }
+
+            lock.unlock();
+            m_invoke(m_task);
+            lock.lock();
+
+            m_task = nullptr;
+            m_changed.notify_all();
+        }
+    }
+
+    void Background_thread::start(void (*invoke)(const void*), const void *task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_invoke = invoke;
+            m_task = task;
+        }
+
+        launch();
+        m_changed.notify_all();
+    }
+
+    void Background_thread::launch()
+    {
+        if (!m_thread.joinable())
+        {
+            m_thread = std::thread(&Background_thread::worker, this);
+        }
+    }
+
+    void Background_thread::wait()
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_changed.wait(lock, [&] { return m_task == nullptr; });
+    }
+}
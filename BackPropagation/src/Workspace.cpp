@@ -0,0 +1,169 @@
+/*
+ * Workspace.cpp
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <algorithm>
+
+#include "Workspace.hpp"
+
+namespace BackPropagation
+{
+    namespace
+    {
+        template <typename T>
+        std::vector<size_t> layer_sizes(const std::vector<Layer<T>> &layers)
+        {
+            std::vector<size_t> sizes;
+
+            for (const auto &layer : layers)
+            {
+                sizes.push_back(layer.size());
+            }
+
+            return sizes;
+        }
+
+        template <typename T>
+        std::vector<size_t> layer_sizes(const std::vector<typename Workspace<T>::Buffers> &layers)
+        {
+            std::vector<size_t> sizes;
+
+            for (const auto &buffers : layers)
+            {
+                sizes.push_back(buffers.output.size());
+            }
+
+            return sizes;
+        }
+    }
+
+    template <typename T>
+    Workspace<T>::Workspace(const std::vector<Layer<T>> &networkLayers, size_t batchSize, bool hugePages) :
+        Workspace(layer_sizes(networkLayers), batchSize, hugePages)
+    {
+    }
+
+    template <typename T>
+    Workspace<T>::Workspace(const std::vector<size_t> &sizes, size_t batchSize, bool hugePages) :
+        layers(sizes.size()),
+        error(0.0),
+        timed(false),
+        forward_time(0.0),
+        backward_time(0.0),
+        steps(0),
+        pending_known(false),
+        batch_size(0),
+        training(false),
+        huge_pages(hugePages)
+    {
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            layers[i].output.resize(sizes[i]);
+        }
+
+        reserve(batchSize);
+    }
+
+    template <typename T>
+    Workspace<T>::Workspace(const Workspace &other) :
+        layers(other.layers.size()),
+        error(other.error),
+        timed(other.timed),
+        forward_time(other.forward_time),
+        backward_time(other.backward_time),
+        steps(other.steps),
+        pending_known(false),
+        batch_size(0),
+        training(false),
+        huge_pages(other.huge_pages)
+    {
+        for (size_t i = 0; i < layers.size(); ++i)
+        {
+            layers[i].output.resize(other.layers[i].output.size());
+        }
+
+        reserve(other.batch_size, other.training, other.pending_inputs.capacity());
+    }
+
+    template <typename T>
+    Workspace<T>& Workspace<T>::operator=(const Workspace &other)
+    {
+        if (&other != this)
+        {
+            *this = Workspace(other);
+        }
+
+        return *this;
+    }
+
+    template <typename T>
+    void Workspace<T>::reserve(size_t batchSize, bool trainingBuffers, size_t nonzeros)
+    {
+        pending_inputs.reserve(nonzeros);
+        sparse_scratch.reserve(4 * nonzeros);
+
+        batchSize = std::max(batchSize, batch_size);
+        trainingBuffers = trainingBuffers || training;
+
+        if (arena && batchSize == batch_size && trainingBuffers == training)
+        {
+            return;
+        }
+
+        const std::vector<size_t> sizes = layer_sizes<T>(layers);
+        const size_t outputs = sizes.back();
+
+        // Plan the arena for all the buffers, the gradients only being needed for batch training.
+        size_t bytes = 0;
+
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            const size_t inputs = i > 0 ? sizes[i - 1] : 0;
+
+            bytes += 2 * Arena::round(sizes[i] * sizeof(T)) + Arena::round(inputs * sizeof(T));
+            bytes += 2 * Arena::round(batchSize * sizes[i] * sizeof(T)) + Arena::round(batchSize * inputs * sizeof(T));
+            bytes += trainingBuffers ? Arena::round(sizes[i] * inputs * sizeof(T)) : 0;
+        }
+
+        bytes += Arena::round(outputs * sizeof(T)) + 2 * Arena::round(batchSize * outputs * sizeof(T));
+
+        std::unique_ptr<Arena> planned(new Arena(bytes, huge_pages));
+        Aligned_allocator<T> allocator(planned.get());
+
+        auto matrix = [&](size_t capacity) {
+            Matrix<T> result(allocator);
+
+            result.reserve(capacity);
+            return result;
+        };
+
+        for (size_t i = 0; i < sizes.size(); ++i)
+        {
+            const size_t inputs = i > 0 ? sizes[i - 1] : 0;
+            Buffers &buffers = layers[i];
+
+            buffers.output = Aligned_vector<T>(sizes[i], T(), allocator);
+            buffers.deltas = Aligned_vector<T>(sizes[i], T(), allocator);
+            buffers.errors = Aligned_vector<T>(inputs, T(), allocator);
+
+            buffers.batch_output = matrix(batchSize * sizes[i]);
+            buffers.batch_deltas = matrix(batchSize * sizes[i]);
+            buffers.batch_errors = matrix(batchSize * inputs);
+            buffers.gradients = matrix(trainingBuffers ? sizes[i] * inputs : 0);
+        }
+
+        output_errors = Aligned_vector<T>(outputs, T(), allocator);
+        batch_targets = matrix(batchSize * outputs);
+        batch_output_errors = matrix(batchSize * outputs);
+
+        // The previous arena goes last, the buffers do not touch it when released.
+        arena = std::move(planned);
+        batch_size = batchSize;
+        training = trainingBuffers;
+    }
+
+    template struct Workspace<double>;
+    template struct Workspace<float>;
+}
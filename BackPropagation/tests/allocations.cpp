@@ -0,0 +1,276 @@
+/*
+ * allocations.cpp
+ *
+ * Checks that training makes no heap allocation after its first epoch,
+ * for every evaluation mode, batch size, thread count and optimizer, with
+ * dense and sparse inputs, and that repeated calls to test() with a
+ * workspace make none. The global
+ * operator new and aligned_alloc are replaced by counting versions.
+ *
+ * Usage: test_allocations
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <malloc.h>
+#include <stdlib.h>
+
+#include <atomic>
+#include <iostream>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Network.hpp"
+#include "functions/Sigmoid.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    std::atomic<size_t> allocations(0);
+
+    void* counted(size_t bytes)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return malloc(bytes ? bytes : 1);
+    }
+
+    void* counted(size_t bytes, std::align_val_t alignment)
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        return memalign((size_t) alignment, bytes ? bytes : 1);
+    }
+
+    void* checked(void *data)
+    {
+        if (!data)
+        {
+            throw std::bad_alloc();
+        }
+
+        return data;
+    }
+}
+
+// Counting replacements of the global allocation functions
+void* operator new(size_t bytes) { return checked(counted(bytes)); }
+void* operator new[](size_t bytes) { return checked(counted(bytes)); }
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return counted(bytes); }
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return counted(bytes); }
+void* operator new(size_t bytes, std::align_val_t alignment) { return checked(counted(bytes, alignment)); }
+void* operator new[](size_t bytes, std::align_val_t alignment) { return checked(counted(bytes, alignment)); }
+void operator delete(void *data) noexcept { free(data); }
+void operator delete[](void *data) noexcept { free(data); }
+void operator delete(void *data, size_t) noexcept { free(data); }
+void operator delete[](void *data, size_t) noexcept { free(data); }
+void operator delete(void *data, std::align_val_t) noexcept { free(data); }
+void operator delete[](void *data, std::align_val_t) noexcept { free(data); }
+void operator delete(void *data, size_t, std::align_val_t) noexcept { free(data); }
+void operator delete[](void *data, size_t, std::align_val_t) noexcept { free(data); }
+
+// The aligned buffers and arenas of the library do not go through operator new
+extern "C" void* aligned_alloc(size_t alignment, size_t bytes)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    return memalign(alignment, bytes);
+}
+
+namespace
+{
+    typedef Network<double>::Settings Settings;
+    typedef Network<double>::Evaluation Evaluation;
+    typedef Network<double>::Parallel_mode Parallel_mode;
+
+    const uint32_t EPOCHS = 5;
+
+    size_t failures = 0;
+
+    std::vector<Training_data<double>> random_samples(size_t count, size_t inputs, size_t outputs, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> distrib(0.0, 1.0);
+        std::vector<Training_data<double>> samples(count);
+
+        for (auto &sample : samples)
+        {
+            for (size_t i = 0; i < inputs; ++i)
+            {
+                sample.inputs.push_back(distrib(rng));
+            }
+            for (size_t i = 0; i < outputs; ++i)
+            {
+                sample.outputs.push_back(distrib(rng));
+            }
+        }
+
+        return samples;
+    }
+
+    /**
+     * @return the samples with sparse inputs, each input kept with a
+     * probability of 1/4, so that the number of non-zero inputs varies.
+     */
+    std::vector<Training_data<double>> sparse_samples(const std::vector<Training_data<double>> &dense, std::mt19937 &rng)
+    {
+        std::bernoulli_distribution kept(0.25);
+        std::vector<Training_data<double>> samples = dense;
+
+        for (auto &sample : samples)
+        {
+            for (double &input : sample.inputs)
+            {
+                input = kept(rng) ? input : 0.0;
+            }
+
+            sample.sparse_inputs = make_sparse(sample.inputs);
+            sample.inputs.clear();
+        }
+
+        return samples;
+    }
+
+    /**
+     * Train for EPOCHS epochs and record a failure if the number of
+     * allocations changed after the first one.
+     */
+    void check(const std::string &name, Settings settings, const std::vector<Training_data<double>> &data,
+               const std::vector<Training_data<double>> *validation = nullptr)
+    {
+        Network<double> network({ 16, 32, 8 }, std::make_shared<functions::Sigmoid<double>>(), 1);
+        size_t afterFirst = 0;
+        size_t afterLast = 0;
+        uint32_t epochs = 0;
+
+        settings.max_iterations = EPOCHS;
+        settings.target_error = 0.0;
+        settings.patience = EPOCHS;
+        settings.observer = [&](const Network<double>::Epoch_report &report)
+        {
+            const size_t count = allocations.load(std::memory_order_relaxed);
+
+            if (report.epoch == 1)
+            {
+                afterFirst = count;
+            }
+
+            afterLast = count;
+            epochs = report.epoch;
+            return false;
+        };
+
+        if (validation)
+        {
+            network.train(data, *validation, settings);
+        }
+        else
+        {
+            network.train(data, settings);
+        }
+
+        if (epochs < 2 || afterLast != afterFirst)
+        {
+            ++failures;
+            std::cerr << name << ": " << afterLast - afterFirst << " allocations after the first of " << epochs << " epochs" << std::endl;
+        }
+    }
+}
+
+int main()
+{
+    std::mt19937 rng(1);
+    const std::vector<Training_data<double>> data = random_samples(256, 16, 8, rng);
+    const std::vector<Training_data<double>> validation = random_samples(64, 16, 8, rng);
+    const std::vector<Training_data<double>> sparse = sparse_samples(data, rng);
+    const std::pair<const char*, Evaluation> evaluations[] = {
+        { "FULL", Evaluation::FULL },
+        { "TRAINING", Evaluation::TRAINING },
+        { "SUBSAMPLE", Evaluation::SUBSAMPLE },
+        { "PERIODIC", Evaluation::PERIODIC },
+        { "PARALLEL", Evaluation::PARALLEL } };
+
+    for (const auto &evaluation : evaluations)
+    {
+        for (uint32_t batchSize : { 1, 8 })
+        {
+            for (uint32_t threads : { 1, 2 })
+            {
+                for (Parallel_mode mode : { Parallel_mode::SYNCHRONOUS, Parallel_mode::HOGWILD })
+                {
+                    for (Optimizer optimizer : { Optimizer::CLASSIC, Optimizer::ADAM })
+                    {
+                        if (threads == 1 && mode == Parallel_mode::HOGWILD)
+                        {
+                            continue;
+                        }
+
+                        Settings settings(EPOCHS, 0.0, 0.99, 1.01, batchSize);
+
+                        settings.evaluation = evaluation.second;
+                        settings.evaluation_samples = 32;
+                        settings.evaluation_period = 2;
+                        settings.threads = threads;
+                        settings.parallel_mode = mode;
+                        settings.optimizer = optimizer;
+
+                        check(std::string(evaluation.first) + " batch " + std::to_string(batchSize) + " threads " +
+                              std::to_string(threads) + (mode == Parallel_mode::HOGWILD ? " hogwild" : "") +
+                              (optimizer == Optimizer::ADAM ? " adam" : ""), settings, data);
+                    }
+                }
+            }
+        }
+    }
+
+    // Sparse inputs, the first layer updating only the weights of the non-zero ones
+    for (uint32_t threads : { 1, 2 })
+    {
+        for (Optimizer optimizer : { Optimizer::CLASSIC, Optimizer::ADAM })
+        {
+            Settings settings(EPOCHS, 0.0, 0.99, 1.01, 1);
+
+            settings.threads = threads;
+            settings.parallel_mode = Parallel_mode::HOGWILD;
+            settings.optimizer = optimizer;
+
+            check(std::string("sparse threads ") + std::to_string(threads) + (optimizer == Optimizer::ADAM ? " adam" : ""),
+                  settings, sparse);
+        }
+    }
+
+    Settings chunked(EPOCHS, 0.0, 0.99, 1.01, 4);
+
+    chunked.chunk_size = 64;
+    check("chunks of 64", chunked, data);
+
+    Settings huge(EPOCHS, 0.0, 0.99, 1.01, 32);
+
+    huge.huge_pages = true;
+    check("huge pages", huge, data);
+
+    Settings validated(EPOCHS, 0.0, 0.99, 1.01, 4);
+
+    check("validation data", validated, data, &validation);
+
+    // Inference with a workspace
+    Network<double> network({ 16, 32, 8 }, std::make_shared<functions::Sigmoid<double>>(), 1);
+    Workspace<double> workspace = network.create_workspace(16);
+    std::vector<double> inputs(16 * 16, 0.5);
+    std::vector<double> outputs(16 * 8);
+    const size_t before = allocations.load();
+
+    for (size_t i = 0; i < 100; ++i)
+    {
+        network.test(workspace, inputs.data(), 16, outputs.data());
+    }
+
+    if (allocations.load() != before)
+    {
+        ++failures;
+        std::cerr << "test(): " << allocations.load() - before << " allocations" << std::endl;
+    }
+
+    std::cout << (failures ? "FAILED" : "ok") << std::endl;
+
+    return failures ? 1 : 0;
+}
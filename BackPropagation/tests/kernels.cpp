@@ -0,0 +1,294 @@
+/*
+ * kernels.cpp
+ *
+ * Checks that every kernel of every instruction set supported by the CPU
+ * matches the scalar one, for both scalar types, over lengths covering
+ * the vector tails and unaligned buffers.
+ *
+ * Usage: test_kernels
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Kernels.hpp"
+
+using namespace BackPropagation;
+using namespace BackPropagation::kernels;
+
+namespace
+{
+    const size_t LENGTHS[] = { 0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 63, 64, 65, 100, 257 };
+
+    size_t failures = 0;
+
+    /** @return the relative tolerance of the comparisons with the scalar kernels */
+    template <typename T>
+    T tolerance()
+    {
+        return sizeof(T) == sizeof(double) ? 1e-12 : 2e-5;
+    }
+
+    /** Class Checker: compares the kernels of one table with the scalar ones */
+    template <typename T>
+    class Checker
+    {
+        private:
+            const Table<T> &m_table;    ///< Kernels checked
+            const Table<T> &m_scalar;   ///< Reference kernels
+            std::mt19937 m_rng;         ///< Test data generator
+
+            /**
+             * Record a failure if actual differs from expected by more than the
+             * tolerance, relative to scale.
+             */
+            void check(const std::string &kernel, size_t count, size_t i, T actual, T expected, T scale)
+            {
+                if (std::fabs(actual - expected) <= tolerance<T>() * std::max(T(1), scale))
+                {
+                    return;
+                }
+
+                if (failures++ < 20)
+                {
+                    std::cerr << m_table.name << " " << kernel << "<" << (sizeof(T) == sizeof(double) ? "double" : "float") << ">"
+                              << " count " << count << " index " << i << ": " << actual << " instead of " << expected << std::endl;
+                }
+            }
+
+            void check(const std::string &kernel, size_t count, const std::vector<T> &actual, const std::vector<T> &expected)
+            {
+                for (size_t i = 0; i < actual.size(); ++i)
+                {
+                    check(kernel, count, i, actual[i], expected[i], std::fabs(expected[i]));
+                }
+            }
+
+            /**
+             * @return count random values in [low, high), after one padding value
+             * so that the data is not aligned.
+             */
+            std::vector<T> random(size_t count, T low = -1, T high = 1)
+            {
+                std::uniform_real_distribution<T> distrib(low, high);
+                std::vector<T> values(count + 1);
+
+                for (T &value : values)
+                {
+                    value = distrib(m_rng);
+                }
+
+                return values;
+            }
+
+            void check_reductions(size_t count)
+            {
+                std::vector<T> x0 = random(count), x1 = random(count), x2 = random(count), x3 = random(count), y = random(count);
+                std::vector<uint32_t> columns(count);
+                std::uniform_int_distribution<uint32_t> column(0, count ? count - 1 : 0);
+                T magnitude = 0;
+                T sparseMagnitude = 0;
+
+                for (size_t i = 0; i < count; ++i)
+                {
+                    columns[i] = column(m_rng);
+                    magnitude += std::fabs(x0[i + 1] * y[i + 1]);
+                    sparseMagnitude += std::fabs(x0[i + 1] * y[columns[i] + 1]);
+                }
+
+                check("dot", count, 0, m_table.dot(&x0[1], &y[1], count), m_scalar.dot(&x0[1], &y[1], count), magnitude);
+                check("sparse_dot", count, 0, m_table.sparse_dot(&x0[1], columns.data(), &y[1], count),
+                      m_scalar.sparse_dot(&x0[1], columns.data(), &y[1], count), sparseMagnitude);
+
+                T actual[4], expected[4];
+
+                m_table.dot4(&x0[1], &x1[1], &x2[1], &x3[1], &y[1], count, actual);
+                m_scalar.dot4(&x0[1], &x1[1], &x2[1], &x3[1], &y[1], count, expected);
+
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    check("dot4", count, j, actual[j], expected[j], T(count));
+                }
+            }
+
+            void check_updates(size_t count)
+            {
+                const std::vector<T> x = random(count);
+                const T alpha = 0.37;
+                std::vector<T> y = random(count), expectedY = y;
+
+                m_table.axpy(alpha, &x[1], &y[1], count);
+                m_scalar.axpy(alpha, &x[1], &expectedY[1], count);
+                check("axpy", count, y, expectedY);
+
+                std::vector<T> weights = random(count), momentums = random(count, -0.1, 0.1), errors = random(count);
+                std::vector<T> expectedWeights = weights, expectedMomentums = momentums, expectedErrors = errors;
+
+                m_table.adjust(alpha, &x[1], &weights[1], &momentums[1], &errors[1], count);
+                m_scalar.adjust(alpha, &x[1], &expectedWeights[1], &expectedMomentums[1], &expectedErrors[1], count);
+                check("adjust", count, weights, expectedWeights);
+                check("adjust", count, momentums, expectedMomentums);
+                check("adjust", count, errors, expectedErrors);
+
+                m_table.apply(alpha, &x[1], &weights[1], &momentums[1], count);
+                m_scalar.apply(alpha, &x[1], &expectedWeights[1], &expectedMomentums[1], count);
+                check("apply", count, weights, expectedWeights);
+                check("apply", count, momentums, expectedMomentums);
+            }
+
+            void check_optimizer(const std::string &kernel, typename Table<T>::Optimizer_kernel tested,
+                                 typename Table<T>::Optimizer_kernel reference, size_t count)
+            {
+                const Step<T> step = { T(0.01), T(0.9), T(0.999), T(1e-8) };
+                const std::vector<T> gradients = random(count);
+
+                // Batch updates, then per-sample updates which also accumulate the errors
+                for (bool perSample : { false, true })
+                {
+                    std::vector<T> weights = random(count), first = random(count, -0.1, 0.1), second = random(count, 0, 0.1);
+                    std::vector<T> errors = random(count);
+                    std::vector<T> expectedWeights = weights, expectedFirst = first, expectedSecond = second, expectedErrors = errors;
+
+                    tested(step, T(0.5), &gradients[1], &weights[1], &first[1], &second[1], perSample ? &errors[1] : nullptr, count);
+                    reference(step, T(0.5), &gradients[1], &expectedWeights[1], &expectedFirst[1], &expectedSecond[1],
+                              perSample ? &expectedErrors[1] : nullptr, count);
+
+                    check(kernel, count, weights, expectedWeights);
+                    check(kernel, count, first, expectedFirst);
+                    check(kernel, count, second, expectedSecond);
+                    check(kernel, count, errors, expectedErrors);
+                }
+            }
+
+            void check_masked(const std::string &kernel, typename Table<T>::Masked_kernel tested,
+                              typename Table<T>::Masked_kernel reference, size_t count)
+            {
+                const Step<T> step = { T(0.01), T(0.9), T(0.999), T(1e-8) };
+                const std::vector<T> gradients = random(count);
+                std::vector<uint8_t> mask(count + 1);
+                std::bernoulli_distribution kept(0.5);
+
+                for (uint8_t &value : mask)
+                {
+                    value = kept(m_rng);
+                }
+
+                for (bool perSample : { false, true })
+                {
+                    std::vector<T> weights = random(count), first = random(count, -0.1, 0.1), second = random(count, 0, 0.1);
+                    std::vector<T> errors = random(count);
+
+                    // The pruned weights and their state are 0 before the update
+                    for (size_t i = 1; i <= count; ++i)
+                    {
+                        weights[i] *= mask[i];
+                        first[i] *= mask[i];
+                        second[i] *= mask[i];
+                    }
+
+                    std::vector<T> expectedWeights = weights, expectedFirst = first, expectedSecond = second, expectedErrors = errors;
+
+                    tested(step, T(0.5), &gradients[1], &mask[1], &weights[1], &first[1], &second[1], perSample ? &errors[1] : nullptr, count);
+                    reference(step, T(0.5), &gradients[1], &mask[1], &expectedWeights[1], &expectedFirst[1], &expectedSecond[1],
+                              perSample ? &expectedErrors[1] : nullptr, count);
+
+                    check(kernel, count, weights, expectedWeights);
+                    check(kernel, count, first, expectedFirst);
+                    check(kernel, count, second, expectedSecond);
+                    check(kernel, count, errors, expectedErrors);
+
+                    for (size_t i = 1; i <= count; ++i)
+                    {
+                        if (!mask[i])
+                        {
+                            check(kernel + " pruned", count, i - 1, std::fabs(weights[i]) + std::fabs(first[i]) + std::fabs(second[i]), T(), T());
+                        }
+                    }
+                }
+            }
+
+            void check_activation(const std::string &kernel, void (*tested)(T*, size_t), void (*reference)(T*, size_t), size_t count)
+            {
+                // Wide enough to reach the clamped arguments
+                std::vector<T> values = random(count, -100, 100), expected = values;
+
+                tested(&values[1], count);
+                reference(&expected[1], count);
+                check(kernel, count, values, expected);
+            }
+
+            void check_exp_sum(size_t count)
+            {
+                std::vector<T> values = random(count, -50, 10), expected = values;
+                const T shift = 10;
+                const T sum = m_table.fast_exp_sum(&values[1], shift, count);
+                const T expectedSum = m_scalar.fast_exp_sum(&expected[1], shift, count);
+
+                check("fast_exp_sum", count, values, expected);
+                check("fast_exp_sum", count, 0, sum, expectedSum, std::fabs(expectedSum));
+            }
+
+            // Construction
+        public:
+            /**
+             * @param[in] table Kernels to check against the scalar ones.
+             */
+            explicit Checker(const Table<T> &table) :
+                m_table(table),
+                m_scalar(scalar_table<T>()),
+                m_rng(1)
+            {
+            }
+
+            // Methods
+        public:
+            void run()
+            {
+                for (size_t count : LENGTHS)
+                {
+                    check_reductions(count);
+                    check_updates(count);
+                    check_optimizer("sgd", m_table.sgd, m_scalar.sgd, count);
+                    check_optimizer("nesterov", m_table.nesterov, m_scalar.nesterov, count);
+                    check_optimizer("rmsprop", m_table.rmsprop, m_scalar.rmsprop, count);
+                    check_optimizer("adam", m_table.adam, m_scalar.adam, count);
+                    check_masked("masked classic", m_table.masked.classic, m_scalar.masked.classic, count);
+                    check_masked("masked sgd", m_table.masked.sgd, m_scalar.masked.sgd, count);
+                    check_masked("masked nesterov", m_table.masked.nesterov, m_scalar.masked.nesterov, count);
+                    check_masked("masked rmsprop", m_table.masked.rmsprop, m_scalar.masked.rmsprop, count);
+                    check_masked("masked adam", m_table.masked.adam, m_scalar.masked.adam, count);
+                    check_activation("fast_sigmoid", m_table.fast_sigmoid, m_scalar.fast_sigmoid, count);
+                    check_activation("fast_tanh", m_table.fast_tanh, m_scalar.fast_tanh, count);
+                    check_activation("fast_softplus", m_table.fast_softplus, m_scalar.fast_softplus, count);
+                    check_exp_sum(count);
+                }
+            }
+    };
+}
+
+int main()
+{
+    for (Isa isa : { Isa::SSE2, Isa::AVX2, Isa::AVX512 })
+    {
+        if (!supported(isa))
+        {
+            std::cout << get<double>(isa).name << ": not supported, skipped" << std::endl;
+            continue;
+        }
+
+        const size_t before = failures;
+
+        Checker<double>(get<double>(isa)).run();
+        Checker<float>(get<float>(isa)).run();
+
+        std::cout << get<double>(isa).name << ": " << (failures == before ? "ok" : "FAILED") << std::endl;
+    }
+
+    return failures ? 1 : 0;
+}
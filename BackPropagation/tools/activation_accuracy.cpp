@@ -0,0 +1,159 @@
+/*
+ * activation_accuracy.cpp
+ *
+ * Compares the fast activation functions with the exact ones: largest
+ * error over a range of sums, throughput of compute_all(), and training
+ * of the demo network with each of them.
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <math.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "Kernels.hpp"
+#include "Network.hpp"
+#include "functions/Leaky_relu.hpp"
+#include "functions/Relu.hpp"
+#include "functions/Sigmoid.hpp"
+#include "functions/Softmax.hpp"
+#include "functions/Softplus.hpp"
+#include "functions/Tanh.hpp"
+
+using namespace BackPropagation;
+using functions::Precision;
+
+namespace
+{
+    std::vector<Training_data<>> train_data = {
+        { { 0, 0, 0, 0 }, { 1, 1, 1, 1 }, {} },
+        { { 0, 0, 0, 1 }, { 1, 1, 1, 0 }, {} },
+        { { 0, 0, 1, 0 }, { 1, 1, 0, 1 }, {} },
+        { { 0, 0, 1, 1 }, { 1, 1, 0, 0 }, {} },
+        { { 0, 1, 0, 0 }, { 1, 0, 1, 1 }, {} },
+        { { 0, 1, 0, 1 }, { 1, 0, 1, 0 }, {} },
+        { { 0, 1, 1, 0 }, { 1, 0, 0, 1 }, {} },
+        { { 0, 1, 1, 1 }, { 1, 0, 0, 0 }, {} },
+        { { 1, 0, 0, 0 }, { 0, 1, 1, 1 }, {} },
+        { { 1, 0, 0, 1 }, { 0, 1, 1, 0 }, {} },
+        { { 1, 0, 1, 0 }, { 0, 1, 0, 1 }, {} },
+        { { 1, 0, 1, 1 }, { 0, 1, 0, 0 }, {} },
+        { { 1, 1, 0, 0 }, { 0, 0, 1, 1 }, {} },
+        { { 1, 1, 0, 1 }, { 0, 0, 1, 0 }, {} },
+        { { 1, 1, 1, 0 }, { 0, 0, 0, 1 }, {} },
+        { { 1, 1, 1, 1 }, { 0, 0, 0, 0 }, {} }
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @return the largest time of compute_all() over a few runs on a copy of
+     * the values, in nanoseconds per value.
+     */
+    template <typename T>
+    double time_per_value(const functions::Activation_function<T> &func, const std::vector<T> &values)
+    {
+        std::vector<T> copy;
+        double best = 1e30;
+
+        for (size_t run = 0; run < 5; ++run)
+        {
+            copy = values;
+
+            auto start = std::chrono::steady_clock::now();
+            func.compute_all(copy.data(), copy.size());
+            best = std::min(best, seconds_since(start));
+        }
+
+        return 1e9 * best / values.size();
+    }
+
+    /**
+     * Print the largest error of the fast function, absolute up to 1 and
+     * relative beyond, and the speed of both functions.
+     */
+    template <typename T>
+    void compare(const functions::Activation_function<T> &exact, const functions::Activation_function<T> &fast,
+                 T min, T max)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<T> distrib(min, max);
+        std::vector<T> values(1 << 20);
+
+        for (auto &value : values)
+        {
+            value = distrib(rng);
+        }
+
+        std::vector<T> expected = values;
+        std::vector<T> actual = values;
+        double maxError = 0.0;
+
+        exact.compute_all(expected.data(), expected.size());
+        fast.compute_all(actual.data(), actual.size());
+
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            maxError = std::max(maxError, fabs((double) expected[i] - actual[i]) / std::max(1.0, fabs((double) expected[i])));
+        }
+
+        double exactTime = time_per_value(exact, values);
+        double fastTime = time_per_value(fast, values);
+
+        std::cout << "\t" << fast.name() << ": max error " << maxError << ", " << exactTime << " ns exact, "
+                  << fastTime << " ns fast (x" << exactTime / fastTime << ")" << std::endl;
+    }
+
+    /** compare() for each function with a fast mode */
+    template <typename T>
+    void compare_all()
+    {
+        compare<T>(functions::Sigmoid<T>(), functions::Sigmoid<T, Precision::FAST>(), -40, 40);
+        compare<T>(functions::Tanh<T>(), functions::Tanh<T, Precision::FAST>(), -20, 20);
+        compare<T>(functions::Softplus<T>(), functions::Softplus<T, Precision::FAST>(), -40, 40);
+        compare<T>(functions::Softmax<T>(), functions::Softmax<T, Precision::FAST>(), -20, 20);
+    }
+
+    /**
+     * Train the demo network with the activation function, and print its
+     * error after the training.
+     */
+    void train(const functions::Activation_function_cPtr<> &func)
+    {
+        Network<> net({ 4, 8, 4 }, func, 1);
+        Network<>::Settings settings(10000, 0.01, 0.99, 1);
+
+        settings.optimizer = Optimizer::ADAM;
+
+        auto start = std::chrono::steady_clock::now();
+        double error = net.train(train_data, settings);
+
+        std::cout << "\t" << func->name() << ": error " << error << " after " << seconds_since(start) << " s"
+                  << std::endl;
+    }
+}
+
+int main()
+{
+    std::cout << "Kernels: " << kernels::active<double>().name << std::endl;
+    std::cout << "double" << std::endl;
+    compare_all<double>();
+    std::cout << "float" << std::endl;
+    compare_all<float>();
+
+    std::cout << "Training the 4-8-4 demo network" << std::endl;
+
+    for (const char *name : { "sigmoid", "sigmoid_fast", "tanh", "tanh_fast", "softplus", "softplus_fast",
+                              "relu", "leaky_relu" })
+    {
+        train(functions::create<double>(name));
+    }
+
+    return 0;
+}
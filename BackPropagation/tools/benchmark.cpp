@@ -0,0 +1,371 @@
+/*
+ * benchmark.cpp
+ *
+ * Microbenchmarks of the main operations of the library, over a sweep of
+ * layer widths and data set sizes.
+ *
+ * Usage: benchmark [--quick] [--min-time seconds] [--json file]
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "Kernels.hpp"
+#include "Layer.hpp"
+#include "Network.hpp"
+#include "Static_network.hpp"
+#include "functions/Sigmoid.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    /** Class Options: command line settings */
+    struct Options
+    {
+            double min_time = 0.2;  ///< Minimum duration of each measurement, in seconds
+            bool quick = false;     ///< Smaller sweeps, for a quick check
+            std::string json;       ///< File the results are written to, none if empty
+    };
+
+    /** Class Result: one measurement */
+    struct Result
+    {
+            std::string name;       ///< Operation
+            const char *scalar;     ///< Scalar type
+            size_t width;           ///< Layer width
+            size_t samples;         ///< Data set size, or batch size
+            size_t repetitions;     ///< Number of times the operation was run
+            double seconds;         ///< Total duration
+            double samples_per_op;  ///< Samples processed by one operation
+            double flops_per_op;    ///< Floating point operations of one operation
+
+            double ns_per_op() const
+            {
+                return seconds * 1e9 / repetitions;
+            }
+
+            double samples_per_second() const
+            {
+                return samples_per_op * repetitions / seconds;
+            }
+
+            double gflops() const
+            {
+                return flops_per_op * repetitions / seconds * 1e-9;
+            }
+    };
+
+    Options options;
+    std::vector<Result> results;
+
+    template <typename T>
+    const char* scalar_name()
+    {
+        return sizeof(T) == sizeof(double) ? "double" : "float";
+    }
+
+    /**
+     * Run an operation until it took at least options.min_time, doubling
+     * the number of repetitions, and record the result.
+     */
+    template <typename T>
+    void measure(
+        const std::string &name,
+        size_t width,
+        size_t samples,
+        double samplesPerOp,
+        double flopsPerOp,
+        const std::function<void()> &operation)
+    {
+        // Warm up the caches, and fault in the memory.
+        operation();
+
+        size_t repetitions = 1;
+        double seconds = 0.0;
+
+        for (;;)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                operation();
+            }
+
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (seconds >= options.min_time)
+            {
+                break;
+            }
+
+            repetitions *= seconds > 0.0 ? std::min(100.0, std::max(2.0, 1.2 * options.min_time / seconds)) : 100;
+        }
+
+        Result result = { name, scalar_name<T>(), width, samples, repetitions, seconds, samplesPerOp, flopsPerOp };
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(34) << name << std::setw(8) << result.scalar
+                  << std::right << std::setw(6) << width << std::setw(9) << samples
+                  << std::setw(16) << std::fixed << std::setprecision(1) << result.ns_per_op()
+                  << std::setw(16) << std::setprecision(0) << result.samples_per_second()
+                  << std::setw(10) << std::setprecision(2) << result.gflops() << std::endl;
+    }
+
+    template <typename T>
+    std::vector<Training_data<T>> random_data(size_t count, size_t inputs, size_t outputs, std::mt19937 &rng)
+    {
+        std::uniform_real_distribution<double> distrib(0.0, 1.0);
+        std::vector<Training_data<T>> data(count);
+
+        for (auto &sample : data)
+        {
+            for (size_t i = 0; i < inputs; ++i)
+            {
+                sample.inputs.push_back(distrib(rng));
+            }
+            for (size_t i = 0; i < outputs; ++i)
+            {
+                sample.outputs.push_back(distrib(rng) < 0.5 ? 0 : 1);
+            }
+        }
+
+        return data;
+    }
+
+    /** Layer::propagate and Layer::back_propagate, width inputs x width neurons */
+    template <typename T>
+    void benchmark_layer(size_t width)
+    {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> distrib(0.0, 1.0);
+        functions::Activation_function_cPtr<T> sigmoid(new functions::Sigmoid<T>());
+        Layer<T> layer(width, width, sigmoid, rng);
+
+        std::vector<T> inputs(width), outputs(width), errors(width), deltas(width), inputErrors(width);
+
+        for (size_t i = 0; i < width; ++i)
+        {
+            inputs[i] = distrib(rng);
+            errors[i] = (distrib(rng) - 0.5) * 1e-6;
+        }
+
+        const double weights = (double) width * width;
+
+        measure<T>("Layer::propagate", width, 1, 1, 2 * weights, [&] {
+            layer.propagate(inputs.data(), outputs.data());
+        });
+
+        // momentum = input * delta, weight += momentum + previous, error += weight * delta
+        measure<T>("Layer::back_propagate", width, 1, 1, 5 * weights, [&] {
+            layer.back_propagate(inputs.data(), outputs.data(), errors.data(), deltas.data(), inputErrors.data());
+        });
+    }
+
+    /**
+     * Network::test, Network::iterate and Network::train on a network of
+     * three layers of the given width.
+     */
+    template <typename T>
+    void benchmark_network(size_t width, size_t samples)
+    {
+        std::mt19937 rng(1);
+        functions::Activation_function_cPtr<T> sigmoid(new functions::Sigmoid<T>());
+        Network<T> net({ (uint32_t) width, (uint32_t) width, (uint32_t) width }, sigmoid, 1);
+        std::vector<Training_data<T>> data = random_data<T>(samples, width, width, rng);
+
+        double weights = 0.0;
+
+        for (const auto &layer : net.layers())
+        {
+            weights += layer.parameters();
+        }
+
+        // Inference, sample by sample and in batches
+        Workspace<T> workspace = net.create_workspace(samples);
+        std::vector<T> inputs(samples * width), outputs(samples * width);
+
+        for (size_t i = 0; i < samples; ++i)
+        {
+            std::copy(data[i].inputs.begin(), data[i].inputs.end(), inputs.begin() + i * width);
+        }
+
+        measure<T>("Network::test", width, 1, 1, 2 * weights, [&] {
+            net.test(data[0].inputs);
+        });
+
+        measure<T>("Network::test (batch)", width, samples, samples, 2 * weights * samples, [&] {
+            net.test(workspace, inputs.data(), samples, outputs.data());
+        });
+
+        // A single epoch, without any evaluation, is one call to the private Network::iterate.
+        typename Network<T>::Settings iterate(1, 0.0, 1.0, 1.0);
+        iterate.evaluation = Network<T>::Evaluation::TRAINING;
+
+        measure<T>("Network::iterate", width, samples, samples, 7 * weights * samples, [&] {
+            net.train(data, iterate);
+        });
+
+        // Forward 2, deltas * W 2, transpose(deltas) * inputs 2, per sample and weight
+        typename Network<T>::Settings batches(1, 0.0, 1.0, 1.0, 32);
+        batches.evaluation = Network<T>::Evaluation::TRAINING;
+
+        measure<T>("Network::iterate (batch 32)", width, samples, samples, 6 * weights * samples, [&] {
+            net.train(data, batches);
+        });
+
+        // Three epochs, each one followed by a full evaluation
+        typename Network<T>::Settings train(3, 0.0, 1.0, 1.0);
+
+        measure<T>("Network::train (3 epochs)", width, samples, 3 * samples, 3 * 9 * weights * samples, [&] {
+            net.train(data, train);
+        });
+    }
+
+    /**
+     * Single-sample inference and training of the 4-8-4 network of main.cpp,
+     * with Network and with Static_network.
+     */
+    template <typename T>
+    void benchmark_tiny()
+    {
+        std::mt19937 rng(1);
+        functions::Activation_function_cPtr<T> sigmoid(new functions::Sigmoid<T>());
+        Network<T> net({ 4, 8, 4 }, sigmoid, 1);
+        Static_network<T, functions::Sigmoid<T>, 4, 8, 4> tiny(net);
+        std::vector<Training_data<T>> data = random_data<T>(16, 4, 4, rng);
+
+        const double weights = 4 * 8 + 8 * 4;
+        std::vector<T> outputs(4);
+        size_t index = 0;
+
+        measure<T>("Network::test (4-8-4)", 8, 1, 1, 2 * weights, [&] {
+            net.test(data[index].inputs);
+            index = (index + 1) % data.size();
+        });
+
+        measure<T>("Static_network::test (4-8-4)", 8, 1, 1, 2 * weights, [&] {
+            tiny.test(data[index].inputs.data(), outputs.data());
+            index = (index + 1) % data.size();
+        });
+
+        measure<T>("Static_network::train (4-8-4)", 8, 1, 1, 7 * weights, [&] {
+            tiny.train(data[index].inputs.data(), data[index].outputs.data());
+            index = (index + 1) % data.size();
+        });
+    }
+
+    void write_json(const std::string &path)
+    {
+        std::ofstream file(path);
+
+        file << "{\n  \"engine\": \"BackPropagation\",\n";
+        file << "  \"isa\": \"" << kernels::active<double>().name << "\",\n";
+        file << "  \"min_time\": " << options.min_time << ",\n";
+        file << "  \"results\": [\n";
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &result = results[i];
+
+            file << "    { \"name\": \"" << result.name << "\""
+                 << ", \"scalar\": \"" << result.scalar << "\""
+                 << ", \"width\": " << result.width
+                 << ", \"samples\": " << result.samples
+                 << ", \"repetitions\": " << result.repetitions
+                 << ", \"ns_per_op\": " << result.ns_per_op()
+                 << ", \"samples_per_s\": " << result.samples_per_second()
+                 << ", \"gflops\": " << result.gflops()
+                 << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+
+        file << "  ]\n}\n";
+
+        if (!file)
+        {
+            std::cerr << "Can not write " << path << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--quick"))
+        {
+            options.quick = true;
+            options.min_time = 0.05;
+        }
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+        {
+            options.min_time = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+        {
+            options.json = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--quick] [--min-time seconds] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << "Kernels: " << kernels::active<double>().name << std::endl;
+    std::cout << std::left << std::setw(34) << "Operation" << std::setw(8) << "Scalar"
+              << std::right << std::setw(6) << "Width" << std::setw(9) << "Samples"
+              << std::setw(16) << "ns/op" << std::setw(16) << "samples/s" << std::setw(10) << "GFLOP/s" << std::endl;
+
+    const std::vector<size_t> layerWidths = options.quick ?
+        std::vector<size_t>{ 8, 64, 512 } :
+        std::vector<size_t>{ 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 };
+
+    for (size_t width : layerWidths)
+    {
+        benchmark_layer<double>(width);
+        benchmark_layer<float>(width);
+    }
+
+    benchmark_tiny<double>();
+    benchmark_tiny<float>();
+
+    // Networks of three layers of the same width, on 256 samples
+    const std::vector<size_t> networkWidths = options.quick ?
+        std::vector<size_t>{ 8, 64 } :
+        std::vector<size_t>{ 8, 32, 128, 512, 1024 };
+
+    for (size_t width : networkWidths)
+    {
+        benchmark_network<double>(width, 256);
+        benchmark_network<float>(width, 256);
+    }
+
+    // Data set sizes, on a small network
+    const std::vector<size_t> sizes = options.quick ?
+        std::vector<size_t>{ 16, 4096 } :
+        std::vector<size_t>{ 16, 256, 4096, 65536, 1048576 };
+
+    for (size_t samples : sizes)
+    {
+        benchmark_network<double>(16, samples);
+    }
+
+    if (!options.json.empty())
+    {
+        write_json(options.json);
+    }
+
+    return 0;
+}
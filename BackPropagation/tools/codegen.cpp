@@ -0,0 +1,110 @@
+/*
+ * codegen.cpp
+ *
+ * Compiles a model file written by save_model() into a C++ header with no
+ * dependency on the library, see generate_code().
+ *
+ * Usage: codegen model [--name namespace] [--output file]
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <string.h>
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "Code_generator.hpp"
+#include "Model_file.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    /** Class Options: command line settings */
+    struct Options
+    {
+            std::string model;              ///< Model file to compile
+            std::string name = "network";   ///< Namespace of the generated code
+            std::string output;             ///< Header to write, standard output if empty
+    };
+
+    template <typename T>
+    void generate(const Options &options)
+    {
+        Mapped_network<T> network(options.model);
+
+        if (options.output.empty())
+        {
+            generate_code(network, std::cout, options.name);
+            return;
+        }
+
+        std::ofstream file(options.output);
+
+        generate_code(network, file, options.name);
+        file.close();
+
+        if (!file)
+        {
+            throw std::runtime_error("Can not write " + options.output);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    bool valid = true;
+
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        if (!strcmp(argv[i], "--name") && i + 1 < argc)
+        {
+            options.name = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--output") && i + 1 < argc)
+        {
+            options.output = argv[++i];
+        }
+        else if (argv[i][0] != '-' && options.model.empty())
+        {
+            options.model = argv[i];
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid || options.model.empty())
+    {
+        std::cerr << "Usage: " << argv[0] << " model [--name namespace] [--output file]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        model::Header header = {};
+        std::ifstream file(options.model, std::ios::binary);
+
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if (header.scalar_size == sizeof(float))
+        {
+            generate<float>(options);
+        }
+        else
+        {
+            generate<double>(options);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,235 @@
+/*
+ * load_generator.cpp
+ *
+ * Load generator for the serve tool: concurrent connections each sending
+ * requests of random samples back to back, reporting the throughput and
+ * the latencies seen by the clients, then the counters of the server.
+ * --write-model writes a random network to serve instead.
+ *
+ * Usage: load_generator [--socket path | --port n] [--connections n]
+ *                       [--duration seconds] [--samples n]
+ *        load_generator --write-model path [--layers n,n,...]
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#include "Inference_server.hpp"
+#include "Model_file.hpp"
+#include "Network.hpp"
+#include "functions/Sigmoid.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /** Class Options: command line settings */
+    struct Options
+    {
+            std::string socket_path;                              ///< Server socket, TCP if empty
+            uint16_t port = serving::DEFAULT_PORT;                ///< Server TCP port
+            size_t connections = 16;                              ///< Concurrent clients
+            double duration = 5.0;                                ///< Seconds of load
+            size_t samples = 1;                                   ///< Samples per request
+            std::string model;                                    ///< Model file to write, none if empty
+            std::vector<uint32_t> layers = { 256, 512, 512, 10 }; ///< Topology of the written model
+    };
+
+    /** Load generated by one connection */
+    template <typename T>
+    void generate(const Options &options, size_t index, std::vector<float> &latencies)
+    try
+    {
+        std::unique_ptr<Inference_client<T>> client(options.socket_path.empty() ?
+                                                    new Inference_client<T>(options.port) :
+                                                    new Inference_client<T>(options.socket_path));
+        std::mt19937 rng(index);
+        std::uniform_real_distribution<T> distrib(0, 1);
+        std::vector<T> inputs(options.samples * client->inputs());
+        std::vector<T> outputs(options.samples * client->outputs());
+
+        for (auto &input : inputs)
+        {
+            input = distrib(rng);
+        }
+
+        const Clock::time_point end = Clock::now() + std::chrono::microseconds((int64_t) (options.duration * 1e6));
+
+        while (Clock::now() < end)
+        {
+            Clock::time_point start = Clock::now();
+
+            client->test(inputs.data(), options.samples, outputs.data());
+            latencies.push_back(std::chrono::duration<float, std::micro>(Clock::now() - start).count());
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Connection " << index << ": " << e.what() << std::endl;
+    }
+
+    /**
+     * Run the connections and print what they measured.
+     * Throws std::invalid_argument if the server uses another scalar type.
+     */
+    template <typename T>
+    void run(const Options &options)
+    {
+        // Fails early on another scalar type
+        std::unique_ptr<Inference_client<T>> probe(options.socket_path.empty() ?
+                                                   new Inference_client<T>(options.port) :
+                                                   new Inference_client<T>(options.socket_path));
+        serving::Stats before = probe->stats();
+
+        std::vector<std::vector<float>> latencies(options.connections);
+        std::vector<std::thread> threads;
+
+        for (size_t i = 0; i < options.connections; ++i)
+        {
+            threads.emplace_back(generate<T>, std::cref(options), i, std::ref(latencies[i]));
+        }
+        for (auto &thread : threads)
+        {
+            thread.join();
+        }
+
+        serving::Stats after = probe->stats();
+        std::vector<float> all;
+
+        for (const auto &connection : latencies)
+        {
+            all.insert(all.end(), connection.begin(), connection.end());
+        }
+
+        std::sort(all.begin(), all.end());
+
+        if (all.empty())
+        {
+            std::cout << "No request answered" << std::endl;
+            return;
+        }
+
+        auto percentile = [&all](double p) {
+            return all[(size_t) (p * (all.size() - 1))];
+        };
+
+        const uint64_t batches = after.batches - before.batches;
+        const uint64_t samples = after.samples - before.samples;
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Client: " << all.size() / options.duration << " requests/s, "
+                  << all.size() * options.samples / options.duration << " samples/s, latency p50 "
+                  << percentile(0.5) << " us, p99 " << percentile(0.99) << " us, max " << all.back() << " us"
+                  << std::endl;
+        std::cout << "Server: " << (after.requests - before.requests) << " requests, "
+                  << (batches ? (double) samples / batches : 0.0) << " samples/batch, latency p50 "
+                  << after.p50 << " us, p99 " << after.p99 << " us" << std::endl;
+    }
+
+    /** Write a random sigmoid network in the model format */
+    void write_model(const Options &options)
+    {
+        functions::Activation_function_cPtr<> sigmoid(new functions::Sigmoid<>());
+        Network<> network(options.layers, sigmoid, 1);
+
+        save_model(network, options.model);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    bool valid = true;
+
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc)
+        {
+            options.socket_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+        {
+            options.port = (uint16_t) atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--connections") && i + 1 < argc)
+        {
+            options.connections = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--duration") && i + 1 < argc)
+        {
+            options.duration = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+        {
+            options.samples = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--write-model") && i + 1 < argc)
+        {
+            options.model = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--layers") && i + 1 < argc)
+        {
+            std::istringstream sizes(argv[++i]);
+            std::string size;
+
+            options.layers.clear();
+
+            while (std::getline(sizes, size, ','))
+            {
+                options.layers.push_back(atoi(size.c_str()));
+            }
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid || options.duration <= 0 || options.samples == 0 || options.samples > serving::MAX_REQUEST ||
+        options.layers.size() < 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--socket path | --port n] [--connections n] [--duration seconds]"
+                  << " [--samples n]" << std::endl
+                  << "       " << argv[0] << " --write-model path [--layers n,n,...]" << std::endl;
+        return 1;
+    }
+
+    try
+    {
+        if (!options.model.empty())
+        {
+            write_model(options);
+            return 0;
+        }
+
+        try
+        {
+            run<double>(options);
+        }
+        catch (const std::invalid_argument&)
+        {
+            run<float>(options);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,203 @@
+/*
+ * pipeline_benchmark.cpp
+ *
+ * Throughput of a deep network streamed through a Pipelined_network for an
+ * increasing number of stages, against Network::test() on one thread, with
+ * the occupancy of each stage.
+ *
+ * Usage: pipeline_benchmark [--width n] [--depth n] [--samples n]
+ *                           [--batch-size n] [--max-stages n] [--pin]
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "Network.hpp"
+#include "Pipelined_network.hpp"
+#include "functions/Sigmoid.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    typedef std::chrono::steady_clock Clock;
+
+    /** Class Options: command line settings */
+    struct Options
+    {
+            uint32_t width = 512;       ///< Neurons of each layer
+            size_t depth = 8;           ///< Number of layers after the input one
+            size_t samples = 20000;     ///< Samples streamed for each measurement
+            size_t batch_size = 16;     ///< Samples passed between stages at once
+            size_t max_stages = 4;      ///< Largest number of stages measured
+            bool pin = false;           ///< Pin the stage threads
+    };
+
+    double seconds_since(Clock::time_point start)
+    {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    /**
+     * Stream the inputs with a producer thread pushing and the calling
+     * thread popping.
+     */
+    void stream(Pipelined_network<float> &pipeline, const std::vector<float> &inputs, std::vector<float> &outputs, size_t count)
+    {
+        std::thread producer([&]()
+        {
+            size_t pushed = 0;
+
+            while (pushed < count)
+            {
+                const size_t fed = pipeline.push(inputs.data() + pushed * pipeline.inputs(), count - pushed);
+
+                pushed += fed;
+
+                if (!fed)
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        size_t popped = 0;
+
+        while (popped < count)
+        {
+            const size_t read = pipeline.pop(outputs.data() + popped * pipeline.outputs(), count - popped);
+
+            popped += read;
+
+            if (!read)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        producer.join();
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    bool valid = true;
+
+    for (int i = 1; i < argc && valid; ++i)
+    {
+        if (!strcmp(argv[i], "--width") && i + 1 < argc)
+        {
+            options.width = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--depth") && i + 1 < argc)
+        {
+            options.depth = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--samples") && i + 1 < argc)
+        {
+            options.samples = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--batch-size") && i + 1 < argc)
+        {
+            options.batch_size = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--max-stages") && i + 1 < argc)
+        {
+            options.max_stages = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--pin"))
+        {
+            options.pin = true;
+        }
+        else
+        {
+            valid = false;
+        }
+    }
+
+    if (!valid || !options.width || !options.depth || !options.samples || !options.batch_size || !options.max_stages)
+    {
+        std::cerr << "Usage: " << argv[0] << " [--width n] [--depth n] [--samples n]"
+                  << " [--batch-size n] [--max-stages n] [--pin]" << std::endl;
+        return 1;
+    }
+
+    std::vector<uint32_t> layers(options.depth + 1, options.width);
+    Network<float> network(layers, std::make_shared<functions::Sigmoid<float>>(), 1);
+    std::vector<float> inputs(options.samples * options.width);
+    std::vector<float> expected(options.samples * options.width);
+    std::vector<float> outputs(options.samples * options.width);
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> distrib(0, 1);
+
+    for (float &value : inputs)
+    {
+        value = distrib(rng);
+    }
+
+    std::cout << options.depth << " layers of " << options.width << " neurons, " << options.samples << " samples, batches of "
+              << options.batch_size << ", " << std::thread::hardware_concurrency() << " cores" << std::endl;
+    std::cout << std::fixed << std::setprecision(0);
+
+    // Reference: the whole network on the calling thread, in batches of the same size
+    Workspace<float> workspace = network.create_workspace(options.batch_size);
+    Clock::time_point start = Clock::now();
+
+    for (size_t first = 0; first < options.samples; first += options.batch_size)
+    {
+        const size_t count = std::min(options.batch_size, options.samples - first);
+
+        network.test(workspace, inputs.data() + first * options.width, count, expected.data() + first * options.width);
+    }
+
+    const double reference = options.samples / seconds_since(start);
+
+    std::cout << "Network::test    " << std::setw(10) << reference << " samples/s" << std::endl;
+
+    for (size_t stages = 1; stages <= std::min(options.max_stages, options.depth); stages *= 2)
+    {
+        Pipeline_settings settings(stages);
+
+        settings.batch_size = options.batch_size;
+        settings.pin_threads = options.pin;
+
+        Pipelined_network<float> pipeline(network, settings);
+
+        start = Clock::now();
+        stream(pipeline, inputs, outputs, options.samples);
+
+        const double throughput = options.samples / seconds_since(start);
+        float difference = 0;
+
+        for (size_t i = 0; i < outputs.size(); ++i)
+        {
+            difference = std::max(difference, std::fabs(outputs[i] - expected[i]));
+        }
+
+        std::cout << std::setw(2) << stages << " stage" << (stages == 1 ? " " : "s") << "        " << std::setw(10) << throughput
+                  << " samples/s  x" << std::setprecision(2) << throughput / reference << "  max difference " << std::scientific
+                  << difference << std::fixed << std::endl;
+
+        for (const Stage_stats &stats : pipeline.stage_stats())
+        {
+            std::cout << "    layers " << std::setw(2) << stats.first_layer << "-" << std::setw(2) << std::left << stats.last_layer
+                      << std::right << "  occupancy " << std::setprecision(1) << std::setw(5) << stats.occupancy * 100 << "%"
+                      << std::setprecision(3) << "  busy " << stats.busy << "s  starved " << stats.starved << "s  blocked " << stats.blocked << "s" << std::endl;
+        }
+
+        std::cout << std::setprecision(0);
+    }
+
+    return 0;
+}
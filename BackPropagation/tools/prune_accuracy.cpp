@@ -0,0 +1,201 @@
+/*
+ * prune_accuracy.cpp
+ *
+ * Prunes a trained network to increasing sparsities, with and without
+ * fine-tuning, and compares the sparse inference and the model file of
+ * the pruned network with Network::test.
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "Kernels.hpp"
+#include "Model_file.hpp"
+#include "Network.hpp"
+#include "Sparse_network.hpp"
+#include "functions/Sigmoid.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * @return count random samples, labelled with the outputs of a teacher network.
+     */
+    std::vector<Training_data<>> make_samples(size_t count, Network<> &teacher)
+    {
+        std::mt19937 rng(3);
+        std::uniform_real_distribution<double> distrib(0.0, 1.0);
+        std::vector<Training_data<>> samples(count);
+
+        for (auto &sample : samples)
+        {
+            for (size_t i = 0; i < teacher.inputs(); ++i)
+            {
+                sample.inputs.push_back(distrib(rng));
+            }
+
+            sample.outputs = teacher.test(sample.inputs);
+        }
+
+        return samples;
+    }
+
+    /**
+     * @return size of the model file of the network, in bytes.
+     */
+    size_t model_size(const Network<> &net, const std::string &path, double minSparsity)
+    {
+        struct stat info = {};
+
+        save_model(net, path, minSparsity);
+        stat(path.c_str(), &info);
+
+        return info.st_size;
+    }
+
+    /**
+     * Print the pruning report of the network and the throughput of its
+     * sparse version.
+     */
+    void compare(const char *title, Network<> net, const std::vector<Training_data<>> &data,
+                 double sparsity, const Network<>::Settings *fineTuning)
+    {
+        Pruning_report report = prune(net, data, Pruning_settings(sparsity), fineTuning);
+        Sparse_network<> sparse(net);
+
+        const size_t inputs = net.inputs();
+        const size_t outputs = net.outputs();
+        const size_t count = data.size();
+
+        std::vector<double> batch(count * inputs);
+        std::vector<double> expected(count * outputs);
+        std::vector<double> actual(count * outputs);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::copy(data[i].inputs.begin(), data[i].inputs.end(), batch.begin() + i * inputs);
+        }
+
+        Workspace<> workspace = net.create_workspace();
+        Workspace<> sparseWorkspace = sparse.create_workspace();
+
+        sparse.test(sparseWorkspace, batch.data(), count, actual.data());
+
+        // Throughput, sample by sample as a serving thread would run them
+        const size_t repeats = std::max<size_t>(1, 200000000 / (count * report.dense_bytes));
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t r = 0; r < repeats; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                net.test(workspace, batch.data() + i * inputs, 1, expected.data() + i * outputs);
+            }
+        }
+
+        double reference = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+
+        for (size_t r = 0; r < repeats; ++r)
+        {
+            sparse.test(sparseWorkspace, batch.data(), count, actual.data());
+        }
+
+        double fast = seconds_since(start);
+        double maxError = 0.0;
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            maxError = std::max(maxError, fabs(expected[i] - actual[i]));
+        }
+
+        // Model files, dense and with the pruned layers stored sparse
+        const std::string path = "prune_accuracy.model";
+        const size_t denseModel = model_size(net, path, 2.0);
+        const size_t sparseModel = model_size(net, path, 0.5);
+        Mapped_network<> mapped(path);
+        Workspace<> mappedWorkspace = mapped.create_workspace(count);
+        double mappedError = 0.0;
+
+        mapped.test(mappedWorkspace, batch.data(), count, actual.data());
+        remove(path.c_str());
+
+        for (size_t i = 0; i < expected.size(); ++i)
+        {
+            mappedError = std::max(mappedError, fabs(expected[i] - actual[i]));
+        }
+
+        std::cout << title << std::endl;
+        std::cout << "\tSparsity: " << 100.0 * report.sparsity << " % (layers";
+
+        for (double layerSparsity : report.layer_sparsities)
+        {
+            std::cout << " " << 100.0 * layerSparsity << " %";
+        }
+
+        std::cout << ")" << std::endl;
+        std::cout << "\tError: " << report.error_before << " before, " << report.error_pruned << " pruned, "
+                  << report.error_after << " fine-tuned" << std::endl;
+        std::cout << "\tWeights: " << report.dense_bytes << " bytes, sparse " << report.sparse_bytes << " bytes ("
+                  << 100.0 * (1.0 - (double) report.sparse_bytes / report.dense_bytes) << " % saved)" << std::endl;
+        std::cout << "\tMax difference with Network::test: " << maxError << std::endl;
+        std::cout << "\tModel file: " << sparseModel << " bytes, dense " << denseModel << " bytes, max difference "
+                  << "with Network::test " << mappedError << std::endl;
+        std::cout << "\tSamples/s: " << repeats * count / reference << ", sparse " << repeats * count / fast
+                  << " (x" << reference / fast << ")" << std::endl;
+    }
+}
+
+int main()
+{
+    functions::Activation_function_cPtr<> sigmoid(new functions::Sigmoid<>());
+
+    std::cout << "Kernels: " << kernels::active<double>().name << std::endl;
+
+    // A network learning the outputs of a smaller random one
+    Network<> teacher({ 128, 32, 8 }, sigmoid, 2);
+    std::vector<Training_data<>> samples = make_samples(500, teacher);
+    Network<> trained({ 128, 256, 8 }, sigmoid, 1);
+    Network<>::Settings settings(30, 0.0, 0.99, 1);
+
+    settings.optimizer = Optimizer::ADAM;
+    settings.learning_rate = 0.001;
+    trained.train(samples, settings);
+
+    Network<>::Settings fineTuning = settings;
+    fineTuning.max_iterations = 10;
+
+    for (double sparsity : { 0.5, 0.8, 0.9, 0.95 })
+    {
+        std::string title = "Trained 128-256-8, " + std::to_string((int) (100 * sparsity)) + " % pruned";
+
+        compare(title.c_str(), trained, samples, sparsity, nullptr);
+        compare((title + ", fine-tuned").c_str(), trained, samples, sparsity, &fineTuning);
+    }
+
+    // A larger network, random weights, the errors being the changes of its outputs
+    Network<> large({ 1024, 1024, 1024, 16 }, sigmoid, 1);
+    std::vector<Training_data<>> outputs = make_samples(100, large);
+
+    for (double sparsity : { 0.5, 0.8, 0.9, 0.95 })
+    {
+        std::string title = "Random 1024-1024-1024-16, " + std::to_string((int) (100 * sparsity)) + " % pruned";
+
+        compare(title.c_str(), large, outputs, sparsity, nullptr);
+    }
+
+    return 0;
+}
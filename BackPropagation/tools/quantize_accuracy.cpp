@@ -0,0 +1,169 @@
+/*
+ * quantize_accuracy.cpp
+ *
+ * Compares the int8 quantized inference with Network::test, on the
+ * network trained by the demo and on a larger random network.
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <math.h>
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "Kernels.hpp"
+#include "Network.hpp"
+#include "Quantized_network.hpp"
+#include "functions/Sigmoid.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    std::vector<Training_data<>> train_data = {
+        { { 0, 0, 0, 0 }, { 1, 1, 1, 1 }, {} },
+        { { 0, 0, 0, 1 }, { 1, 1, 1, 0 }, {} },
+        { { 0, 0, 1, 0 }, { 1, 1, 0, 1 }, {} },
+        { { 0, 0, 1, 1 }, { 1, 1, 0, 0 }, {} },
+        { { 0, 1, 0, 0 }, { 1, 0, 1, 1 }, {} },
+        { { 0, 1, 0, 1 }, { 1, 0, 1, 0 }, {} },
+        { { 0, 1, 1, 0 }, { 1, 0, 0, 1 }, {} },
+        { { 0, 1, 1, 1 }, { 1, 0, 0, 0 }, {} },
+        { { 1, 0, 0, 0 }, { 0, 1, 1, 1 }, {} },
+        { { 1, 0, 0, 1 }, { 0, 1, 1, 0 }, {} },
+        { { 1, 0, 1, 0 }, { 0, 1, 0, 1 }, {} },
+        { { 1, 0, 1, 1 }, { 0, 1, 0, 0 }, {} },
+        { { 1, 1, 0, 0 }, { 0, 0, 1, 1 }, {} },
+        { { 1, 1, 0, 1 }, { 0, 0, 1, 0 }, {} },
+        { { 1, 1, 1, 0 }, { 0, 0, 0, 1 }, {} },
+        { { 1, 1, 1, 1 }, { 0, 0, 0, 0 }, {} }
+    };
+
+    double seconds_since(std::chrono::steady_clock::time_point start)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    /**
+     * Print the differences between the outputs of the network and of its
+     * quantized version, and the throughput of both.
+     */
+    void compare(const char *title, const Network<> &net, const std::vector<Training_data<>> &data)
+    {
+        Quantized_network<> quantized(net, data);
+
+        const size_t inputs = net.inputs();
+        const size_t outputs = net.outputs();
+        const size_t count = data.size();
+
+        std::vector<double> batch(count * inputs);
+        std::vector<double> expected(count * outputs);
+        std::vector<double> actual(count * outputs);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            std::copy(data[i].inputs.begin(), data[i].inputs.end(), batch.begin() + i * inputs);
+        }
+
+        Workspace<> workspace = net.create_workspace(count);
+        Quantized_workspace quantizedWorkspace = quantized.create_workspace();
+
+        net.test(workspace, batch.data(), count, expected.data());
+        quantized.test(quantizedWorkspace, batch.data(), count, actual.data());
+
+        double maxError = 0.0;
+        double sumError = 0.0;
+        size_t rounded = 0;
+        size_t argmax = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            const double *e = expected.data() + i * outputs;
+            const double *a = actual.data() + i * outputs;
+
+            for (size_t j = 0; j < outputs; ++j)
+            {
+                maxError = std::max(maxError, fabs(e[j] - a[j]));
+                sumError += fabs(e[j] - a[j]);
+                rounded += (e[j] >= 0.5) == (a[j] >= 0.5);
+            }
+
+            argmax += std::max_element(e, e + outputs) - e == std::max_element(a, a + outputs) - a;
+        }
+
+        size_t parameters = 0;
+
+        for (const auto &layer : net.layers())
+        {
+            parameters += layer.parameters();
+        }
+
+        // Throughput, sample by sample as a serving thread would run them
+        const size_t repeats = std::max<size_t>(1, 100000000 / (count * parameters));
+        auto start = std::chrono::steady_clock::now();
+
+        for (size_t r = 0; r < repeats; ++r)
+        {
+            for (size_t i = 0; i < count; ++i)
+            {
+                net.test(workspace, batch.data() + i * inputs, 1, expected.data() + i * outputs);
+            }
+        }
+
+        double reference = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+
+        for (size_t r = 0; r < repeats; ++r)
+        {
+            quantized.test(quantizedWorkspace, batch.data(), count, actual.data());
+        }
+
+        double fast = seconds_since(start);
+
+        std::cout << title << std::endl;
+        std::cout << "\tSamples: " << count << std::endl;
+        std::cout << "\tMax absolute error: " << maxError << std::endl;
+        std::cout << "\tMean absolute error: " << sumError / (count * outputs) << std::endl;
+        std::cout << "\tOutputs rounded the same: " << 100.0 * rounded / (count * outputs) << " %" << std::endl;
+        std::cout << "\tSame largest output: " << 100.0 * argmax / count << " %" << std::endl;
+        std::cout << "\tWeights: " << parameters * sizeof(double) << " bytes, quantized " << quantized.weight_bytes() << " bytes" << std::endl;
+        std::cout << "\tQuantized network, activation tables included: " << quantized.bytes() << " bytes" << std::endl;
+        std::cout << "\tSamples/s: " << repeats * count / reference << ", quantized " << repeats * count / fast
+                  << " (x" << reference / fast << ")" << std::endl;
+    }
+}
+
+int main()
+{
+    functions::Activation_function_cPtr<> sigmoid(new functions::Sigmoid<>());
+
+    std::cout << "Kernels: " << kernels::active<double>().name << ", int8 "
+              << kernels::active_int8().name << std::endl;
+
+    // The network of the demo
+    Network<> trained({ 4, 8, 4 }, sigmoid, 1);
+    Network<>::Settings settings(10000, 0.01, 0.99, 1);
+
+    trained.train(train_data, settings);
+    compare("Trained 4-8-4:", trained, train_data);
+
+    // A larger network, random weights and inputs
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> distrib(0.0, 1.0);
+    std::vector<Training_data<>> samples(1000);
+    Network<> large({ 256, 512, 256, 16 }, sigmoid, 1);
+
+    for (auto &sample : samples)
+    {
+        for (size_t i = 0; i < large.inputs(); ++i)
+        {
+            sample.inputs.push_back(distrib(rng));
+        }
+    }
+
+    compare("Random 256-512-256-16:", large, samples);
+
+    return 0;
+}
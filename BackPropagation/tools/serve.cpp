@@ -0,0 +1,171 @@
+/*
+ * serve.cpp
+ *
+ * Serves a model file written by save_model() on a Unix domain socket or a
+ * TCP port of localhost, printing the counters of the server periodically.
+ * Stops on SIGINT or SIGTERM.
+ *
+ * Usage: serve model [--socket path | --port n] [--max-batch n] [--max-delay us]
+ *              [--workers n] [--interval seconds]
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "Inference_server.hpp"
+#include "Kernels.hpp"
+
+using namespace BackPropagation;
+
+namespace
+{
+    /** Class Options: command line settings */
+    struct Options
+    {
+            std::string model;          ///< Model file to serve
+            Server_settings server;     ///< Server configuration
+            double interval = 5.0;      ///< Seconds between two prints of the counters
+    };
+
+    /** Print the counters, with the rates since the previous print */
+    void print(const serving::Stats &stats, const serving::Stats &previous)
+    {
+        const double seconds = stats.seconds - previous.seconds;
+        const uint64_t batches = stats.batches - previous.batches;
+
+        std::cout << std::fixed << std::setprecision(1)
+                  << "[" << stats.seconds << " s] "
+                  << (stats.requests - previous.requests) / seconds << " requests/s, "
+                  << (stats.samples - previous.samples) / seconds << " samples/s, "
+                  << (batches ? (double) (stats.samples - previous.samples) / batches : 0.0) << " samples/batch, "
+                  << "latency p50 " << stats.p50 << " us, p99 " << stats.p99 << " us, "
+                  << stats.requests << " requests served" << std::endl;
+    }
+
+    /**
+     * Serve the model until SIGINT or SIGTERM, which the calling thread
+     * waits for.
+     */
+    template <typename T>
+    void serve(const Options &options, const sigset_t &signals)
+    {
+        Mapped_network<T> network(options.model);
+        Inference_server<T> server(network, options.server);
+
+        std::cout << "Serving " << options.model << " (" << network.inputs() << " inputs, " << network.outputs()
+                  << " outputs, " << (sizeof(T) == sizeof(float) ? "float" : "double") << ") on "
+                  << (options.server.socket_path.empty() ? "port " + std::to_string(options.server.port)
+                                                         : options.server.socket_path)
+                  << ", batches of up to " << options.server.max_batch << " samples within "
+                  << options.server.max_delay << " us, " << options.server.workers << " workers" << std::endl;
+
+        std::thread serving([&server] { server.run(); });
+
+        const timespec interval = { (time_t) options.interval, (long) ((options.interval - (time_t) options.interval) * 1e9) };
+        serving::Stats previous = server.stats();
+
+        while (sigtimedwait(&signals, nullptr, &interval) < 0)
+        {
+            serving::Stats stats = server.stats();
+
+            print(stats, previous);
+            previous = stats;
+        }
+
+        server.stop();
+        serving.join();
+        print(server.stats(), serving::Stats());
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--socket") && i + 1 < argc)
+        {
+            options.server.socket_path = argv[++i];
+        }
+        else if (!strcmp(argv[i], "--port") && i + 1 < argc)
+        {
+            options.server.port = (uint16_t) atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--max-batch") && i + 1 < argc)
+        {
+            options.server.max_batch = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--max-delay") && i + 1 < argc)
+        {
+            options.server.max_delay = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--workers") && i + 1 < argc)
+        {
+            options.server.workers = atoi(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--interval") && i + 1 < argc)
+        {
+            options.interval = atof(argv[++i]);
+        }
+        else if (argv[i][0] != '-' && options.model.empty())
+        {
+            options.model = argv[i];
+        }
+        else
+        {
+            options.model.clear();
+            break;
+        }
+    }
+
+    if (options.model.empty() || options.interval <= 0)
+    {
+        std::cerr << "Usage: " << argv[0] << " model [--socket path | --port n] [--max-batch n] [--max-delay us]"
+                  << " [--workers n] [--interval seconds]" << std::endl;
+        return 1;
+    }
+
+    // Blocked in every thread, the main thread waits for them
+    sigset_t signals;
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    std::cout << "Kernels: " << kernels::active<double>().name << std::endl;
+
+    try
+    {
+        model::Header header = {};
+        std::ifstream file(options.model, std::ios::binary);
+
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+        if (header.scalar_size == sizeof(float))
+        {
+            serve<float>(options, signals);
+        }
+        else
+        {
+            serve<double>(options, signals);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,248 @@
+/*
+ * benchmark.cpp
+ *
+ * Microbenchmarks of the training and of the test of the network, over a
+ * sweep of input widths and data set sizes.
+ *
+ * Usage: benchmark [--quick] [--min-time seconds] [--json file]
+ *
+ * Author: Nicolae Natea
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+
+#include "Network.hpp"
+
+namespace
+{
+    /** Number of outputs of the benchmarked networks */
+    constexpr size_t OUTPUTS = 4;
+
+    /** Class Options: command line settings */
+    struct Options
+    {
+            double min_time = 0.2;  ///< Minimum duration of each measurement, in seconds
+            bool quick = false;     ///< Smaller sweeps, for a quick check
+            std::string json;       ///< File the results are written to, none if empty
+    };
+
+    /** Class Result: one measurement */
+    struct Result
+    {
+            std::string name;       ///< Operation
+            size_t width;           ///< Number of inputs
+            size_t samples;         ///< Data set size
+            size_t repetitions;     ///< Number of times the operation was run
+            double seconds;         ///< Total duration
+            double samples_per_op;  ///< Samples processed by one operation
+            double ops_per_op;      ///< Integer multiply-adds of one operation, 0 if not counted
+
+            double ns_per_op() const
+            {
+                return seconds * 1e9 / repetitions;
+            }
+
+            double samples_per_second() const
+            {
+                return samples_per_op * repetitions / seconds;
+            }
+
+            double gops() const
+            {
+                return ops_per_op * repetitions / seconds * 1e-9;
+            }
+    };
+
+    Options options;
+    std::vector<Result> results;
+
+    /**
+     * Run an operation until it took at least options.min_time, doubling
+     * the number of repetitions, and record the result.
+     */
+    void measure(
+        const std::string &name,
+        size_t width,
+        size_t samples,
+        double samplesPerOp,
+        double opsPerOp,
+        const std::function<void()> &operation)
+    {
+        operation();
+
+        size_t repetitions = 1;
+        double seconds = 0.0;
+
+        for (;;)
+        {
+            auto start = std::chrono::steady_clock::now();
+
+            for (size_t i = 0; i < repetitions; ++i)
+            {
+                operation();
+            }
+
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+            if (seconds >= options.min_time)
+            {
+                break;
+            }
+
+            repetitions *= seconds > 0.0 ? std::min(100.0, std::max(2.0, 1.2 * options.min_time / seconds)) : 100;
+        }
+
+        Result result = { name, width, samples, repetitions, seconds, samplesPerOp, opsPerOp };
+        results.push_back(result);
+
+        std::cout << std::left << std::setw(24) << name
+                  << std::right << std::setw(6) << width << std::setw(9) << samples
+                  << std::setw(18) << std::fixed << std::setprecision(1) << result.ns_per_op()
+                  << std::setw(16) << std::setprecision(0) << result.samples_per_second()
+                  << std::setw(10) << std::setprecision(2) << result.gops() << std::endl;
+    }
+
+    /**
+     * Random binary samples, the outputs being a function of the inputs.
+     */
+    std::vector<Bsw::Training_data> random_data(size_t count, size_t inputs, std::mt19937 &rng)
+    {
+        std::vector<Bsw::Training_data> data(count);
+
+        for (auto &sample : data)
+        {
+            for (size_t i = 0; i < inputs; ++i)
+            {
+                sample.inputs.push_back(rng() & 1);
+            }
+            for (size_t i = 0; i < OUTPUTS; ++i)
+            {
+                sample.outputs.push_back(sample.inputs[i] ^ sample.inputs[inputs - 1 - i]);
+            }
+        }
+
+        return data;
+    }
+
+    /**
+     * Training, which happens in the constructor, and test of one sample.
+     */
+    void benchmark_network(size_t width, size_t samples)
+    {
+        std::mt19937 rng(1);
+        std::vector<Bsw::Training_data> data = random_data(samples, width, rng);
+
+        measure("Network::Network", width, samples, samples, 0, [&] {
+            Bsw::Network net(data);
+        });
+
+        Bsw::Network net(data);
+        size_t index = 0;
+
+        // One multiply-add per input, for at least one node per output
+        measure("Network::test", width, samples, 1, (double) width * OUTPUTS, [&] {
+            net.test(data[index].inputs);
+            index = (index + 1) % samples;
+        });
+    }
+
+    void write_json(const std::string &path)
+    {
+        std::ofstream file(path);
+
+        file << "{\n  \"engine\": \"Bsw\",\n";
+        file << "  \"min_time\": " << options.min_time << ",\n";
+        file << "  \"results\": [\n";
+
+        for (size_t i = 0; i < results.size(); ++i)
+        {
+            const Result &result = results[i];
+
+            file << "    { \"name\": \"" << result.name << "\""
+                 << ", \"width\": " << result.width
+                 << ", \"samples\": " << result.samples
+                 << ", \"repetitions\": " << result.repetitions
+                 << ", \"ns_per_op\": " << result.ns_per_op()
+                 << ", \"samples_per_s\": " << result.samples_per_second()
+                 << ", \"gops\": ";
+
+            if (result.ops_per_op > 0)
+            {
+                file << result.gops();
+            }
+            else
+            {
+                file << "null";
+            }
+
+            file << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+
+        file << "  ]\n}\n";
+
+        if (!file)
+        {
+            std::cerr << "Can not write " << path << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (!strcmp(argv[i], "--quick"))
+        {
+            options.quick = true;
+            options.min_time = 0.05;
+        }
+        else if (!strcmp(argv[i], "--min-time") && i + 1 < argc)
+        {
+            options.min_time = atof(argv[++i]);
+        }
+        else if (!strcmp(argv[i], "--json") && i + 1 < argc)
+        {
+            options.json = argv[++i];
+        }
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--quick] [--min-time seconds] [--json file]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::cout << std::left << std::setw(24) << "Operation"
+              << std::right << std::setw(6) << "Width" << std::setw(9) << "Samples"
+              << std::setw(18) << "ns/op" << std::setw(16) << "samples/s" << std::setw(10) << "GOP/s" << std::endl;
+
+    const std::vector<size_t> widths = options.quick ?
+        std::vector<size_t>{ 4, 8 } :
+        std::vector<size_t>{ 4, 8, 12, 16 };
+    const std::vector<size_t> sizes = options.quick ?
+        std::vector<size_t>{ 16, 64 } :
+        std::vector<size_t>{ 16, 64, 256, 1024 };
+
+    for (size_t width : widths)
+    {
+        for (size_t samples : sizes)
+        {
+            benchmark_network(width, samples);
+        }
+    }
+
+    if (!options.json.empty())
+    {
+        write_json(options.json);
+    }
+
+    return 0;
+}